@@ -0,0 +1,91 @@
+/*
+	Benchmark harness. Measures the host's peak bandwidth and flop rate, times the
+	main Matrix kernels and prints a roofline report as CSV, followed by the
+	hardware counters of one single threaded run of each kernel when
+	perf_event_open is allowed.
+
+	usage: benchmark [n]
+		n - dimension of the square matrices, 2048 by default. Smaller sizes fit in
+			cache and report memory bound kernels above the roof.
+*/
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <functional>
+#include "Matrix.hpp"
+#include "Elementwise.hpp"
+#include "Transcendental.hpp"
+#include "Gemm.hpp"
+#include "Roofline.hpp"
+#include "Perf.hpp"
+
+// a kernel to benchmark. flops and bytes are read from the instrumentation when negative.
+struct Case {
+	std::string name;
+	std::function<void()> run;
+	double flops, bytes;
+};
+
+int main(int argc, char** argv) {
+	math::uint n = (argc > 1) ? static_cast<math::uint>(std::atoi(argv[1])) : 2048;
+	if (n == 0) {
+		std::cerr << "usage: " << argv[0] << " [n]\n";
+		return 1;
+	}
+	namespace rl = math::roofline;
+
+	math::dMatrix a (n, n, 1.5), b (n, n, 0.5), c (n, n, 0.0);
+	math::dMatrix row (1, n, 2.0);
+	double elems = static_cast<double>(n) * n;
+
+	std::vector<Case> cases = {
+		{ "gemm", [&] { math::gemm(1.0, a, b, 0.0, c); }, -1, -1 },
+		{ "add", [&] { c = a; c += b; }, -1, -1 },
+		{ "scale", [&] { c *= 1.0001; }, -1, -1 },
+		{ "broadcast_row", [&] { c = a + row; }, -1, -1 },
+		{ "transpose", [&] { c.T(); }, -1, -1 },
+		{ "copy", [&] { c = a; }, -1, -1 },
+		{ "exp", [&] { c = math::exp(a); }, -1, -1 },
+		{ "apply", [&] { math::apply(c, [](double x) { return x * x + 1.0; }); }, -1, -1 },
+		// softmax is not instrumented: a max, exp, sum and scale per element over one read and one write
+		{ "softmax", [&] { c = math::softmax(a); }, 4 * elems, 2 * elems * sizeof(double) },
+	};
+
+	std::vector<rl::Kernel> kernels;
+	for (size_t i = 0; i < cases.size(); ++i) {
+		math::uint reps = (cases[i].name == "gemm") ? 3 : 5;
+		if (cases[i].flops < 0) kernels.push_back(rl::measure(cases[i].name, cases[i].run, reps));
+		else kernels.push_back(rl::measure(cases[i].name, cases[i].flops, cases[i].bytes, cases[i].run, reps));
+	}
+
+	rl::Machine m = rl::measure_machine();
+	std::cout << rl::report(m, kernels);
+
+	// hardware counters only see the calling thread, so run each kernel on it alone
+	if (!math::perf::local().available()) {
+		std::cout << "\n# hardware counters unavailable\n";
+		return 0;
+	}
+	math::uint threads = math::parallel::num_threads();
+	math::parallel::num_threads() = 1;
+
+	std::cout << "\nname";
+	for (math::uint e = 0; e < math::perf::EVENTS; ++e) std::cout << "," << math::perf::event_name(static_cast<math::perf::Event>(e));
+	std::cout << ",ipc\n";
+	for (size_t i = 0; i < cases.size(); ++i) {
+		math::perf::Reading r = math::perf::measure(cases[i].run);
+		std::cout << cases[i].name;
+		for (math::uint e = 0; e < math::perf::EVENTS; ++e) {
+			if (r.valid[e]) std::cout << "," << r.value[e];
+			else std::cout << ",";
+		}
+		bool ipc = r.valid[math::perf::CYCLES] && r.valid[math::perf::INSTRUCTIONS] && r.value[math::perf::CYCLES];
+		std::cout << ",";
+		if (ipc) std::cout << static_cast<double>(r.value[math::perf::INSTRUCTIONS]) / r.value[math::perf::CYCLES];
+		std::cout << "\n";
+	}
+
+	math::parallel::num_threads() = threads;
+	return 0;
+}
@@ -0,0 +1,288 @@
+/** @file Async.hpp
+	Contains non-blocking Matrix operations that return futures and run on the
+	library thread pool.
+
+	Every operation accepts Matrix operands or futures of earlier operations in
+	any mix. An operation whose inputs are futures is queued on the pool only
+	once all of them are ready, so chained calls form a task graph that runs as
+	its dependencies complete, without a pool thread ever blocking on an input.
+	Matrix operands are copied when the call is made, which is O(1) for matrices
+	with copy-on-write on, so the caller may change them straight away. If an
+	input fails, its exception is passed on to every dependent future.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _ASYNC_H_
+#define _ASYNC_H_
+
+#include <mutex>				// mutex, unique_lock
+#include <condition_variable>	// condition_variable
+#include <functional>			// function
+#include <memory>				// shared_ptr, make_shared, unique_ptr
+#include <vector>				// vector
+#include <atomic>				// atomic
+#include <exception>			// exception_ptr
+#include "Matrix.hpp"			// Matrix
+#include "Parallel.hpp"			// pool
+#include "typedefs.h"			// uint
+
+
+namespace math {
+namespace async {
+
+namespace detail {
+
+// result slot shared by a future and the task producing it
+template<typename T>
+struct State {
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool done;
+	std::unique_ptr<T> value;
+	std::exception_ptr error;
+	std::vector<std::function<void()> > next;
+
+	State() : done(false) {}
+
+	// publishes the result and runs the continuations waiting on it
+	void finish() {
+		std::vector<std::function<void()> > run;
+		{
+			std::unique_lock<std::mutex> lock (mutex);
+			done = true;
+			run.swap(next);
+		}
+		cv.notify_all();
+		for (ul i = 0; i < run.size(); ++i) run[i]();
+	}
+
+	// calls f once the result is published, immediately if it already is
+	void on_ready(const std::function<void()>& f) {
+		{
+			std::unique_lock<std::mutex> lock (mutex);
+			if (!done) {
+				next.push_back(f);
+				return;
+			}
+		}
+		f();
+	}
+};
+
+}	// detail
+
+
+/** @brief Handle to the result of an asynchronous operation. Copies share the
+	same result.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename T>
+class Future {
+	public:
+		/** Blocks until the result is ready.
+		*/
+		void wait() const;
+
+		/** Get whether the result is ready without blocking.
+			@return true if get() would not block
+		*/
+		bool ready() const;
+
+		/** Blocks until the result is ready and returns it.
+			@return the result, valid while any copy of this future exists
+			@throw rethrows the exception of the operation or of any input it depended on
+		*/
+		const T& get() const;
+
+		/** Creates a future that already holds `value`.
+			@param value - result to hold
+		*/
+		explicit Future(const T& value);
+
+	private:
+		explicit Future(const std::shared_ptr<detail::State<T> >& state) : _state(state) {}
+
+		template<typename U> friend class Future;
+		template<typename R, typename F, typename A>
+		friend Future<R> launch(F f, const Future<A>& a);
+		template<typename R, typename F, typename A, typename B>
+		friend Future<R> launch(F f, const Future<A>& a, const Future<B>& b);
+
+		std::shared_ptr<detail::State<T> > _state;	/**<result shared with the producing task*/
+};
+
+
+/**	Wraps a matrix in a ready future so it can be passed where a dependency is expected.
+	@param m - matrix, copied
+	@return a ready future holding the copy
+*/
+template<typename N>
+Future<Matrix<N> > ready(const Matrix<N>& m) { return Future<Matrix<N> >(m); }
+
+/**	Runs `f(a.get())` on the thread pool once `a` is ready.
+	@param f - callable taking `const A&` and returning R
+	@param a - input
+	@return future of f's result
+*/
+template<typename R, typename F, typename A>
+Future<R> launch(F f, const Future<A>& a);
+
+/**	Runs `f(a.get(), b.get())` on the thread pool once both inputs are ready.
+	@param f - callable taking `const A&, const B&` and returning R
+	@param a - first input
+	@param b - second input
+	@return future of f's result
+*/
+template<typename R, typename F, typename A, typename B>
+Future<R> launch(F f, const Future<A>& a, const Future<B>& b);
+
+
+/** @brief Element type of an operand that is either a Matrix or a future of one.
+*/
+template<typename T> struct operand;
+template<typename N> struct operand<Matrix<N> > { typedef N type; };
+template<typename N> struct operand<Future<Matrix<N> > > { typedef N type; };
+
+/**	Asynchronous `a * b`.
+	@param a - left operand, a Matrix or a Future of one
+	@param b - right operand, a Matrix or a Future of one
+	@return future of the product
+	@throw invalid_argument from get() if the shapes do not agree
+*/
+template<typename A, typename B>
+Future<Matrix<typename operand<A>::type> > gemm_async(const A& a, const B& b);
+
+/**	Asynchronous `a + b`, with the broadcasting rules of `operator+`.
+	@param a - left operand, a Matrix or a Future of one
+	@param b - right operand, a Matrix or a Future of one
+	@return future of the sum
+	@throw invalid_argument from get() if the shapes cannot be broadcast
+*/
+template<typename A, typename B>
+Future<Matrix<typename operand<A>::type> > add_async(const A& a, const B& b);
+
+/**	Asynchronous transpose into a new matrix.
+	@param a - operand, a Matrix or a Future of one
+	@return future of the transpose
+*/
+template<typename A>
+Future<Matrix<typename operand<A>::type> > transpose_async(const A& a);
+
+
+
+// implementation
+
+namespace detail {
+
+template<typename N>
+inline Future<Matrix<N> > as_future(const Matrix<N>& m) { return ready(m); }
+
+template<typename N>
+inline const Future<Matrix<N> >& as_future(const Future<Matrix<N> >& f) { return f; }
+
+// runs task on the pool and stores its result or exception in out
+template<typename R>
+void submit(const std::shared_ptr<State<R> >& out, const std::function<R()>& task) {
+	parallel::pool().submit([out, task] {
+		try {
+			out->value.reset(new R(task()));
+		} catch (...) {
+			out->error = std::current_exception();
+		}
+		out->finish();
+	});
+}
+
+struct Sum { template<typename T> T operator()(const T& x, const T& y) const { return x + y; } };
+struct Product { template<typename T> T operator()(const T& x, const T& y) const { return x * y; } };
+struct Transpose { template<typename T> T operator()(const T& x) const { T t (x); t.T(); return t; } };
+
+}	// detail
+
+
+template<typename T>
+Future<T>::Future(const T& value) : _state(std::make_shared<detail::State<T> >()) {
+	_state->value.reset(new T(value));
+	_state->done = true;
+}
+
+template<typename T>
+void Future<T>::wait() const {
+	std::unique_lock<std::mutex> lock (_state->mutex);
+	_state->cv.wait(lock, [this] { return _state->done; });
+}
+
+template<typename T>
+bool Future<T>::ready() const {
+	std::unique_lock<std::mutex> lock (_state->mutex);
+	return _state->done;
+}
+
+template<typename T>
+const T& Future<T>::get() const {
+	wait();
+	if (_state->error) std::rethrow_exception(_state->error);
+	return *_state->value;
+}
+
+
+template<typename R, typename F, typename A>
+Future<R> launch(F f, const Future<A>& a) {
+	std::shared_ptr<detail::State<R> > out = std::make_shared<detail::State<R> >();
+	std::shared_ptr<detail::State<A> > in = a._state;
+
+	in->on_ready([out, in, f] {
+		detail::submit<R>(out, [in, f]() -> R {
+			if (in->error) std::rethrow_exception(in->error);
+			return f(*in->value);
+		});
+	});
+	return Future<R>(out);
+}
+
+template<typename R, typename F, typename A, typename B>
+Future<R> launch(F f, const Future<A>& a, const Future<B>& b) {
+	std::shared_ptr<detail::State<R> > out = std::make_shared<detail::State<R> >();
+	std::shared_ptr<detail::State<A> > x = a._state;
+	std::shared_ptr<detail::State<B> > y = b._state;
+
+	// the last input to become ready queues the task
+	std::shared_ptr<std::atomic<uint> > pending = std::make_shared<std::atomic<uint> >(2);
+	std::function<void()> arrive = [out, x, y, f, pending] {
+		if (pending->fetch_sub(1) != 1) return;
+		detail::submit<R>(out, [x, y, f]() -> R {
+			if (x->error) std::rethrow_exception(x->error);
+			if (y->error) std::rethrow_exception(y->error);
+			return f(*x->value, *y->value);
+		});
+	};
+	x->on_ready(arrive);
+	y->on_ready(arrive);
+	return Future<R>(out);
+}
+
+template<typename A, typename B>
+Future<Matrix<typename operand<A>::type> > gemm_async(const A& a, const B& b) {
+	typedef Matrix<typename operand<A>::type> M;
+	return launch<M>(detail::Product(), detail::as_future(a), detail::as_future(b));
+}
+
+template<typename A, typename B>
+Future<Matrix<typename operand<A>::type> > add_async(const A& a, const B& b) {
+	typedef Matrix<typename operand<A>::type> M;
+	return launch<M>(detail::Sum(), detail::as_future(a), detail::as_future(b));
+}
+
+template<typename A>
+Future<Matrix<typename operand<A>::type> > transpose_async(const A& a) {
+	typedef Matrix<typename operand<A>::type> M;
+	return launch<M>(detail::Transpose(), detail::as_future(a));
+}
+
+}	// async
+}	// math
+
+#endif
@@ -0,0 +1,314 @@
+/** @file Autotune.hpp
+	Contains the GEMM autotuner and the tuning file it writes.
+
+	`tune_gemm` times candidate unroll, blocking and thread settings on the
+	current host for one element type and shape class, one parameter at a time,
+	and stores the fastest in `gemm_params<N>(shape)`. `save` writes every tuned
+	entry to a text file and `load` reads it back. The file named by
+	`GPML_TUNING_FILE`, or `~/.gpml_tuning` if that is unset, is loaded once at
+	startup by any program that includes this header.
+
+	Each line of the file is `type shape mc kc nc unroll threads`, where type is
+	one of float, double, int or long and shape is small, medium or large. Blank
+	lines and lines starting with `#` are ignored. The startup load skips lines
+	that are malformed or out of range instead of throwing, so a bad file never
+	stops a program before `main`.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _AUTOTUNE_H_
+#define _AUTOTUNE_H_
+
+#include <string>		// string
+#include <vector>		// vector
+#include <fstream>		// ifstream, ofstream
+#include <sstream>		// istringstream
+#include <chrono>		// steady_clock
+#include <cstdlib>		// getenv
+#include <stdexcept>	// invalid_argument, runtime_error
+#include "Gemm.hpp"		// gemm_blocked, gemm_params, GemmParams, GemmShape
+#include "Parallel.hpp"	// num_threads
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+namespace autotune {
+
+/** @brief Name used for element type `N` in the tuning file. Only the types
+	specialized here can be saved and loaded.
+*/
+template<typename N> struct type_name;
+template<> struct type_name<float> { static const char* get() { return "float"; } };
+template<> struct type_name<double> { static const char* get() { return "double"; } };
+template<> struct type_name<int> { static const char* get() { return "int"; } };
+template<> struct type_name<long> { static const char* get() { return "long"; } };
+
+/** Largest blocking size or thread count accepted from a tuning file. */
+const uint MAX_TUNING_VALUE = 1u << 16;
+
+/** Name used for shape class `s` in the tuning file.
+	@param s - shape class
+	@return "small", "medium" or "large"
+*/
+inline const char* shape_name(GemmShape s) {
+	static const char* names[GEMM_SHAPES] = { "small", "medium", "large" };
+	return names[s];
+}
+
+/** Dimension of the square product timed for shape class `s` when `tune_gemm`
+	is not given one.
+	@param s - shape class
+	@return 64, 512 or 1536
+*/
+inline uint default_size(GemmShape s) {
+	static const uint sizes[GEMM_SHAPES] = { 64, 512, 1536 };
+	return sizes[s];
+}
+
+/** Path of the tuning file loaded at startup.
+	@return `$GPML_TUNING_FILE`, else `$HOME/.gpml_tuning`, else an empty string
+*/
+inline std::string default_path() {
+	const char* env = std::getenv("GPML_TUNING_FILE");
+	if (env) return env;
+	const char* home = std::getenv("HOME");
+	return home ? std::string(home) + "/.gpml_tuning" : std::string();
+}
+
+
+/**	Times candidate parameters for `gemm` on element type `N` and stores the
+	fastest in `gemm_params<N>(s)`. Unroll, kc, nc, mc and the thread count are
+	tuned in that order, each keeping the best value found so far for the rest.
+	Blocked products only; Strassen-Winograd is not timed.
+	@param s - shape class to tune
+	@param size - dimension of the square product to time, 0 uses `default_size(s)`.
+		Sizes from another shape class still store their result for s.
+	@param reps - timed runs per candidate, the fastest of which is kept
+	@return the parameters chosen
+	@throw invalid_argument if reps is 0
+*/
+template<typename N>
+GemmParams tune_gemm(GemmShape s, uint size = 0, uint reps = 3);
+
+/**	Tunes every shape class for element type `N` at its default size.
+	@param reps - timed runs per candidate
+*/
+template<typename N>
+void tune_all(uint reps = 3);
+
+/**	Writes every tuned entry of the supported types to a tuning file, replacing it.
+	@param path - file to write
+	@throw runtime_error if the file cannot be written
+*/
+inline void save(const std::string& path);
+
+/**	Reads a tuning file into `gemm_params`. Lines for unknown types or shapes are
+	skipped. mc, kc, nc and threads must be at most `MAX_TUNING_VALUE` and unroll
+	one of 1, 2, 4 or 8.
+	@param path - file to read
+	@return false if the file cannot be opened
+	@throw runtime_error if a line is malformed or a value is out of range
+*/
+inline bool load(const std::string& path);
+
+/**	Clears every tuned entry so `gemm` falls back to `gemm_params<N>()`. */
+inline void reset();
+
+
+
+// implementation
+
+namespace detail {
+
+// fastest of reps runs of an n x n x n blocked product with p, in seconds
+template<typename N>
+double time_gemm(const GemmParams& p, uint n, uint reps, const N* A, const N* B, N* C) {
+	GemmParams& slot = gemm_params<N>(gemm_shape(n, n, n));
+	GemmParams old = slot;
+	slot = p;
+
+	double best = 0;
+	try {
+		for (uint r = 0; r < reps; ++r) {
+			std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			math::detail::gemm_blocked(n, n, n, N(1), A, n, B, n, N(), C, n);
+			double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			if (r == 0 || t < best) best = t;
+		}
+	} catch (...) {
+		slot = old;
+		throw;
+	}
+	slot = old;
+	return best;
+}
+
+// tries each value of one field of best, keeping whichever is fastest
+template<typename N>
+void tune_field(GemmParams& best, double& best_time, uint GemmParams::*field, const std::vector<uint>& values,
+				uint n, uint reps, const N* A, const N* B, N* C) {
+	for (ul i = 0; i < values.size(); ++i) {
+		if (values[i] == best.*field) continue;
+		GemmParams p = best;
+		p.*field = values[i];
+		double t = time_gemm(p, n, reps, A, B, C);
+		if (t < best_time) {
+			best = p;
+			best_time = t;
+		}
+	}
+}
+
+template<typename N>
+void save_type(std::ofstream& out) {
+	for (uint s = 0; s < GEMM_SHAPES; ++s) {
+		const GemmParams& p = gemm_params<N>(static_cast<GemmShape>(s));
+		if (p.unroll == 0) continue;
+		out << type_name<N>::get() << " " << shape_name(static_cast<GemmShape>(s)) << " " << p.mc << " " << p.kc
+			<< " " << p.nc << " " << p.unroll << " " << p.threads << "\n";
+	}
+}
+
+template<typename N>
+bool load_type(const std::string& type, GemmShape s, const GemmParams& p) {
+	if (type != type_name<N>::get()) return false;
+	gemm_params<N>(s) = p;
+	return true;
+}
+
+template<typename N>
+void reset_type() {
+	for (uint s = 0; s < GEMM_SHAPES; ++s)
+		gemm_params<N>(static_cast<GemmShape>(s)) = GemmParams();
+}
+
+// reads one field of a tuning line, rejecting negative and oversized values
+inline bool read_value(std::istringstream& ss, uint& out, long lo, long hi) {
+	long v;
+	if (!(ss >> v) || v < lo || v > hi) return false;
+	out = static_cast<uint>(v);
+	return true;
+}
+
+// parses a line that is not blank or a comment into its type, shape and parameters
+inline bool parse_line(std::istringstream& ss, std::string& shape, GemmParams& p) {
+	const long max = MAX_TUNING_VALUE;
+	if (!(ss >> shape) || !read_value(ss, p.mc, 0, max) || !read_value(ss, p.kc, 0, max)
+		|| !read_value(ss, p.nc, 0, max) || !read_value(ss, p.unroll, 1, 8) || !read_value(ss, p.threads, 0, max))
+		return false;
+	if (p.unroll != 1 && p.unroll != 2 && p.unroll != 4 && p.unroll != 8) return false;
+	ss >> std::ws;
+	return ss.eof();
+}
+
+// reads a tuning file, throwing on bad lines if strict and skipping them otherwise
+inline bool read_file(const std::string& path, bool strict) {
+	if (path.empty()) return false;
+	std::ifstream in (path.c_str());
+	if (!in) return false;
+
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream ss (line);
+		std::string type, shape;
+		if (!(ss >> type) || type[0] == '#') continue;
+
+		GemmParams p = GemmParams();
+		if (!parse_line(ss, shape, p)) {
+			if (strict) throw std::runtime_error("malformed line in " + path + ": " + line);
+			continue;
+		}
+
+		for (uint s = 0; s < GEMM_SHAPES; ++s) {
+			if (shape != shape_name(static_cast<GemmShape>(s))) continue;
+			GemmShape gs = static_cast<GemmShape>(s);
+			load_type<float>(type, gs, p) || load_type<double>(type, gs, p)
+				|| load_type<int>(type, gs, p) || load_type<long>(type, gs, p);
+		}
+	}
+	return true;
+}
+
+// loads the default tuning file the first time it is called, never throwing
+inline bool load_default() {
+	static bool loaded = read_file(default_path(), false);
+	return loaded;
+}
+
+// every translation unit including this header triggers the startup load, which only runs once
+static const bool startup_loaded = load_default();
+
+}	// detail
+
+
+template<typename N>
+GemmParams tune_gemm(GemmShape s, uint size, uint reps) {
+	if (reps == 0)
+		throw std::invalid_argument("reps must be positive");
+	uint n = size ? size : default_size(s);
+
+	std::vector<N> A (static_cast<ul>(n) * n), B (static_cast<ul>(n) * n), C (static_cast<ul>(n) * n);
+	for (ul i = 0; i < A.size(); ++i) {
+		A[i] = static_cast<N>(i % 7) - static_cast<N>(3);
+		B[i] = static_cast<N>(i % 5) - static_cast<N>(2);
+	}
+
+	GemmParams best = gemm_params<N>(s);
+	if (best.unroll == 0) best = gemm_params<N>();
+	double best_time = detail::time_gemm(best, n, reps, A.data(), B.data(), C.data());
+
+	uint hw = parallel::num_threads();
+	std::vector<uint> threads (1, 1);
+	for (uint t = 2; t < hw; t *= 2) threads.push_back(t);
+	if (hw > 1) threads.push_back(hw);
+
+	uint unrolls[] = { 1, 2, 4, 8 }, kcs[] = { 64, 128, 256, 512 }, ncs[] = { 64, 128, 256, 512, 1024 }, mcs[] = { 16, 32, 64, 128, 256 };
+	detail::tune_field(best, best_time, &GemmParams::unroll, std::vector<uint>(unrolls, unrolls + 4), n, reps, A.data(), B.data(), C.data());
+	detail::tune_field(best, best_time, &GemmParams::kc, std::vector<uint>(kcs, kcs + 4), n, reps, A.data(), B.data(), C.data());
+	detail::tune_field(best, best_time, &GemmParams::nc, std::vector<uint>(ncs, ncs + 5), n, reps, A.data(), B.data(), C.data());
+	detail::tune_field(best, best_time, &GemmParams::mc, std::vector<uint>(mcs, mcs + 5), n, reps, A.data(), B.data(), C.data());
+	detail::tune_field(best, best_time, &GemmParams::threads, threads, n, reps, A.data(), B.data(), C.data());
+
+	// the thread count is stored relative to the tuning host only when it limits the product
+	if (best.threads == hw) best.threads = 0;
+	gemm_params<N>(s) = best;
+	return best;
+}
+
+template<typename N>
+void tune_all(uint reps) {
+	for (uint s = 0; s < GEMM_SHAPES; ++s)
+		tune_gemm<N>(static_cast<GemmShape>(s), 0, reps);
+}
+
+inline void save(const std::string& path) {
+	std::ofstream out (path.c_str());
+	if (!out)
+		throw std::runtime_error("cannot write " + path);
+
+	out << "# GPML gemm tuning: type shape mc kc nc unroll threads\n";
+	detail::save_type<float>(out);
+	detail::save_type<double>(out);
+	detail::save_type<int>(out);
+	detail::save_type<long>(out);
+
+	if (!out)
+		throw std::runtime_error("cannot write " + path);
+}
+
+inline bool load(const std::string& path) {
+	return detail::read_file(path, true);
+}
+
+inline void reset() {
+	detail::reset_type<float>();
+	detail::reset_type<double>();
+	detail::reset_type<int>();
+	detail::reset_type<long>();
+}
+
+}	// autotune
+}	// math
+
+#endif
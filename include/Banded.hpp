@@ -0,0 +1,468 @@
+/** @file Banded.hpp
+	Contains general banded and tridiagonal matrices, the banded matrix-vector
+	product gbmv and solvers that run in O(n * bandwidth^2) and O(n).
+
+	A band matrix with kl sub- and ku superdiagonals stores kl + ku + 1 entries per
+	row, so row r covers columns r - kl through r + ku and is contiguous in memory.
+	There is no separate symmetric band type: a symmetric band matrix is held as a
+	BandMatrix with kl = ku and goes through gbmv and band_solve. That keeps both
+	triangles, about twice the memory of storing one, in exchange for a single
+	kernel and solver.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _BANDED_H_
+#define _BANDED_H_
+
+#include <vector>		// vector
+#include <algorithm>	// swap, min, copy
+#include <cmath>		// fabs
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix
+#include "Vector.hpp"	// Vector, dot_kernel, axpy_kernel
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief rows x cols matrix with kl subdiagonals and ku superdiagonals. Element
+	(r, c) with `r - kl <= c <= r + ku` lives at `r * (kl + ku + 1) + c - r + kl`;
+	slots that fall outside the matrix at the corners are kept at zero.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class BandMatrix {
+	public:
+		/** Creates a band matrix with every entry of the band set to fill.
+			@param rows - number of rows
+			@param cols - number of columns
+			@param kl - number of subdiagonals
+			@param ku - number of superdiagonals
+			@param fill - default value for the band
+		*/
+		BandMatrix(uint rows, uint cols, uint kl, uint ku, const N& fill);
+
+		/** Copies the band of a dense matrix. Entries outside it are not read.
+			@param m - matrix to copy from
+			@param kl - number of subdiagonals
+			@param ku - number of superdiagonals
+		*/
+		BandMatrix(const Matrix<N>& m, uint kl, uint ku);
+
+		/** Get element r, c; zero outside the band.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Set element r, c inside the band.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r, c is out of range or outside the band
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Unchecked access to element r, c inside the band. */
+		N& operator()(uint r, uint c) { return _data[index(r, c)]; }
+
+		/** Unchecked access to element r, c inside the band. */
+		const N& operator()(uint r, uint c) const { return _data[index(r, c)]; }
+
+		/** Get the number of rows. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _cols; }
+
+		/** Get the number of subdiagonals. */
+		uint kl() const { return _kl; }
+
+		/** Get the number of superdiagonals. */
+		uint ku() const { return _ku; }
+
+		/** Get the band storage, rows() * (kl() + ku() + 1) elements. */
+		N* data() { return _data.data(); }
+
+		/** Get the band storage, rows() * (kl() + ku() + 1) elements. */
+		const N* data() const { return _data.data(); }
+
+		/** Expands to a dense matrix with zeros outside the band.
+			@return a new rows x cols Matrix
+		*/
+		Matrix<N> dense() const;
+
+	private:
+		ul index(uint r, uint c) const { return static_cast<ul>(r) * (_kl + _ku + 1) + c + _kl - r; }
+		bool in_band(uint r, uint c) const { return c + _kl >= r && c <= static_cast<ul>(r) + _ku; }
+
+		uint _rows;				/**<number of rows*/
+		uint _cols;				/**<number of columns*/
+		uint _kl;				/**<number of subdiagonals*/
+		uint _ku;				/**<number of superdiagonals*/
+		std::vector<N> _data;	/**<band rows, kl + ku + 1 per row*/
+};
+
+
+/** @brief n x n tridiagonal matrix stored as three diagonals.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class TridiagonalMatrix {
+	public:
+		/** Creates an n x n tridiagonal matrix with all three diagonals set to fill.
+			@param n - number of rows and columns
+			@param fill - default value for the diagonals
+		*/
+		TridiagonalMatrix(uint n, const N& fill);
+
+		/** Get element r, c; zero off the three diagonals.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Set element r, c on one of the three diagonals.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r, c is out of range or off the diagonals
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Get the subdiagonal, n - 1 entries; entry i is element (i + 1, i). */
+		std::vector<N>& lower() { return _lower; }
+
+		/** Get the subdiagonal, n - 1 entries; entry i is element (i + 1, i). */
+		const std::vector<N>& lower() const { return _lower; }
+
+		/** Get the diagonal, n entries. */
+		std::vector<N>& diag() { return _diag; }
+
+		/** Get the diagonal, n entries. */
+		const std::vector<N>& diag() const { return _diag; }
+
+		/** Get the superdiagonal, n - 1 entries; entry i is element (i, i + 1). */
+		std::vector<N>& upper() { return _upper; }
+
+		/** Get the superdiagonal, n - 1 entries; entry i is element (i, i + 1). */
+		const std::vector<N>& upper() const { return _upper; }
+
+		/** Get the number of rows. */
+		uint rows() const { return static_cast<uint>(_diag.size()); }
+
+		/** Get the number of columns. */
+		uint cols() const { return static_cast<uint>(_diag.size()); }
+
+		/** Expands to a dense matrix.
+			@return a new n x n Matrix
+		*/
+		Matrix<N> dense() const;
+
+	private:
+		std::vector<N> _lower;	/**<subdiagonal*/
+		std::vector<N> _diag;	/**<diagonal*/
+		std::vector<N> _upper;	/**<superdiagonal*/
+};
+
+
+/**	Computes `y = alpha * A * x + beta * y` for band A.
+	@param alpha - scale applied to `A * x`
+	@param A - rows x cols band matrix
+	@param x - vector of size cols
+	@param beta - scale applied to y first. When zero y is not read.
+	@param y - vector of size rows updated in place
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void gbmv(const N& alpha, const BandMatrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y);
+
+/**	Solves `A x = b` for square band A by Gaussian elimination with partial
+	pivoting. Pivoting widens the upper band to kl + ku, so the work is
+	O(n * kl * (kl + ku)) and the scratch space O(n * (2 kl + ku + 1)).
+	@param A - n x n band matrix
+	@param b - right hand side of size n
+	@return x
+	@throw invalid_argument if A is not square, the sizes do not agree or A is singular
+*/
+template<typename N>
+Vector<N> band_solve(const BandMatrix<N>& A, const Vector<N>& b);
+
+/**	Solves `T x = b` with the Thomas algorithm in O(n). There is no pivoting, so it
+	is meant for diagonally dominant or symmetric positive definite systems; use
+	`band_solve` with kl = ku = 1 otherwise.
+	@param T - n x n tridiagonal matrix
+	@param b - right hand side of size n
+	@return x
+	@throw invalid_argument if the sizes do not agree or a zero pivot is met
+*/
+template<typename N>
+Vector<N> tridiagonal_solve(const TridiagonalMatrix<N>& T, const Vector<N>& b);
+
+/**	Band matrix-vector product.
+	@param lhs - rows x cols band matrix
+	@param rhs - vector of size cols
+	@return a new vector `lhs * rhs`
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+Vector<N> operator*(const BandMatrix<N>& lhs, const Vector<N>& rhs);
+
+/**	Tridiagonal matrix-vector product.
+	@param lhs - n x n tridiagonal matrix
+	@param rhs - vector of size n
+	@return a new vector `lhs * rhs`
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+Vector<N> operator*(const TridiagonalMatrix<N>& lhs, const Vector<N>& rhs);
+
+
+/** double precision band matrix */
+typedef BandMatrix<double> dBandMatrix;
+/** double precision tridiagonal matrix */
+typedef TridiagonalMatrix<double> dTridiagonalMatrix;
+
+
+
+// implementation
+
+
+template<typename N>
+BandMatrix<N>::BandMatrix(uint rows, uint cols, uint kl, uint ku, const N& fill)
+	: _rows(rows), _cols(cols), _kl(kl), _ku(ku), _data(static_cast<ul>(rows) * (kl + ku + 1), N()) {
+	for (uint r = 0; r < rows; ++r) {
+		uint c0 = (r > kl) ? r - kl : 0;
+		ul c1 = std::min(static_cast<ul>(cols), static_cast<ul>(r) + ku + 1);
+		for (ul c = c0; c < c1; ++c) _data[index(r, static_cast<uint>(c))] = fill;
+	}
+}
+
+template<typename N>
+BandMatrix<N>::BandMatrix(const Matrix<N>& m, uint kl, uint ku)
+	: _rows(m.rows()), _cols(m.cols()), _kl(kl), _ku(ku), _data(static_cast<ul>(m.rows()) * (kl + ku + 1), N()) {
+	for (uint r = 0; r < _rows; ++r) {
+		uint c0 = (r > kl) ? r - kl : 0;
+		ul c1 = std::min(static_cast<ul>(_cols), static_cast<ul>(r) + ku + 1);
+		for (ul c = c0; c < c1; ++c) _data[index(r, static_cast<uint>(c))] = m(r, static_cast<uint>(c));
+	}
+}
+
+template<typename N>
+N BandMatrix<N>::at(uint r, uint c) const {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	return in_band(r, c) ? _data[index(r, c)] : N();
+}
+
+template<typename N>
+void BandMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+	if (!in_band(r, c))
+		throw std::invalid_argument("element is outside the band");
+
+	_data[index(r, c)] = val;
+}
+
+template<typename N>
+Matrix<N> BandMatrix<N>::dense() const {
+	Matrix<N> m (_rows, _cols, N());
+	for (uint r = 0; r < _rows; ++r) {
+		uint c0 = (r > _kl) ? r - _kl : 0;
+		ul c1 = std::min(static_cast<ul>(_cols), static_cast<ul>(r) + _ku + 1);
+		for (ul c = c0; c < c1; ++c) m(r, static_cast<uint>(c)) = _data[index(r, static_cast<uint>(c))];
+	}
+	return m;
+}
+
+
+template<typename N>
+TridiagonalMatrix<N>::TridiagonalMatrix(uint n, const N& fill)
+	: _lower(n ? n - 1 : 0, fill), _diag(n, fill), _upper(n ? n - 1 : 0, fill) {}
+
+template<typename N>
+N TridiagonalMatrix<N>::at(uint r, uint c) const {
+	if (r >= rows())
+		throw std::invalid_argument("row out of range");
+	if (c >= cols())
+		throw std::invalid_argument("column out of range");
+
+	if (r == c) return _diag[r];
+	if (r == c + 1) return _lower[c];
+	if (c == r + 1) return _upper[r];
+	return N();
+}
+
+template<typename N>
+void TridiagonalMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= rows())
+		throw std::invalid_argument("row out of range");
+	if (c >= cols())
+		throw std::invalid_argument("column out of range");
+
+	if (r == c) _diag[r] = val;
+	else if (r == c + 1) _lower[c] = val;
+	else if (c == r + 1) _upper[r] = val;
+	else throw std::invalid_argument("element is off the three diagonals");
+}
+
+template<typename N>
+Matrix<N> TridiagonalMatrix<N>::dense() const {
+	uint n = rows();
+	Matrix<N> m (n, n, N());
+	for (uint i = 0; i < n; ++i) {
+		m(i, i) = _diag[i];
+		if (i + 1 < n) {
+			m(i + 1, i) = _lower[i];
+			m(i, i + 1) = _upper[i];
+		}
+	}
+	return m;
+}
+
+
+template<typename N>
+void gbmv(const N& alpha, const BandMatrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y) {
+	if (x.size() != A.cols() || y.size() != A.rows())
+		throw std::invalid_argument("vector sizes do not match matrix shape");
+
+	uint cols = A.cols(), kl = A.kl(), ku = A.ku();
+	ul w = static_cast<ul>(kl) + ku + 1;
+	const N* a = A.data();
+	const N* xp = x.data();
+	N* yp = y.data();
+	N al = alpha, be = beta;
+
+	parallel::parallel_for(0, A.rows(), [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r) {
+			ul c0 = (r > kl) ? r - kl : 0;
+			ul c1 = std::min(static_cast<ul>(cols), r + ku + 1);
+			N s = (c1 > c0) ? detail::dot_kernel(a + r * w + (c0 + kl - r), xp + c0, c1 - c0) : N();
+			yp[r] = (be == N()) ? al * s : al * s + be * yp[r];
+		}
+	}, parallel::threshold() / w ? parallel::threshold() / w : 1);
+}
+
+template<typename N>
+Vector<N> band_solve(const BandMatrix<N>& A, const Vector<N>& b) {
+	uint n = A.rows();
+	if (A.cols() != n)
+		throw std::invalid_argument("band solve needs a square matrix");
+	if (b.size() != n)
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	// row r of the work band covers columns r - kl through r + kl + ku
+	uint kl = A.kl(), ku = A.ku();
+	ul aw = static_cast<ul>(kl) + ku + 1, w = aw + kl;
+	std::vector<N> band (static_cast<ul>(n) * w, N());
+	for (uint r = 0; r < n; ++r)
+		std::copy(A.data() + r * aw, A.data() + (r + 1) * aw, band.begin() + r * w);
+
+	N* a = band.data();
+	Vector<N> x (b);
+	N* xp = x.data();
+	for (uint j = 0; j < n; ++j) {
+		uint last = std::min(static_cast<ul>(n) - 1, static_cast<ul>(j) + kl);
+		uint right = std::min(static_cast<ul>(n) - 1, static_cast<ul>(j) + kl + ku);
+
+		uint p = j;
+		double best = std::fabs(static_cast<double>(a[j * w + kl]));
+		for (uint i = j + 1; i <= last; ++i) {
+			double v = std::fabs(static_cast<double>(a[i * w + (j + kl - i)]));
+			if (v > best) { best = v; p = i; }
+		}
+		if (best == 0.0)
+			throw std::invalid_argument("matrix is singular");
+
+		// rows use different offsets, so the active columns are swapped one by one
+		if (p != j) {
+			for (uint c = j; c <= right; ++c) std::swap(a[j * w + (c + kl - j)], a[p * w + (c + kl - p)]);
+			std::swap(xp[j], xp[p]);
+		}
+
+		const N* pivot_row = a + j * w + kl;
+		for (uint i = j + 1; i <= last; ++i) {
+			N* row = a + i * w + (j + kl - i);
+			N l = row[0] / pivot_row[0];
+			detail::axpy_kernel(-l, pivot_row + 1, row + 1, right - j);
+			xp[i] -= l * xp[j];
+		}
+	}
+
+	for (uint i = n; i-- > 0; ) {
+		const N* row = a + static_cast<ul>(i) * w + kl;
+		uint right = std::min(static_cast<ul>(n) - 1, static_cast<ul>(i) + kl + ku);
+		xp[i] = (xp[i] - detail::dot_kernel(row + 1, xp + i + 1, right - i)) / row[0];
+	}
+	return x;
+}
+
+template<typename N>
+Vector<N> tridiagonal_solve(const TridiagonalMatrix<N>& T, const Vector<N>& b) {
+	uint n = T.rows();
+	if (b.size() != n)
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	const std::vector<N>& lo = T.lower();
+	const std::vector<N>& d = T.diag();
+	const std::vector<N>& up = T.upper();
+	std::vector<N> c (n, N());
+	Vector<N> x (b);
+	N* xp = x.data();
+
+	// forward sweep: c holds the modified superdiagonal, x the modified right hand side
+	for (uint i = 0; i < n; ++i) {
+		N m = (i == 0) ? d[0] : d[i] - lo[i - 1] * c[i - 1];
+		if (m == N())
+			throw std::invalid_argument("zero pivot in tridiagonal solve");
+		if (i + 1 < n) c[i] = up[i] / m;
+		xp[i] = (i == 0) ? xp[0] / m : (xp[i] - lo[i - 1] * xp[i - 1]) / m;
+	}
+	for (uint i = n ? n - 1 : 0; i-- > 0; ) xp[i] -= c[i] * xp[i + 1];
+	return x;
+}
+
+template<typename N>
+Vector<N> operator*(const BandMatrix<N>& lhs, const Vector<N>& rhs) {
+	Vector<N> result (lhs.rows(), N());
+	gbmv(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+template<typename N>
+Vector<N> operator*(const TridiagonalMatrix<N>& lhs, const Vector<N>& rhs) {
+	uint n = lhs.rows();
+	if (rhs.size() != n)
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	Vector<N> result (n, N());
+	const std::vector<N>& lo = lhs.lower();
+	const std::vector<N>& d = lhs.diag();
+	const std::vector<N>& up = lhs.upper();
+	for (uint i = 0; i < n; ++i) {
+		N s = d[i] * rhs[i];
+		if (i > 0) s += lo[i - 1] * rhs[i - 1];
+		if (i + 1 < n) s += up[i] * rhs[i + 1];
+		result[i] = s;
+	}
+	return result;
+}
+
+}	// math
+
+#endif
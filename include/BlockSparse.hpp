@@ -0,0 +1,347 @@
+/** @file BlockSparse.hpp
+	Contains the block compressed sparse row (BSR) matrix and its products with
+	dense vectors and matrices.
+
+	Nonzeros are grouped into dense bs x bs blocks. Only one column index is kept
+	per block and every block is stored row-major and contiguous, so the products
+	run the dense gemm micro-kernel and dot kernel on each block instead of
+	walking scalar indices. Block rows are split across the thread pool; each one
+	owns its slice of the output.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _BLOCK_SPARSE_H_
+#define _BLOCK_SPARSE_H_
+
+#include <vector>		// vector
+#include <algorithm>	// sort, copy, fill
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix
+#include "Vector.hpp"	// Vector, dot_kernel
+#include "Gemm.hpp"		// detail::gemm_rows
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief Sparse matrix made of dense bs x bs blocks. Block row i owns blocks
+	`row_ptr()[i]` up to `row_ptr()[i + 1]`; block j sits at block column
+	`col_idx()[j]` and its values start at `values() + j * bs * bs`.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class BSRMatrix {
+	public:
+		/** Creates an empty rows x cols matrix with no stored blocks.
+			@param rows - number of rows, a multiple of bs
+			@param cols - number of columns, a multiple of bs
+			@param bs - block size
+			@throw invalid_argument if bs is 0 or does not divide rows and cols
+		*/
+		BSRMatrix(uint rows, uint cols, uint bs);
+
+		/** Stores every bs x bs block of m that has a nonzero entry.
+			@param m - dense matrix
+			@param bs - block size
+			@throw invalid_argument if bs is 0 or does not divide the shape of m
+		*/
+		BSRMatrix(const Matrix<N>& m, uint bs);
+
+		/** Builds a BSR matrix from coordinate triplets. Duplicates are summed.
+			@param rows - number of rows, a multiple of bs
+			@param cols - number of columns, a multiple of bs
+			@param bs - block size
+			@param r - row of every entry
+			@param c - column of every entry
+			@param v - value of every entry
+			@return the BSR matrix
+			@throw invalid_argument if the triplets differ in length, an entry is out
+				of range or bs does not divide the shape
+		*/
+		static BSRMatrix from_coo(uint rows, uint cols, uint bs, const std::vector<uint>& r,
+			const std::vector<uint>& c, const std::vector<N>& v);
+
+		/** Get element r, c; zero outside the stored blocks.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Get the number of rows. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _cols; }
+
+		/** Get the block size. */
+		uint block_size() const { return _bs; }
+
+		/** Get the number of stored blocks. */
+		uint blocks() const { return static_cast<uint>(_col_idx.size()); }
+
+		/** Get the offsets of each block row into `col_idx()`, rows() / bs + 1 entries. */
+		const std::vector<uint>& row_ptr() const { return _row_ptr; }
+
+		/** Get the block column of every stored block. */
+		const std::vector<uint>& col_idx() const { return _col_idx; }
+
+		/** Get the values of the stored blocks, bs * bs per block, row-major. */
+		N* values() { return _values.data(); }
+
+		/** Get the values of the stored blocks, bs * bs per block, row-major. */
+		const N* values() const { return _values.data(); }
+
+		/** Expands to a dense matrix.
+			@return a new rows x cols Matrix
+		*/
+		Matrix<N> dense() const;
+
+	private:
+		uint _rows;					/**<number of rows*/
+		uint _cols;					/**<number of columns*/
+		uint _bs;					/**<block size*/
+		std::vector<uint> _row_ptr;	/**<first block of each block row*/
+		std::vector<uint> _col_idx;	/**<block column of each block*/
+		std::vector<N> _values;		/**<dense blocks, bs * bs each*/
+};
+
+
+/**	Computes `y = alpha * A * x + beta * y` for BSR A.
+	@param alpha - scale applied to `A * x`
+	@param A - rows x cols BSR matrix
+	@param x - vector of size cols
+	@param beta - scale applied to y first. When zero y is not read.
+	@param y - vector of size rows updated in place
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void bsrmv(const N& alpha, const BSRMatrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y);
+
+/**	Computes `C = alpha * A * B + beta * C` for BSR A and dense B and C.
+	@param alpha - scale applied to `A * B`
+	@param A - m x k BSR matrix
+	@param B - k x n matrix
+	@param beta - scale applied to C first. When zero C is not read.
+	@param C - m x n matrix updated in place
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void bsrmm(const N& alpha, const BSRMatrix<N>& A, const Matrix<N>& B, const N& beta, Matrix<N>& C);
+
+/**	BSR matrix-vector product.
+	@param lhs - rows x cols BSR matrix
+	@param rhs - vector of size cols
+	@return a new vector `lhs * rhs`
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+Vector<N> operator*(const BSRMatrix<N>& lhs, const Vector<N>& rhs);
+
+/**	BSR times dense matrix product.
+	@param lhs - m x k BSR matrix
+	@param rhs - k x n matrix
+	@return a new m x n matrix `lhs * rhs`
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+Matrix<N> operator*(const BSRMatrix<N>& lhs, const Matrix<N>& rhs);
+
+
+/** double precision BSR matrix */
+typedef BSRMatrix<double> dBSRMatrix;
+/** single precision BSR matrix */
+typedef BSRMatrix<float> fBSRMatrix;
+
+
+
+// implementation
+
+
+template<typename N>
+BSRMatrix<N>::BSRMatrix(uint rows, uint cols, uint bs) : _rows(rows), _cols(cols), _bs(bs) {
+	if (bs == 0 || rows % bs != 0 || cols % bs != 0)
+		throw std::invalid_argument("block size must divide the matrix shape");
+
+	_row_ptr.assign(rows / bs + 1, 0);
+}
+
+template<typename N>
+BSRMatrix<N>::BSRMatrix(const Matrix<N>& m, uint bs) : BSRMatrix(m.rows(), m.cols(), bs) {
+	uint cols = m.cols();
+	for (uint br = 0; br < _rows / bs; ++br) {
+		for (uint bc = 0; bc < cols / bs; ++bc) {
+			const N* src = m.data() + static_cast<ul>(br) * bs * cols + static_cast<ul>(bc) * bs;
+			bool nonzero = false;
+			for (uint i = 0; i < bs && !nonzero; ++i)
+				for (uint j = 0; j < bs && !nonzero; ++j) nonzero = src[static_cast<ul>(i) * cols + j] != N();
+			if (!nonzero) continue;
+
+			_col_idx.push_back(bc);
+			for (uint i = 0; i < bs; ++i)
+				_values.insert(_values.end(), src + static_cast<ul>(i) * cols, src + static_cast<ul>(i) * cols + bs);
+		}
+		_row_ptr[br + 1] = static_cast<uint>(_col_idx.size());
+	}
+}
+
+template<typename N>
+BSRMatrix<N> BSRMatrix<N>::from_coo(uint rows, uint cols, uint bs, const std::vector<uint>& r,
+	const std::vector<uint>& c, const std::vector<N>& v) {
+	if (r.size() != c.size() || r.size() != v.size())
+		throw std::invalid_argument("coordinate arrays differ in length");
+
+	BSRMatrix<N> A (rows, cols, bs);
+	uint nbr = rows / bs;
+
+	// every distinct (block row, block column) pair becomes one stored block
+	std::vector<std::vector<uint> > row_blocks (nbr);
+	for (ul i = 0; i < r.size(); ++i) {
+		if (r[i] >= rows || c[i] >= cols)
+			throw std::invalid_argument("coordinate out of range");
+		row_blocks[r[i] / bs].push_back(c[i] / bs);
+	}
+	for (uint br = 0; br < nbr; ++br) {
+		std::vector<uint>& b = row_blocks[br];
+		std::sort(b.begin(), b.end());
+		b.erase(std::unique(b.begin(), b.end()), b.end());
+		A._col_idx.insert(A._col_idx.end(), b.begin(), b.end());
+		A._row_ptr[br + 1] = static_cast<uint>(A._col_idx.size());
+	}
+
+	ul bb = static_cast<ul>(bs) * bs;
+	A._values.assign(A._col_idx.size() * bb, N());
+	for (ul i = 0; i < r.size(); ++i) {
+		uint br = r[i] / bs;
+		std::vector<uint>::const_iterator it = std::lower_bound(A._col_idx.begin() + A._row_ptr[br],
+			A._col_idx.begin() + A._row_ptr[br + 1], c[i] / bs);
+		ul j = static_cast<ul>(it - A._col_idx.begin());
+		A._values[j * bb + (r[i] % bs) * bs + c[i] % bs] += v[i];
+	}
+	return A;
+}
+
+template<typename N>
+N BSRMatrix<N>::at(uint r, uint c) const {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	uint br = r / _bs;
+	std::vector<uint>::const_iterator first = _col_idx.begin() + _row_ptr[br];
+	std::vector<uint>::const_iterator last = _col_idx.begin() + _row_ptr[br + 1];
+	std::vector<uint>::const_iterator it = std::lower_bound(first, last, c / _bs);
+	if (it == last || *it != c / _bs) return N();
+
+	ul j = static_cast<ul>(it - _col_idx.begin());
+	return _values[j * _bs * _bs + (r % _bs) * _bs + c % _bs];
+}
+
+template<typename N>
+Matrix<N> BSRMatrix<N>::dense() const {
+	Matrix<N> m (_rows, _cols, N());
+	ul bb = static_cast<ul>(_bs) * _bs;
+	for (uint br = 0; br < _rows / _bs; ++br) {
+		for (uint j = _row_ptr[br]; j < _row_ptr[br + 1]; ++j) {
+			N* dst = m.data() + static_cast<ul>(br) * _bs * _cols + static_cast<ul>(_col_idx[j]) * _bs;
+			for (uint i = 0; i < _bs; ++i)
+				std::copy(_values.begin() + j * bb + i * _bs, _values.begin() + j * bb + (i + 1) * _bs, dst + static_cast<ul>(i) * _cols);
+		}
+	}
+	return m;
+}
+
+
+namespace detail {
+
+// grain in block rows so each task touches about threshold() stored values
+template<typename N>
+inline ul bsr_grain(const BSRMatrix<N>& A, ul per_value) {
+	ul work = static_cast<ul>(A.blocks()) * A.block_size() * A.block_size() * per_value;
+	ul block_rows = A.rows() / A.block_size();
+	ul grain = (work && block_rows) ? parallel::threshold() * block_rows / work : block_rows;
+	return grain ? grain : 1;
+}
+
+}	// detail
+
+
+template<typename N>
+void bsrmv(const N& alpha, const BSRMatrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y) {
+	if (x.size() != A.cols() || y.size() != A.rows())
+		throw std::invalid_argument("vector sizes do not match matrix shape");
+
+	uint bs = A.block_size();
+	ul bb = static_cast<ul>(bs) * bs;
+	const uint* rp = A.row_ptr().data();
+	const uint* ci = A.col_idx().data();
+	const N* a = A.values();
+	const N* xp = x.data();
+	N* yp = y.data();
+	N al = alpha, be = beta;
+
+	parallel::parallel_for(0, A.rows() / bs, [=](ul lo, ul hi) {
+		std::vector<N> acc (bs);
+		for (ul br = lo; br < hi; ++br) {
+			std::fill(acc.begin(), acc.end(), N());
+			for (uint j = rp[br]; j < rp[br + 1]; ++j) {
+				const N* blk = a + j * bb;
+				const N* xb = xp + static_cast<ul>(ci[j]) * bs;
+				for (uint i = 0; i < bs; ++i) acc[i] += detail::dot_kernel(blk + static_cast<ul>(i) * bs, xb, bs);
+			}
+			N* yb = yp + br * bs;
+			for (uint i = 0; i < bs; ++i) yb[i] = (be == N()) ? al * acc[i] : al * acc[i] + be * yb[i];
+		}
+	}, detail::bsr_grain(A, 1));
+}
+
+template<typename N>
+void bsrmm(const N& alpha, const BSRMatrix<N>& A, const Matrix<N>& B, const N& beta, Matrix<N>& C) {
+	if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+		throw std::invalid_argument("matrix shapes do not agree for bsrmm");
+
+	uint bs = A.block_size(), n = B.cols();
+	ul bb = static_cast<ul>(bs) * bs;
+	const uint* rp = A.row_ptr().data();
+	const uint* ci = A.col_idx().data();
+	const N* a = A.values();
+	const N* b = B.data();
+	N* c = C.data();
+	N al = alpha, be = beta;
+
+	// each block is a bs x bs times bs x n micro-gemm into the block row of C
+	parallel::parallel_for(0, A.rows() / bs, [=](ul lo, ul hi) {
+		for (ul br = lo; br < hi; ++br) {
+			N* cb = c + br * bs * n;
+			if (be == N()) std::fill(cb, cb + bs * static_cast<ul>(n), N());
+			else if (be != N(1)) for (ul i = 0; i < bs * static_cast<ul>(n); ++i) cb[i] *= be;
+
+			for (uint j = rp[br]; j < rp[br + 1]; ++j)
+				detail::gemm_rows<N, 4>(0, bs, n, bs, al, a + j * bb, bs, b + static_cast<ul>(ci[j]) * bs * n, n, cb, n);
+		}
+	}, detail::bsr_grain(A, n ? n : 1));
+}
+
+template<typename N>
+Vector<N> operator*(const BSRMatrix<N>& lhs, const Vector<N>& rhs) {
+	Vector<N> result (lhs.rows(), N());
+	bsrmv(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+template<typename N>
+Matrix<N> operator*(const BSRMatrix<N>& lhs, const Matrix<N>& rhs) {
+	Matrix<N> result (lhs.rows(), rhs.cols(), N());
+	bsrmm(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+}	// math
+
+#endif
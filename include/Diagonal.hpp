@@ -0,0 +1,448 @@
+/** @file Diagonal.hpp
+	Contains diagonal and permutation matrices. Both store n values instead of n^2
+	and are applied to dense matrices in O(rows * cols) by scaling or moving whole
+	rows and columns, never through a matrix multiply. Products of two of them are
+	O(n).
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _DIAGONAL_H_
+#define _DIAGONAL_H_
+
+#include <vector>		// vector
+#include <algorithm>	// swap_ranges, copy
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix
+#include "Vector.hpp"	// Vector
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief n x n diagonal matrix stored as its diagonal.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class DiagonalMatrix {
+	public:
+		/** Creates an n x n diagonal matrix with every diagonal entry set to fill.
+			@param n - number of rows and columns
+			@param fill - value of the diagonal
+		*/
+		DiagonalMatrix(uint n, const N& fill) : _diag(n, fill) {}
+
+		/** Creates a diagonal matrix from its diagonal.
+			@param diag - diagonal entries
+		*/
+		explicit DiagonalMatrix(const std::vector<N>& diag) : _diag(diag) {}
+
+		/** Get element r, c; zero off the diagonal.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Unchecked access to diagonal entry i. */
+		N& operator[](uint i) { return _diag[i]; }
+
+		/** Unchecked access to diagonal entry i. */
+		const N& operator[](uint i) const { return _diag[i]; }
+
+		/** Get the number of rows. */
+		uint rows() const { return static_cast<uint>(_diag.size()); }
+
+		/** Get the number of columns. */
+		uint cols() const { return static_cast<uint>(_diag.size()); }
+
+		/** Get the diagonal. */
+		N* data() { return _diag.data(); }
+
+		/** Get the diagonal. */
+		const N* data() const { return _diag.data(); }
+
+		/** Expands to a dense matrix.
+			@return a new n x n Matrix
+		*/
+		Matrix<N> dense() const;
+
+	private:
+		std::vector<N> _diag;	/**<diagonal entries*/
+};
+
+
+/** @brief n x n permutation matrix stored as the column of the one in each row:
+	`P(i, perm[i]) = 1`. Applied from the left it moves row `perm[i]` of a matrix
+	to row i.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class PermutationMatrix {
+	public:
+		/** Creates the n x n identity permutation.
+			@param n - number of rows and columns
+		*/
+		explicit PermutationMatrix(uint n);
+
+		/** Creates a permutation from the column index of each row's one.
+			@param perm - a permutation of 0..n-1
+			@throw invalid_argument if perm is not a permutation
+		*/
+		explicit PermutationMatrix(const std::vector<uint>& perm);
+
+		/** Builds P from the pivots returned by `lu_factor`, so `P A = L U`.
+			@param piv - row i was swapped with row piv[i] at step i
+			@return the permutation
+			@throw invalid_argument if a pivot is out of range
+		*/
+		static PermutationMatrix from_pivots(const std::vector<uint>& piv);
+
+		/** Get element r, c, which is 1 or 0.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		int at(uint r, uint c) const;
+
+		/** Get the column of the one in row i. */
+		uint operator[](uint i) const { return _perm[i]; }
+
+		/** Get the number of rows. */
+		uint rows() const { return static_cast<uint>(_perm.size()); }
+
+		/** Get the number of columns. */
+		uint cols() const { return static_cast<uint>(_perm.size()); }
+
+		/** Get the column of the one in every row. */
+		const std::vector<uint>& indices() const { return _perm; }
+
+		/** Get the inverse permutation, which is also the transpose.
+			@return P^T
+		*/
+		PermutationMatrix inverse() const;
+
+		/** Expands to a dense matrix.
+			@return a new n x n Matrix
+		*/
+		template<typename N>
+		Matrix<N> dense() const;
+
+	private:
+		std::vector<uint> _perm;	/**<column of the one in each row*/
+};
+
+
+/**	Scales row i of A by D[i] in place, `A = D * A`.
+	@param D - n x n diagonal matrix
+	@param A - n x m matrix
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void scale_rows(const DiagonalMatrix<N>& D, Matrix<N>& A);
+
+/**	Scales column j of A by D[j] in place, `A = A * D`.
+	@param A - m x n matrix
+	@param D - n x n diagonal matrix
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void scale_cols(Matrix<N>& A, const DiagonalMatrix<N>& D);
+
+/**	Reorders the rows of A in place, `A = P * A`, by following the cycles of the
+	permutation with whole-row swaps.
+	@param P - n x n permutation matrix
+	@param A - n x m matrix
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void permute_rows(const PermutationMatrix& P, Matrix<N>& A);
+
+/**	Reorders the columns of A in place, `A = A * P`, one row at a time.
+	@param A - m x n matrix
+	@param P - n x n permutation matrix
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void permute_cols(Matrix<N>& A, const PermutationMatrix& P);
+
+/** `D * A`, scaling the rows of a copy of A. */
+template<typename N>
+Matrix<N> operator*(const DiagonalMatrix<N>& lhs, Matrix<N> rhs);
+
+/** `A * D`, scaling the columns of a copy of A. */
+template<typename N>
+Matrix<N> operator*(Matrix<N> lhs, const DiagonalMatrix<N>& rhs);
+
+/** `A = A * D` in place. */
+template<typename N>
+Matrix<N>& operator*=(Matrix<N>& lhs, const DiagonalMatrix<N>& rhs);
+
+/** `D * v`, element-wise product with the diagonal. */
+template<typename N>
+Vector<N> operator*(const DiagonalMatrix<N>& lhs, Vector<N> rhs);
+
+/** `D1 * D2` in O(n). */
+template<typename N>
+DiagonalMatrix<N> operator*(const DiagonalMatrix<N>& lhs, const DiagonalMatrix<N>& rhs);
+
+/** `P * A`, gathering the rows of A into a new matrix. */
+template<typename N>
+Matrix<N> operator*(const PermutationMatrix& lhs, const Matrix<N>& rhs);
+
+/** `A * P`, reordering the columns of a copy of A. */
+template<typename N>
+Matrix<N> operator*(Matrix<N> lhs, const PermutationMatrix& rhs);
+
+/** `A = A * P` in place. */
+template<typename N>
+Matrix<N>& operator*=(Matrix<N>& lhs, const PermutationMatrix& rhs);
+
+/** `P * v`, the entries of v reordered so that entry i is `v[perm[i]]`. */
+template<typename N>
+Vector<N> operator*(const PermutationMatrix& lhs, const Vector<N>& rhs);
+
+/**	`P1 * P2` in O(n).
+	@throw invalid_argument if the sizes do not agree
+*/
+inline PermutationMatrix operator*(const PermutationMatrix& lhs, const PermutationMatrix& rhs);
+
+
+/** double precision diagonal matrix */
+typedef DiagonalMatrix<double> dDiagonalMatrix;
+
+
+
+// implementation
+
+
+template<typename N>
+N DiagonalMatrix<N>::at(uint r, uint c) const {
+	if (r >= rows())
+		throw std::invalid_argument("row out of range");
+	if (c >= cols())
+		throw std::invalid_argument("column out of range");
+
+	return (r == c) ? _diag[r] : N();
+}
+
+template<typename N>
+Matrix<N> DiagonalMatrix<N>::dense() const {
+	Matrix<N> m (rows(), N());
+	for (uint i = 0; i < rows(); ++i) m(i, i) = _diag[i];
+	return m;
+}
+
+
+inline PermutationMatrix::PermutationMatrix(uint n) : _perm(n) {
+	for (uint i = 0; i < n; ++i) _perm[i] = i;
+}
+
+inline PermutationMatrix::PermutationMatrix(const std::vector<uint>& perm) : _perm(perm) {
+	std::vector<bool> seen (perm.size(), false);
+	for (uint i = 0; i < perm.size(); ++i) {
+		if (perm[i] >= perm.size() || seen[perm[i]])
+			throw std::invalid_argument("indices are not a permutation");
+		seen[perm[i]] = true;
+	}
+}
+
+inline PermutationMatrix PermutationMatrix::from_pivots(const std::vector<uint>& piv) {
+	PermutationMatrix P (static_cast<uint>(piv.size()));
+	for (uint i = 0; i < piv.size(); ++i) {
+		if (piv[i] >= piv.size())
+			throw std::invalid_argument("pivot out of range");
+		std::swap(P._perm[i], P._perm[piv[i]]);
+	}
+	return P;
+}
+
+inline int PermutationMatrix::at(uint r, uint c) const {
+	if (r >= rows())
+		throw std::invalid_argument("row out of range");
+	if (c >= cols())
+		throw std::invalid_argument("column out of range");
+
+	return _perm[r] == c ? 1 : 0;
+}
+
+inline PermutationMatrix PermutationMatrix::inverse() const {
+	PermutationMatrix P (rows());
+	for (uint i = 0; i < rows(); ++i) P._perm[_perm[i]] = i;
+	return P;
+}
+
+template<typename N>
+Matrix<N> PermutationMatrix::dense() const {
+	Matrix<N> m (rows(), N());
+	for (uint i = 0; i < rows(); ++i) m(i, _perm[i]) = N(1);
+	return m;
+}
+
+
+template<typename N>
+void scale_rows(const DiagonalMatrix<N>& D, Matrix<N>& A) {
+	if (D.cols() != A.rows())
+		throw std::invalid_argument("diagonal size does not match matrix rows");
+
+	uint cols = A.cols();
+	const N* d = D.data();
+	N* a = A.data();
+	parallel::parallel_for(0, A.rows(), [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r) {
+			N s = d[r];
+			N* row = a + r * cols;
+			for (uint c = 0; c < cols; ++c) row[c] *= s;
+		}
+	}, cols ? (parallel::threshold() / cols ? parallel::threshold() / cols : 1) : 1);
+}
+
+template<typename N>
+void scale_cols(Matrix<N>& A, const DiagonalMatrix<N>& D) {
+	if (A.cols() != D.rows())
+		throw std::invalid_argument("diagonal size does not match matrix columns");
+
+	uint cols = A.cols();
+	const N* d = D.data();
+	N* a = A.data();
+	parallel::parallel_for(0, A.rows(), [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r) {
+			N* row = a + r * cols;
+			for (uint c = 0; c < cols; ++c) row[c] *= d[c];
+		}
+	}, cols ? (parallel::threshold() / cols ? parallel::threshold() / cols : 1) : 1);
+}
+
+template<typename N>
+void permute_rows(const PermutationMatrix& P, Matrix<N>& A) {
+	if (P.cols() != A.rows())
+		throw std::invalid_argument("permutation size does not match matrix rows");
+
+	// row i takes row perm[i]; walking each cycle once moves every row with one swap
+	uint n = A.rows();
+	ul cols = A.cols();
+	N* a = A.data();
+	std::vector<bool> done (n, false);
+	for (uint start = 0; start < n; ++start) {
+		if (done[start]) continue;
+		done[start] = true;
+		for (uint i = start, j = P[start]; j != start; i = j, j = P[j]) {
+			std::swap_ranges(a + i * cols, a + (i + 1) * cols, a + j * cols);
+			done[j] = true;
+		}
+	}
+}
+
+template<typename N>
+void permute_cols(Matrix<N>& A, const PermutationMatrix& P) {
+	if (A.cols() != P.rows())
+		throw std::invalid_argument("permutation size does not match matrix columns");
+
+	// column perm[k] of the result is column k of A
+	uint cols = A.cols();
+	const uint* perm = P.indices().data();
+	N* a = A.data();
+	parallel::parallel_for(0, A.rows(), [=](ul lo, ul hi) {
+		std::vector<N> tmp (cols);
+		for (ul r = lo; r < hi; ++r) {
+			N* row = a + r * cols;
+			for (uint k = 0; k < cols; ++k) tmp[perm[k]] = row[k];
+			std::copy(tmp.begin(), tmp.end(), row);
+		}
+	}, cols ? (parallel::threshold() / cols ? parallel::threshold() / cols : 1) : 1);
+}
+
+template<typename N>
+Matrix<N> operator*(const DiagonalMatrix<N>& lhs, Matrix<N> rhs) {
+	scale_rows(lhs, rhs);
+	return rhs;
+}
+
+template<typename N>
+Matrix<N> operator*(Matrix<N> lhs, const DiagonalMatrix<N>& rhs) {
+	scale_cols(lhs, rhs);
+	return lhs;
+}
+
+template<typename N>
+Matrix<N>& operator*=(Matrix<N>& lhs, const DiagonalMatrix<N>& rhs) {
+	scale_cols(lhs, rhs);
+	return lhs;
+}
+
+template<typename N>
+Vector<N> operator*(const DiagonalMatrix<N>& lhs, Vector<N> rhs) {
+	if (lhs.cols() != rhs.size())
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	for (uint i = 0; i < rhs.size(); ++i) rhs[i] *= lhs[i];
+	return rhs;
+}
+
+template<typename N>
+DiagonalMatrix<N> operator*(const DiagonalMatrix<N>& lhs, const DiagonalMatrix<N>& rhs) {
+	if (lhs.cols() != rhs.rows())
+		throw std::invalid_argument("diagonal sizes do not agree");
+
+	DiagonalMatrix<N> result (lhs.rows(), N());
+	for (uint i = 0; i < lhs.rows(); ++i) result[i] = lhs[i] * rhs[i];
+	return result;
+}
+
+template<typename N>
+Matrix<N> operator*(const PermutationMatrix& lhs, const Matrix<N>& rhs) {
+	if (lhs.cols() != rhs.rows())
+		throw std::invalid_argument("permutation size does not match matrix rows");
+
+	Matrix<N> result (rhs.rows(), rhs.cols(), N());
+	ul cols = rhs.cols();
+	const uint* perm = lhs.indices().data();
+	const N* in = rhs.data();
+	N* out = result.data();
+	parallel::parallel_for(0, rhs.rows(), [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r)
+			std::copy(in + perm[r] * cols, in + (perm[r] + 1) * cols, out + r * cols);
+	}, cols ? (parallel::threshold() / cols ? parallel::threshold() / cols : 1) : 1);
+	return result;
+}
+
+template<typename N>
+Matrix<N> operator*(Matrix<N> lhs, const PermutationMatrix& rhs) {
+	permute_cols(lhs, rhs);
+	return lhs;
+}
+
+template<typename N>
+Matrix<N>& operator*=(Matrix<N>& lhs, const PermutationMatrix& rhs) {
+	permute_cols(lhs, rhs);
+	return lhs;
+}
+
+template<typename N>
+Vector<N> operator*(const PermutationMatrix& lhs, const Vector<N>& rhs) {
+	if (lhs.cols() != rhs.size())
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	Vector<N> result (rhs.size(), N());
+	for (uint i = 0; i < rhs.size(); ++i) result[i] = rhs[lhs[i]];
+	return result;
+}
+
+inline PermutationMatrix operator*(const PermutationMatrix& lhs, const PermutationMatrix& rhs) {
+	if (lhs.cols() != rhs.rows())
+		throw std::invalid_argument("permutation sizes do not agree");
+
+	// (P1 P2)(i, j) = 1 where j = perm2[perm1[i]]
+	std::vector<uint> perm (lhs.rows());
+	for (uint i = 0; i < lhs.rows(); ++i) perm[i] = rhs[lhs[i]];
+	return PermutationMatrix(perm);
+}
+
+}	// math
+
+#endif
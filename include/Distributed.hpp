@@ -0,0 +1,573 @@
+/** @file Distributed.hpp
+	Contains matrices distributed over MPI ranks in a 2D block-cyclic layout,
+	with SUMMA matrix multiplication, transposition, redistribution and
+	reductions.
+
+	The ranks of a communicator form a P x Q `Grid`. A `DistMatrix` is cut into
+	block x block blocks and block (I, J) lives on grid process (I mod P, J mod Q),
+	the layout ScaLAPACK uses. Each rank keeps its blocks in one row-major local
+	`Matrix`, so local work goes through the ordinary kernels.
+
+	`summa` broadcasts one block column of A along each process row and one
+	block row of B along each process column per step, and updates the local
+	part of C with `gemm`. The broadcasts for the next step are posted before
+	the local update, so communication overlaps computation. Transposition and
+	redistribution exchange elements with one `MPI_Alltoallv`, in an order both
+	sides can derive, so no indices are sent.
+
+	This header needs `mpi.h`; build with `mpicxx` and call MPI_Init before
+	creating a Grid. Every function here is collective over the grid. Element
+	types must have an `mpi_type` specialization.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _DISTRIBUTED_H_
+#define _DISTRIBUTED_H_
+
+#include <mpi.h>		// MPI_Comm, collectives
+#include <vector>		// vector
+#include <memory>		// shared_ptr, make_shared
+#include <limits>		// numeric_limits
+#include <algorithm>	// copy, fill, min
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix
+#include "Gemm.hpp"		// gemm
+#include "Trace.hpp"	// GPML_TRACE_SPAN
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+namespace dist {
+
+/** @brief MPI datatype of an element type. */
+template<typename N> struct mpi_type;
+template<> struct mpi_type<float> { static MPI_Datatype get() { return MPI_FLOAT; } };
+template<> struct mpi_type<double> { static MPI_Datatype get() { return MPI_DOUBLE; } };
+template<> struct mpi_type<int> { static MPI_Datatype get() { return MPI_INT; } };
+template<> struct mpi_type<long> { static MPI_Datatype get() { return MPI_LONG; } };
+
+
+namespace detail {
+
+// communicators of a grid, freed with the last Grid that uses them
+struct GridComms {
+	MPI_Comm all, row, col;
+
+	GridComms() : all(MPI_COMM_NULL), row(MPI_COMM_NULL), col(MPI_COMM_NULL) {}
+
+	~GridComms() {
+		int finalized = 0;
+		MPI_Finalized(&finalized);
+		if (finalized) return;
+		if (row != MPI_COMM_NULL) MPI_Comm_free(&row);
+		if (col != MPI_COMM_NULL) MPI_Comm_free(&col);
+		if (all != MPI_COMM_NULL) MPI_Comm_free(&all);
+	}
+};
+
+}	// detail
+
+
+/** @brief P x Q arrangement of the ranks of a communicator, in row-major rank
+	order. Copies share the same communicators, which must all be destroyed
+	before MPI_Finalize.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class Grid {
+	public:
+		/** Collectively creates a grid over a duplicate of comm.
+			@param comm - communicator whose ranks form the grid
+			@param prows - process rows P, which must divide the number of ranks.
+				0 picks the largest divisor not above its square root.
+			@throw invalid_argument if prows does not divide the number of ranks
+		*/
+		explicit Grid(MPI_Comm comm = MPI_COMM_WORLD, int prows = 0);
+
+		/** Get the rank of the calling process in the grid. */
+		int rank() const { return _rank; }
+
+		/** Get the number of processes. */
+		int size() const { return _p * _q; }
+
+		/** Get the number of process rows P. */
+		int prows() const { return _p; }
+
+		/** Get the number of process columns Q. */
+		int pcols() const { return _q; }
+
+		/** Get the process row of the calling process. */
+		int myrow() const { return _rank / _q; }
+
+		/** Get the process column of the calling process. */
+		int mycol() const { return _rank % _q; }
+
+		/** Get the rank of the process at grid position pr, pc. */
+		int rank_of(int pr, int pc) const { return pr * _q + pc; }
+
+		/** Get the communicator over every process of the grid. */
+		MPI_Comm comm() const { return _comms->all; }
+
+		/** Get the communicator over the calling process's grid row, ranked by column. */
+		MPI_Comm row_comm() const { return _comms->row; }
+
+		/** Get the communicator over the calling process's grid column, ranked by row. */
+		MPI_Comm col_comm() const { return _comms->col; }
+
+		/** Get whether two grids are copies of one another. */
+		bool operator==(const Grid& g) const { return _comms == g._comms; }
+
+	private:
+		std::shared_ptr<detail::GridComms> _comms;	/**<communicators shared by copies*/
+		int _rank;									/**<rank in comm()*/
+		int _p;										/**<process rows*/
+		int _q;										/**<process columns*/
+};
+
+
+/** @brief rows x cols matrix distributed block-cyclically over a Grid.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class DistMatrix {
+	public:
+		/** Collectively creates a distributed matrix with every element set to fill.
+			@param grid - process grid
+			@param rows - number of rows
+			@param cols - number of columns
+			@param block - edge length of the distribution blocks
+			@param fill - value of every element
+			@throw invalid_argument if block is 0
+		*/
+		DistMatrix(const Grid& grid, uint rows, uint cols, uint block, const N& fill);
+
+		/** Collectively distributes a matrix held by one rank.
+			@param grid - process grid
+			@param m - matrix to distribute, only read on root
+			@param block - edge length of the distribution blocks
+			@param root - rank in the grid holding m
+			@throw invalid_argument if block is 0
+		*/
+		DistMatrix(const Grid& grid, const Matrix<N>& m, uint block, int root = 0);
+
+		/** Collectively collects the whole matrix on one rank.
+			@param root - rank in the grid receiving the matrix
+			@return the matrix on root, a 0 x 0 matrix elsewhere
+		*/
+		Matrix<N> gather(int root = 0) const;
+
+		/** Get the number of rows. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _cols; }
+
+		/** Get the edge length of the distribution blocks. */
+		uint block() const { return _block; }
+
+		/** Get the process grid. */
+		const Grid& grid() const { return _grid; }
+
+		/** Get this rank's blocks as one row-major matrix. */
+		Matrix<N>& local() { return _local; }
+
+		/** Get this rank's blocks as one row-major matrix. */
+		const Matrix<N>& local() const { return _local; }
+
+		/** Get the global row of a local row. */
+		uint global_row(uint lr) const;
+
+		/** Get the global column of a local column. */
+		uint global_col(uint lc) const;
+
+		/** Get the grid rank owning element r, c. */
+		int owner(uint r, uint c) const;
+
+	private:
+		Grid _grid;			/**<process grid*/
+		uint _rows;			/**<global rows*/
+		uint _cols;			/**<global columns*/
+		uint _block;		/**<block edge length*/
+		Matrix<N> _local;	/**<blocks owned by this rank*/
+};
+
+
+/**	Computes `C = alpha * A * B + beta * C` with the SUMMA algorithm.
+	@param alpha - scale applied to `A * B`
+	@param A - m x k distributed matrix
+	@param B - k x n distributed matrix
+	@param beta - scale applied to C first. When zero C is not read.
+	@param C - m x n distributed matrix updated in place, distinct from A and B
+	@throw invalid_argument if the shapes, block sizes or grids do not agree
+*/
+template<typename N>
+void summa(const N& alpha, const DistMatrix<N>& A, const DistMatrix<N>& B, const N& beta, DistMatrix<N>& C);
+
+/**	Distributed matrix product.
+	@param lhs - m x k distributed matrix
+	@param rhs - k x n distributed matrix on the same grid with the same block size
+	@return a new m x n distributed matrix
+	@throw invalid_argument if the shapes, block sizes or grids do not agree
+*/
+template<typename N>
+DistMatrix<N> operator*(const DistMatrix<N>& lhs, const DistMatrix<N>& rhs);
+
+/**	Transposes a distributed matrix.
+	@param A - distributed matrix
+	@return a new cols x rows distributed matrix with the same grid and block size
+*/
+template<typename N>
+DistMatrix<N> transpose(const DistMatrix<N>& A);
+
+/**	Copies a distributed matrix into a different block size on the same grid.
+	@param A - distributed matrix
+	@param block - new block edge length
+	@return the redistributed matrix
+	@throw invalid_argument if block is 0
+*/
+template<typename N>
+DistMatrix<N> redistribute(const DistMatrix<N>& A, uint block);
+
+/**	Sums every element.
+	@param A - distributed matrix
+	@return the sum, on every rank
+*/
+template<typename N>
+N sum(const DistMatrix<N>& A);
+
+/**	Finds the largest element.
+	@param A - distributed matrix
+	@return the maximum, on every rank
+	@throw invalid_argument if A is empty
+*/
+template<typename N>
+N max(const DistMatrix<N>& A);
+
+/**	Finds the smallest element.
+	@param A - distributed matrix
+	@return the minimum, on every rank
+	@throw invalid_argument if A is empty
+*/
+template<typename N>
+N min(const DistMatrix<N>& A);
+
+
+/** double precision distributed matrix */
+typedef DistMatrix<double> dDistMatrix;
+/** single precision distributed matrix */
+typedef DistMatrix<float> fDistMatrix;
+
+
+
+// implementation
+
+namespace detail {
+
+// indices of [0, n) owned by process p of procs, nb at a time
+inline uint local_count(uint n, uint nb, int p, int procs) {
+	uint blocks = n / nb, extra = blocks % procs;
+	uint count = blocks / procs * nb;
+	if (static_cast<uint>(p) < extra) count += nb;
+	else if (static_cast<uint>(p) == extra) count += n % nb;
+	return count;
+}
+
+// global index of local index l on process p
+inline uint to_global(uint l, uint nb, int p, int procs) {
+	return (l / nb * procs + p) * nb + l % nb;
+}
+
+// process owning global index g
+inline int owner_of(uint g, uint nb, int procs) {
+	return static_cast<int>(g / nb % procs);
+}
+
+// exclusive prefix sums of counts
+inline std::vector<int> displacements(const std::vector<int>& counts) {
+	std::vector<int> d (counts.size(), 0);
+	for (ul i = 1; i < counts.size(); ++i) d[i] = d[i - 1] + counts[i - 1];
+	return d;
+}
+
+/*
+	copies src into dst, which has the same shape (or the transposed shape) on
+	the same grid. senders walk their elements in the row-major order of the
+	destination coordinates and receivers walk theirs row-major, so the elements
+	from each source arrive in the order they are needed.
+*/
+template<typename N>
+void remap(const DistMatrix<N>& src, DistMatrix<N>& dst, bool transposed) {
+	const Grid& g = src.grid();
+	int procs = g.size();
+	uint slr = src.local().rows(), slc = src.local().cols();
+	uint dlr = dst.local().rows(), dlc = dst.local().cols();
+
+	// destination rank of local element (i, j) of src
+	auto dest = [&](uint i, uint j) {
+		uint r = src.global_row(i), c = src.global_col(j);
+		return transposed ? dst.owner(c, r) : dst.owner(r, c);
+	};
+
+	std::vector<int> scount (procs, 0), rcount (procs, 0);
+	for (uint i = 0; i < slr; ++i)
+		for (uint j = 0; j < slc; ++j) ++scount[dest(i, j)];
+	for (uint i = 0; i < dlr; ++i)
+		for (uint j = 0; j < dlc; ++j) {
+			uint r = dst.global_row(i), c = dst.global_col(j);
+			++rcount[transposed ? src.owner(c, r) : src.owner(r, c)];
+		}
+	std::vector<int> sdisp = displacements(scount), rdisp = displacements(rcount);
+
+	const N* s = src.local().data();
+	std::vector<N> sendbuf (static_cast<ul>(slr) * slc), recvbuf (static_cast<ul>(dlr) * dlc);
+	std::vector<int> at (sdisp);
+	if (transposed) {
+		for (uint j = 0; j < slc; ++j)
+			for (uint i = 0; i < slr; ++i) sendbuf[at[dest(i, j)]++] = s[static_cast<ul>(i) * slc + j];
+	} else {
+		for (uint i = 0; i < slr; ++i)
+			for (uint j = 0; j < slc; ++j) sendbuf[at[dest(i, j)]++] = s[static_cast<ul>(i) * slc + j];
+	}
+
+	MPI_Alltoallv(sendbuf.data(), scount.data(), sdisp.data(), mpi_type<N>::get(),
+		recvbuf.data(), rcount.data(), rdisp.data(), mpi_type<N>::get(), g.comm());
+
+	N* d = dst.local().data();
+	at = rdisp;
+	for (uint i = 0; i < dlr; ++i)
+		for (uint j = 0; j < dlc; ++j) {
+			uint r = dst.global_row(i), c = dst.global_col(j);
+			d[static_cast<ul>(i) * dlc + j] = recvbuf[at[transposed ? src.owner(c, r) : src.owner(r, c)]++];
+		}
+}
+
+}	// detail
+
+
+inline Grid::Grid(MPI_Comm comm, int prows) : _comms(std::make_shared<detail::GridComms>()) {
+	int size;
+	MPI_Comm_size(comm, &size);
+	if (prows == 0) {
+		for (prows = 1; (prows + 1) * (prows + 1) <= size; ++prows) {}
+		while (size % prows != 0) --prows;
+	}
+	if (prows <= 0 || size % prows != 0)
+		throw std::invalid_argument("process rows must divide the number of ranks");
+
+	_p = prows;
+	_q = size / prows;
+	MPI_Comm_dup(comm, &_comms->all);
+	MPI_Comm_rank(_comms->all, &_rank);
+	MPI_Comm_split(_comms->all, myrow(), mycol(), &_comms->row);
+	MPI_Comm_split(_comms->all, mycol(), myrow(), &_comms->col);
+}
+
+
+template<typename N>
+DistMatrix<N>::DistMatrix(const Grid& grid, uint rows, uint cols, uint block, const N& fill)
+	: _grid(grid), _rows(rows), _cols(cols), _block(block ? block : 1),
+	_local(detail::local_count(rows, block ? block : 1, grid.myrow(), grid.prows()),
+		detail::local_count(cols, block ? block : 1, grid.mycol(), grid.pcols()), fill) {
+	if (block == 0)
+		throw std::invalid_argument("block size must be positive");
+}
+
+template<typename N>
+DistMatrix<N>::DistMatrix(const Grid& grid, const Matrix<N>& m, uint block, int root)
+	: _grid(grid), _rows(0), _cols(0), _block(block ? block : 1), _local(0, 0, N()) {
+	if (block == 0)
+		throw std::invalid_argument("block size must be positive");
+
+	uint shape[2] = { m.rows(), m.cols() };
+	MPI_Bcast(shape, 2, MPI_UNSIGNED, root, grid.comm());
+	_rows = shape[0];
+	_cols = shape[1];
+	_local = Matrix<N>(detail::local_count(_rows, _block, grid.myrow(), grid.prows()),
+		detail::local_count(_cols, _block, grid.mycol(), grid.pcols()), N());
+
+	// the root packs every rank's blocks in that rank's local order
+	int procs = grid.size();
+	std::vector<int> counts (procs, 0);
+	std::vector<N> packed;
+	if (grid.rank() == root) {
+		packed.reserve(static_cast<ul>(_rows) * _cols);
+		const N* src = m.data();
+		for (int p = 0; p < procs; ++p) {
+			int pr = p / grid.pcols(), pc = p % grid.pcols();
+			uint lr = detail::local_count(_rows, _block, pr, grid.prows());
+			uint lc = detail::local_count(_cols, _block, pc, grid.pcols());
+			for (uint i = 0; i < lr; ++i) {
+				const N* row = src + static_cast<ul>(detail::to_global(i, _block, pr, grid.prows())) * _cols;
+				for (uint j = 0; j < lc; ++j) packed.push_back(row[detail::to_global(j, _block, pc, grid.pcols())]);
+			}
+			counts[p] = static_cast<int>(lr * lc);
+		}
+	}
+	std::vector<int> disp = detail::displacements(counts);
+	MPI_Scatterv(packed.data(), counts.data(), disp.data(), mpi_type<N>::get(),
+		_local.data(), static_cast<int>(_local.size()), mpi_type<N>::get(), root, grid.comm());
+}
+
+template<typename N>
+Matrix<N> DistMatrix<N>::gather(int root) const {
+	int procs = _grid.size();
+	bool me = _grid.rank() == root;
+	std::vector<int> counts (procs, 0);
+	for (int p = 0; me && p < procs; ++p)
+		counts[p] = static_cast<int>(detail::local_count(_rows, _block, p / _grid.pcols(), _grid.prows())
+			* detail::local_count(_cols, _block, p % _grid.pcols(), _grid.pcols()));
+	std::vector<int> disp = detail::displacements(counts);
+	std::vector<N> packed (me ? static_cast<ul>(_rows) * _cols : 0);
+
+	MPI_Gatherv(_local.data(), static_cast<int>(_local.size()), mpi_type<N>::get(),
+		packed.data(), counts.data(), disp.data(), mpi_type<N>::get(), root, _grid.comm());
+	if (!me) return Matrix<N>(0, 0, N());
+
+	Matrix<N> m (_rows, _cols, N());
+	N* dst = m.data();
+	for (int p = 0; p < procs; ++p) {
+		int pr = p / _grid.pcols(), pc = p % _grid.pcols();
+		uint lr = detail::local_count(_rows, _block, pr, _grid.prows());
+		uint lc = detail::local_count(_cols, _block, pc, _grid.pcols());
+		const N* src = packed.data() + disp[p];
+		for (uint i = 0; i < lr; ++i) {
+			N* row = dst + static_cast<ul>(detail::to_global(i, _block, pr, _grid.prows())) * _cols;
+			for (uint j = 0; j < lc; ++j) row[detail::to_global(j, _block, pc, _grid.pcols())] = src[static_cast<ul>(i) * lc + j];
+		}
+	}
+	return m;
+}
+
+template<typename N>
+uint DistMatrix<N>::global_row(uint lr) const {
+	return detail::to_global(lr, _block, _grid.myrow(), _grid.prows());
+}
+
+template<typename N>
+uint DistMatrix<N>::global_col(uint lc) const {
+	return detail::to_global(lc, _block, _grid.mycol(), _grid.pcols());
+}
+
+template<typename N>
+int DistMatrix<N>::owner(uint r, uint c) const {
+	return _grid.rank_of(detail::owner_of(r, _block, _grid.prows()), detail::owner_of(c, _block, _grid.pcols()));
+}
+
+
+template<typename N>
+void summa(const N& alpha, const DistMatrix<N>& A, const DistMatrix<N>& B, const N& beta, DistMatrix<N>& C) {
+	if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+		throw std::invalid_argument("Matrix Multiplication is undefined if m.rows() must equal cols().");
+	if (A.block() != B.block() || A.block() != C.block())
+		throw std::invalid_argument("distributed matrices must share a block size");
+	if (!(A.grid() == B.grid()) || !(A.grid() == C.grid()))
+		throw std::invalid_argument("distributed matrices must share a grid");
+	if (&C == &A || &C == &B)
+		throw std::invalid_argument("output of summa must not be an input");
+	GPML_TRACE_SPAN("summa", A.rows(), B.cols(), A.cols());
+
+	const Grid& g = A.grid();
+	uint nb = A.block(), k = A.cols(), steps = (k + nb - 1) / nb;
+	uint mr = C.local().rows(), nc = C.local().cols(), ac = A.local().cols();
+	N* c = C.local().data();
+	const N* a = A.local().data();
+	const N* b = B.local().data();
+
+	if (beta == N()) std::fill(c, c + C.local().size(), N());
+	else if (beta != N(1)) C.local() *= beta;
+
+	// panels of step s go to buffer s % 2, so step s + 1 can arrive while step s is applied
+	std::vector<N> apanel[2], bpanel[2];
+	MPI_Request req[2][2];
+	auto post = [&](uint s) {
+		uint w = std::min(nb, k - s * nb), slot = s % 2;
+		int acol = detail::owner_of(s * nb, nb, g.pcols()), brow = detail::owner_of(s * nb, nb, g.prows());
+
+		apanel[slot].resize(static_cast<ul>(mr) * w);
+		if (g.mycol() == acol) {
+			uint lc0 = s / g.pcols() * nb;
+			for (uint i = 0; i < mr; ++i)
+				std::copy(a + static_cast<ul>(i) * ac + lc0, a + static_cast<ul>(i) * ac + lc0 + w, apanel[slot].data() + static_cast<ul>(i) * w);
+		}
+		bpanel[slot].resize(static_cast<ul>(w) * nc);
+		if (g.myrow() == brow) {
+			const N* rows = b + static_cast<ul>(s / g.prows() * nb) * nc;
+			std::copy(rows, rows + static_cast<ul>(w) * nc, bpanel[slot].data());
+		}
+		MPI_Ibcast(apanel[slot].data(), static_cast<int>(apanel[slot].size()), mpi_type<N>::get(), acol, g.row_comm(), &req[slot][0]);
+		MPI_Ibcast(bpanel[slot].data(), static_cast<int>(bpanel[slot].size()), mpi_type<N>::get(), brow, g.col_comm(), &req[slot][1]);
+	};
+
+	if (steps > 0) post(0);
+	for (uint s = 0; s < steps; ++s) {
+		if (s + 1 < steps) post(s + 1);
+		uint slot = s % 2, w = std::min(nb, k - s * nb);
+		MPI_Waitall(2, req[slot], MPI_STATUSES_IGNORE);
+		if (mr && nc) gemm(mr, nc, w, alpha, apanel[slot].data(), w, bpanel[slot].data(), nc, N(1), c, nc);
+	}
+}
+
+template<typename N>
+DistMatrix<N> operator*(const DistMatrix<N>& lhs, const DistMatrix<N>& rhs) {
+	DistMatrix<N> result (lhs.grid(), lhs.rows(), rhs.cols(), lhs.block(), N());
+	summa(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+template<typename N>
+DistMatrix<N> transpose(const DistMatrix<N>& A) {
+	GPML_TRACE_SPAN("dist_transpose", A.rows(), A.cols());
+	DistMatrix<N> t (A.grid(), A.cols(), A.rows(), A.block(), N());
+	detail::remap(A, t, true);
+	return t;
+}
+
+template<typename N>
+DistMatrix<N> redistribute(const DistMatrix<N>& A, uint block) {
+	GPML_TRACE_SPAN("redistribute", A.rows(), A.cols());
+	DistMatrix<N> r (A.grid(), A.rows(), A.cols(), block, N());
+	detail::remap(A, r, false);
+	return r;
+}
+
+template<typename N>
+N sum(const DistMatrix<N>& A) {
+	const N* x = A.local().data();
+	N local = N(), total = N();
+	for (ul i = 0; i < A.local().size(); ++i) local += x[i];
+	MPI_Allreduce(&local, &total, 1, mpi_type<N>::get(), MPI_SUM, A.grid().comm());
+	return total;
+}
+
+template<typename N>
+N max(const DistMatrix<N>& A) {
+	if (A.rows() == 0 || A.cols() == 0)
+		throw std::invalid_argument("maximum of an empty matrix");
+
+	const N* x = A.local().data();
+	N local = std::numeric_limits<N>::lowest(), total;
+	for (ul i = 0; i < A.local().size(); ++i) local = (x[i] > local) ? x[i] : local;
+	MPI_Allreduce(&local, &total, 1, mpi_type<N>::get(), MPI_MAX, A.grid().comm());
+	return total;
+}
+
+template<typename N>
+N min(const DistMatrix<N>& A) {
+	if (A.rows() == 0 || A.cols() == 0)
+		throw std::invalid_argument("minimum of an empty matrix");
+
+	const N* x = A.local().data();
+	N local = std::numeric_limits<N>::max(), total;
+	for (ul i = 0; i < A.local().size(); ++i) local = (x[i] < local) ? x[i] : local;
+	MPI_Allreduce(&local, &total, 1, mpi_type<N>::get(), MPI_MIN, A.grid().comm());
+	return total;
+}
+
+}	// dist
+}	// math
+
+#endif
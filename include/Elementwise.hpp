@@ -0,0 +1,155 @@
+/** @file Elementwise.hpp
+	Contains generic element-wise `map`, `zip` and `apply` over matrices
+	along with `compose` for fusing several transforms into one pass.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _ELEMENTWISE_H_
+#define _ELEMENTWISE_H_
+
+#include <utility>		// declval
+#include <type_traits>	// decay
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix, broadcast_kernel
+#include "Parallel.hpp"	// parallel_for
+#include "Instrument.hpp"	// Scope
+#include "Trace.hpp"		// GPML_TRACE_SPAN
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief Function object that applies `F` then `G`. Built by `compose`.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename F, typename G>
+struct Composed {
+	F f;	/**<applied first*/
+	G g;	/**<applied to the result of f*/
+
+	Composed(F f_, G g_) : f(f_), g(g_) {}
+
+	template<typename T>
+	auto operator()(const T& x) const -> decltype(g(f(x))) { return g(f(x)); }
+};
+
+namespace detail {
+
+// folds a pack of transforms into nested Composed objects, left to right
+template<typename F, typename... Rest>
+struct Compose {
+	typedef F type;
+	static F make(F f) { return f; }
+};
+
+template<typename F, typename G, typename... Rest>
+struct Compose<F, G, Rest...> {
+	typedef typename Compose<Composed<F, G>, Rest...>::type type;
+	static type make(F f, G g, Rest... rest) {
+		return Compose<Composed<F, G>, Rest...>::make(Composed<F, G>(f, g), rest...);
+	}
+};
+
+}	// detail
+
+/** Fuses several unary transforms into one function object that applies them
+	left to right, so `apply(m, compose(f, g, h))` makes a single pass over `m`
+	instead of three.
+	@param fs - transforms in the order they are applied
+	@return function object computing `...h(g(f(x)))`
+*/
+template<typename... Fs>
+typename detail::Compose<Fs...>::type compose(Fs... fs) {
+	return detail::Compose<Fs...>::make(fs...);
+}
+
+
+/** Applies `f` to every element of `m` in place. The loop runs over the contiguous
+	buffer and is split across the thread pool above `parallel::threshold()`.
+	@param m - matrix to transform
+	@param f - callable `N(N)`
+	@return reference to `m`
+*/
+template<typename N, typename F>
+Matrix<N>& apply(Matrix<N>& m, F f) {
+	GPML_TRACE_SPAN("apply", m.rows(), m.cols());
+	instrument::Scope scope (instrument::ELEMENTWISE, m.size(), 2ull * m.size() * sizeof(N));
+	N* a = m.data();
+	parallel::parallel_for(0, m.size(), [a, f](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) a[i] = f(a[i]);
+	});
+	return m;
+}
+
+/** Returns a new matrix holding `f(x)` for every element `x` of `m`. The result
+	type follows the return type of `f`.
+	@param m - source matrix
+	@param f - callable taking an element of `m`
+	@return matrix with the same shape as `m`
+*/
+template<typename N, typename F>
+Matrix<typename std::decay<decltype(std::declval<F>()(std::declval<N>()))>::type>
+map(const Matrix<N>& m, F f) {
+	typedef typename std::decay<decltype(std::declval<F>()(std::declval<N>()))>::type R;
+
+	GPML_TRACE_SPAN("map", m.rows(), m.cols());
+	instrument::Scope scope (instrument::ELEMENTWISE, m.size(), static_cast<ull>(m.size()) * (sizeof(N) + sizeof(R)));
+	Matrix<R> result (m.rows(), m.cols(), R());
+	const N* a = m.data();
+	R* out = result.data();
+	parallel::parallel_for(0, m.size(), [a, out, f](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) out[i] = f(a[i]);
+	});
+	return result;
+}
+
+/** Returns a new matrix holding `f(x, y)` for each pair of elements at the same
+	position in `a` and `b`. Row vectors, column vectors and 1 x 1 matrices are
+	broadcast against the other operand as in `operator+`.
+	@param a - first matrix
+	@param b - second matrix, broadcast compatible with `a`
+	@param f - callable taking an element of `a` and an element of `b`
+	@return matrix with the broadcast shape of `a` and `b`
+	@throw invalid_argument if the shapes of `a` and `b` cannot be broadcast together
+*/
+template<typename A, typename B, typename F>
+Matrix<typename std::decay<decltype(std::declval<F>()(std::declval<A>(), std::declval<B>()))>::type>
+zip(const Matrix<A>& a, const Matrix<B>& b, F f) {
+	typedef typename std::decay<decltype(std::declval<F>()(std::declval<A>(), std::declval<B>()))>::type R;
+
+	uint rows, cols;
+	if (!detail::broadcast_shape(a.rows(), a.cols(), b.rows(), b.cols(), rows, cols))
+		throw std::invalid_argument("arrays must have same size");
+
+	Matrix<R> result (rows, cols, R());
+	detail::broadcast_kernel(result.data(), rows, cols, a.data(), a.rows(), a.cols(),
+							b.data(), b.rows(), b.cols(), f);
+	return result;
+}
+
+/** In place form of `zip`: sets every element `x` of `a` to `f(x, y)` where `y`
+	is the element of `b` at the same position. `b` may be broadcast to `a`.
+	@param a - matrix to update
+	@param b - second operand that broadcasts to the shape of `a`
+	@param f - callable `N(N, B)`
+	@return reference to `a`
+	@throw invalid_argument if `b` does not broadcast to the shape of `a`
+*/
+template<typename N, typename B, typename F>
+Matrix<N>& zip_apply(Matrix<N>& a, const Matrix<B>& b, F f) {
+	uint rows, cols;
+	if (!detail::broadcast_shape(a.rows(), a.cols(), b.rows(), b.cols(), rows, cols) || rows != a.rows() || cols != a.cols())
+		throw std::invalid_argument("arrays must have same size");
+
+	detail::broadcast_kernel(a.data(), a.rows(), a.cols(), a.data(), a.rows(), a.cols(),
+							b.data(), b.rows(), b.cols(), f);
+	return a;
+}
+
+}	// math
+
+#endif
@@ -6,4 +6,33 @@
 #pragma once
 
 #include "Matrix.hpp"
+#include "Parallel.hpp"
+#include "Elementwise.hpp"
+#include "Transcendental.hpp"
+#include "Vector.hpp"
+#include "Gemv.hpp"
+#include "Gemm.hpp"
+#include "Strassen.hpp"
+#include "Quantize.hpp"
+#include "Half.hpp"
+#include "Solve.hpp"
+#include "Packed.hpp"
+#include "Banded.hpp"
+#include "Diagonal.hpp"
+#include "BlockSparse.hpp"
+#include "OutOfCore.hpp"
+#include "Tiled.hpp"
+#include "Autotune.hpp"
+#include "Instrument.hpp"
+#include "Trace.hpp"
+#include "Roofline.hpp"
+#include "Perf.hpp"
+#include "Async.hpp"
+#include "TaskGraph.hpp"
+#include "TileFactor.hpp"
+#include "NUMA.hpp"
+#include "Shared.hpp"
+#ifdef GPML_MPI
+#include "Distributed.hpp"	// needs mpi.h
+#endif
 #include "typedefs.h"
@@ -0,0 +1,327 @@
+/** @file Gemm.hpp
+	Contains the cache-blocked matrix multiply used by `Matrix::operator*=` and
+	the `gemm` entry points that pick between it and Strassen-Winograd.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _GEMM_H_
+#define _GEMM_H_
+
+#include <stdexcept>	// invalid_argument
+#include <vector>		// vector
+#include <type_traits>	// is_same, integral_constant
+#include "Parallel.hpp"	// parallel_for
+#include "Instrument.hpp"	// Scope
+#include "Trace.hpp"		// GPML_TRACE_SPAN
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+template<typename N> class Matrix;
+
+
+/** @brief Cache blocking parameters for the blocked GEMM kernel.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct GemmParams {
+	uint mc;		/**<rows of A handled per block*/
+	uint kc;		/**<inner dimension per block, sized so a kc x nc panel of B fits in L2*/
+	uint nc;		/**<columns of B and C per block, sized so unroll rows of C fit in L1*/
+	uint unroll;	/**<rows of C updated together by the micro kernel: 1, 2, 4 or 8*/
+	uint threads;	/**<most threads the product may use, 0 for `parallel::num_threads()`*/
+};
+
+/** Shape classes that can be given their own blocking parameters, chosen by the
+	smallest of m, n and k (see `gemm_shape`).
+*/
+enum GemmShape {
+	GEMM_SMALL,		/**<smallest dimension below 128*/
+	GEMM_MEDIUM,	/**<smallest dimension below 1024*/
+	GEMM_LARGE,		/**<everything else*/
+	GEMM_SHAPES		/**<number of shape classes*/
+};
+
+/** Get the shape class of an m x k by k x n product.
+	@return the class whose parameters `gemm` uses
+*/
+inline GemmShape gemm_shape(uint m, uint n, uint k) {
+	uint d = (m < n) ? m : n;
+	d = (d < k) ? d : k;
+	return (d < 128) ? GEMM_SMALL : (d < 1024) ? GEMM_MEDIUM : GEMM_LARGE;
+}
+
+/** Blocking parameters used for element type `N`.
+	@return reference to the parameters so they can be changed at runtime
+*/
+template<typename N>
+inline GemmParams& gemm_params() {
+	static GemmParams p = { 64, 256, 256, 4, 0 };
+	return p;
+}
+
+/** Blocking parameters used for element type `N` and shape class `s`, normally
+	filled in by the autotuner (see Autotune.hpp). Entries with `unroll == 0`, the
+	default, fall back to `gemm_params<N>()`.
+	@param s - shape class
+	@return reference to the parameters so they can be changed at runtime
+*/
+template<typename N>
+inline GemmParams& gemm_params(GemmShape s) {
+	static GemmParams p[GEMM_SHAPES] = {};
+	return p[s];
+}
+
+
+/** @brief Type the kernels compute in for storage type `N`. Storage-only types
+	such as `half` and `bfloat16` specialize this to float (see Half.hpp) and are
+	widened panel by panel before the blocked kernel runs.
+*/
+template<typename N>
+struct accumulator {
+	typedef N type;		/**<arithmetic type used for storage type N*/
+};
+
+
+/**	Computes `C = alpha * A * B + beta * C` on raw row-major buffers. Large floating
+	point products go through Strassen-Winograd (see Strassen.hpp) unless it is
+	disabled; everything else runs the blocked kernel.
+	@param m - rows of A and C
+	@param n - columns of B and C
+	@param k - columns of A and rows of B
+	@param alpha - scale applied to `A * B`
+	@param A - m x k matrix with row stride lda
+	@param lda - distance between rows of A
+	@param B - k x n matrix with row stride ldb
+	@param ldb - distance between rows of B
+	@param beta - scale applied to C before accumulation. When zero C is not read.
+	@param C - m x n matrix with row stride ldc. Must not overlap A or B.
+	@param ldc - distance between rows of C
+*/
+template<typename N>
+void gemm(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc);
+
+/**	Computes `C = alpha * A * B + beta * C` on matrices.
+	@param alpha - scale applied to `A * B`
+	@param A - rows x inner matrix
+	@param B - inner x cols matrix
+	@param beta - scale applied to C before accumulation
+	@param C - rows x cols matrix updated in place. Must not be A or B.
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void gemm(const N& alpha, const Matrix<N>& A, const Matrix<N>& B, const N& beta, Matrix<N>& C);
+
+/**	Same as `gemm` but always uses the blocked classical algorithm, for callers
+	that need the usual componentwise error bounds.
+	@param m - rows of A and C
+	@param n - columns of B and C
+	@param k - columns of A and rows of B
+	@param alpha - scale applied to `A * B`
+	@param A - m x k matrix with row stride lda
+	@param lda - distance between rows of A
+	@param B - k x n matrix with row stride ldb
+	@param ldb - distance between rows of B
+	@param beta - scale applied to C before accumulation. When zero C is not read.
+	@param C - m x n matrix with row stride ldc
+	@param ldc - distance between rows of C
+*/
+template<typename N>
+void gemm_classical(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc);
+
+
+namespace detail {
+
+// defined in Strassen.hpp, included at the end of this file
+template<typename N>
+bool use_strassen(uint m, uint n, uint k);
+
+template<typename N>
+void strassen_gemm(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc);
+
+/*
+	bulk element conversion used to widen storage types to their accumulator and
+	narrow results back. specialized with SIMD conversions in Half.hpp.
+*/
+template<typename From, typename To>
+struct convert {
+	static void run(const From* in, To* out, ul n) {
+		for (ul i = 0; i < n; ++i) out[i] = static_cast<To>(in[i]);
+	}
+};
+
+}	// detail
+
+
+
+// implementation
+
+namespace detail {
+
+/*
+	C[0:U, 0:nb] += alpha * A[0:U, 0:kb] * B[0:kb, 0:nb]. each row of B is loaded once
+	and applied to U rows of C, and the j loop is unit stride so it vectorizes.
+*/
+template<typename N, uint U>
+inline void gemm_micro(uint nb, uint kb, N alpha, const N* A, ul lda, const N* B, ul ldb, N* C, ul ldc) {
+	for (uint p = 0; p < kb; ++p) {
+		N a[U];
+		for (uint u = 0; u < U; ++u) a[u] = alpha * A[u * lda + p];
+
+		const N* b = B + p * ldb;
+		for (uint j = 0; j < nb; ++j) {
+			N bj = b[j];
+			for (uint u = 0; u < U; ++u) C[u * ldc + j] += a[u] * bj;
+		}
+	}
+}
+
+// rows [lo, hi) of C for one kc x nc block of B, U rows at a time
+template<typename N, uint U>
+inline void gemm_rows(ul lo, ul hi, uint nb, uint kb, N alpha, const N* A, ul lda, const N* B, ul ldb, N* C, ul ldc) {
+	ul i = lo;
+	for (; i + U <= hi; i += U)
+		gemm_micro<N, U>(nb, kb, alpha, A + i * lda, lda, B, ldb, C + i * ldc, ldc);
+	for (; i < hi; ++i)
+		gemm_micro<N, 1>(nb, kb, alpha, A + i * lda, lda, B, ldb, C + i * ldc, ldc);
+}
+
+template<typename N>
+void gemm_blocked(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc) {
+	if (m == 0 || n == 0) return;
+
+	// apply beta once up front so the blocks only accumulate
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r) {
+			N* c = C + r * ldc;
+			if (beta == N()) for (uint j = 0; j < n; ++j) c[j] = N();
+			else if (beta != N(1)) for (uint j = 0; j < n; ++j) c[j] *= beta;
+		}
+	}, n ? (parallel::threshold() / n ? parallel::threshold() / n : 1) : 1);
+
+	if (k == 0 || alpha == N()) return;
+
+	GemmParams prm = gemm_params<N>(gemm_shape(m, n, k));
+	if (prm.unroll == 0) prm = gemm_params<N>();
+	uint mc = prm.mc ? prm.mc : 64, kc = prm.kc ? prm.kc : 256, nc = prm.nc ? prm.nc : 256;
+	uint unroll = prm.unroll;
+
+	// only split across threads when there is enough work per row block
+	ul flops = static_cast<ul>(m) * n * k;
+	ul grain = (flops < parallel::threshold() * 256) ? m : mc;
+	if (prm.threads && grain < (m + prm.threads - 1) / prm.threads)
+		grain = (m + prm.threads - 1) / prm.threads;
+
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		for (uint jc = 0; jc < n; jc += nc) {
+			uint nb = (jc + nc < n) ? nc : n - jc;
+			for (uint pc = 0; pc < k; pc += kc) {
+				uint kb = (pc + kc < k) ? kc : k - pc;
+				const N* a = A + pc;
+				const N* b = B + static_cast<ul>(pc) * ldb + jc;
+				N* c = C + jc;
+
+				for (ul ic = lo; ic < hi; ic += mc) {
+					ul ie = (ic + mc < hi) ? ic + mc : hi;
+					switch (unroll) {
+						case 8: gemm_rows<N, 8>(ic, ie, nb, kb, alpha, a, lda, b, ldb, c, ldc); break;
+						case 2: gemm_rows<N, 2>(ic, ie, nb, kb, alpha, a, lda, b, ldb, c, ldc); break;
+						case 1: gemm_rows<N, 1>(ic, ie, nb, kb, alpha, a, lda, b, ldb, c, ldc); break;
+						default: gemm_rows<N, 4>(ic, ie, nb, kb, alpha, a, lda, b, ldb, c, ldc); break;
+					}
+				}
+			}
+		}
+	}, grain ? grain : 1);
+}
+
+/*
+	gemm for storage types that compute in a wider accumulator type A. C is held
+	in A for the whole product; A and B are widened one kc panel at a time so the
+	extra memory is m * n + kc * (m + n) elements of A.
+*/
+template<typename N>
+void gemm_widened(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc) {
+	typedef typename accumulator<N>::type Acc;
+	if (m == 0 || n == 0) return;
+
+	Acc al = static_cast<Acc>(alpha), be = static_cast<Acc>(beta);
+	std::vector<Acc> c (static_cast<ul>(m) * n, Acc());
+	if (be != Acc())
+		for (uint r = 0; r < m; ++r) convert<N, Acc>::run(C + r * ldc, c.data() + static_cast<ul>(r) * n, n);
+
+	uint kc = gemm_params<Acc>().kc ? gemm_params<Acc>().kc : 256;
+	kc = (k < kc) ? k : kc;
+	std::vector<Acc> a (static_cast<ul>(m) * kc), b (static_cast<ul>(kc) * n);
+
+	for (uint pc = 0; pc < k; pc += kc) {
+		uint kb = (pc + kc < k) ? kc : k - pc;
+		for (uint r = 0; r < m; ++r) convert<N, Acc>::run(A + r * lda + pc, a.data() + static_cast<ul>(r) * kb, kb);
+		for (uint r = 0; r < kb; ++r) convert<N, Acc>::run(B + (pc + r) * ldb, b.data() + static_cast<ul>(r) * n, n);
+
+		gemm_blocked(m, n, kb, al, a.data(), kb, b.data(), n, (pc == 0) ? be : Acc(1), c.data(), n);
+	}
+	if (k == 0)
+		for (ul i = 0; i < c.size(); ++i) c[i] *= be;
+
+	for (uint r = 0; r < m; ++r) convert<Acc, N>::run(c.data() + static_cast<ul>(r) * n, C + r * ldc, n);
+}
+
+template<typename N>
+void gemm_dispatch(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc,
+					bool classical, std::true_type) {
+	if (!classical && use_strassen<N>(m, n, k))
+		strassen_gemm(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+	else
+		gemm_blocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+template<typename N>
+void gemm_dispatch(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc,
+					bool, std::false_type) {
+	gemm_widened(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+// work counted by the instrumentation: a multiply and an add per term, and A, B and C read plus C written once
+inline ull gemm_flops(uint m, uint n, uint k) { return 2ull * m * n * k; }
+
+template<typename N>
+inline ull gemm_bytes(uint m, uint n, uint k) {
+	return (static_cast<ull>(m) * k + static_cast<ull>(k) * n + 2ull * m * n) * sizeof(N);
+}
+
+}	// detail
+
+
+template<typename N>
+void gemm_classical(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc) {
+	GPML_TRACE_SPAN("gemm", m, n, k);
+	instrument::Scope scope (instrument::GEMM, detail::gemm_flops(m, n, k), detail::gemm_bytes<N>(m, n, k));
+	detail::gemm_dispatch(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, true,
+						std::is_same<typename accumulator<N>::type, N>());
+}
+
+template<typename N>
+void gemm(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc) {
+	GPML_TRACE_SPAN("gemm", m, n, k);
+	instrument::Scope scope (instrument::GEMM, detail::gemm_flops(m, n, k), detail::gemm_bytes<N>(m, n, k));
+	detail::gemm_dispatch(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc, false,
+						std::is_same<typename accumulator<N>::type, N>());
+}
+
+template<typename N>
+void gemm(const N& alpha, const Matrix<N>& A, const Matrix<N>& B, const N& beta, Matrix<N>& C) {
+	if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+		throw std::invalid_argument("matrix shapes do not agree for gemm");
+
+	gemm(A.rows(), B.cols(), A.cols(), alpha, A.data(), A.cols(), B.data(), B.cols(), beta, C.data(), C.cols());
+}
+
+}	// math
+
+#include "Strassen.hpp"
+
+#endif
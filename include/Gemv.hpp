@@ -0,0 +1,115 @@
+/** @file Gemv.hpp
+	Contains the matrix-vector kernels gemv and gemv_t and the Matrix * Vector operator.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _GEMV_H_
+#define _GEMV_H_
+
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix
+#include "Vector.hpp"	// Vector, dot_kernel, axpy_kernel
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/**	Computes `y = alpha * A * x + beta * y`. Rows of `A` are split across the
+	thread pool; each row is a unit-stride dot product against `x`, which stays
+	in cache while `A` is streamed once.
+	@param alpha - scale applied to `A * x`
+	@param A - rows x cols matrix
+	@param x - vector of size `A.cols()`
+	@param beta - scale applied to `y` before accumulation. When zero `y` is not read.
+	@param y - vector of size `A.rows()` updated in place
+	@throw invalid_argument if the sizes of `x` or `y` do not match `A`
+*/
+template<typename N>
+void gemv(const N& alpha, const Matrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y);
+
+/**	Computes `y = alpha * A^T * x + beta * y` without forming the transpose.
+	Columns of `A` are split across the thread pool and each thread accumulates
+	`x[r] * A(r, :)` into its slice of `y` with unit-stride updates.
+	@param alpha - scale applied to `A^T * x`
+	@param A - rows x cols matrix
+	@param x - vector of size `A.rows()`
+	@param beta - scale applied to `y` before accumulation. When zero `y` is not read.
+	@param y - vector of size `A.cols()` updated in place
+	@throw invalid_argument if the sizes of `x` or `y` do not match `A`
+*/
+template<typename N>
+void gemv_t(const N& alpha, const Matrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y);
+
+/**	Matrix-vector product.
+	@param lhs - rows x cols matrix
+	@param rhs - vector of size `lhs.cols()`
+	@return a new vector of size `lhs.rows()`
+	@throw invalid_argument if `lhs.cols() != rhs.size()`
+*/
+template<typename N>
+Vector<N> operator*(const Matrix<N>& lhs, const Vector<N>& rhs);
+
+
+
+// implementation
+
+
+template<typename N>
+void gemv(const N& alpha, const Matrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y) {
+	if (x.size() != A.cols() || y.size() != A.rows())
+		throw std::invalid_argument("vector sizes do not match matrix shape");
+
+	const N* a = A.data();
+	const N* xp = x.data();
+	N* yp = y.data();
+	uint cols = A.cols();
+	N al = alpha, be = beta;
+
+	ul grain = cols ? parallel::threshold() / cols : 1;
+	parallel::parallel_for(0, A.rows(), [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r) {
+			N s = al * detail::dot_kernel(a + r * cols, xp, cols);
+			yp[r] = (be == N()) ? s : s + be * yp[r];
+		}
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+void gemv_t(const N& alpha, const Matrix<N>& A, const Vector<N>& x, const N& beta, Vector<N>& y) {
+	if (x.size() != A.rows() || y.size() != A.cols())
+		throw std::invalid_argument("vector sizes do not match matrix shape");
+
+	const N* a = A.data();
+	const N* xp = x.data();
+	N* yp = y.data();
+	uint rows = A.rows(), cols = A.cols();
+	N al = alpha, be = beta;
+
+	ul grain = rows ? parallel::threshold() / rows : 1;
+	parallel::parallel_for(0, cols, [=](ul lo, ul hi) {
+		N* ys = yp + lo;
+		ul n = hi - lo;
+		if (be == N()) {
+			for (ul c = 0; c < n; ++c) ys[c] = N();
+		} else if (be != N(1)) {
+			for (ul c = 0; c < n; ++c) ys[c] *= be;
+		}
+
+		for (uint r = 0; r < rows; ++r)
+			detail::axpy_kernel(al * xp[r], a + static_cast<ul>(r) * cols + lo, ys, n);
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+Vector<N> operator*(const Matrix<N>& lhs, const Vector<N>& rhs) {
+	Vector<N> result (lhs.rows(), N());
+	gemv(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,259 @@
+/** @file Half.hpp
+	Contains the 16 bit floating point storage types `half` (IEEE binary16) and
+	`bfloat16` (the top half of a binary32), their conversions and the hooks that
+	make `Matrix<half>` and `Matrix<bfloat16>` compute in float.
+
+	Both types are storage only. Arithmetic converts to float, computes and rounds
+	the result back, so element-wise operators keep fp32 intermediate precision per
+	operation. `gemm` widens one panel at a time and accumulates the whole product
+	in float before rounding once. Element-wise operators widen a block of 256
+	elements at a time so the arithmetic loop is plain float code.
+
+	Conversions use F16C when the compiler targets it (`-mf16c` or `-march=native`)
+	and branch-free bit manipulation otherwise. Both round to nearest even, handle
+	denormals, infinities and NaN, quiet signaling NaNs while keeping their
+	payload, and give bit-identical results; `make test-f16c` checks every half
+	value against the hardware. Without F16C a half conversion costs several times
+	more than the float add it surrounds.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _HALF_H_
+#define _HALF_H_
+
+#include <cstring>		// memcpy
+#include <stdint.h>		// uint16_t, uint32_t
+#include "Matrix.hpp"	// Matrix
+#include "Gemm.hpp"		// accumulator, detail::convert
+#include "typedefs.h"	// ul
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+
+namespace math {
+
+namespace detail {
+
+inline uint32_t float_bits(float f) {
+	uint32_t u;
+	std::memcpy(&u, &f, sizeof(float));
+	return u;
+}
+
+inline float bits_float(uint32_t u) {
+	float f;
+	std::memcpy(&f, &u, sizeof(float));
+	return f;
+}
+
+// all ones when c is true, zero otherwise
+inline uint32_t mask(bool c) {
+	return 0u - static_cast<uint32_t>(c);
+}
+
+// bit manipulation forms of the conversions, used when F16C is not available
+inline float soft_half_to_float(uint16_t h) {
+	uint32_t o = static_cast<uint32_t>(h & 0x7fffu) << 13;
+	uint32_t exp = o & (0x7c00u << 13);
+	o += (127u - 15u) << 23;
+
+	// infinity and NaN keep the maximum exponent, and NaN is made quiet as F16C does;
+	// denormals are normalized by a subtraction
+	uint32_t special = o + ((128u - 16u) << 23);
+	special |= 0x00400000u & mask((h & 0x3ffu) != 0);
+	uint32_t denorm = float_bits(bits_float(o + (1u << 23)) - bits_float(113u << 23));
+	o = (special & mask(exp == (0x7c00u << 13))) | (denorm & mask(exp == 0)) | (o & mask(exp != 0 && exp != (0x7c00u << 13)));
+	return bits_float(o | (static_cast<uint32_t>(h & 0x8000u) << 16));
+}
+
+inline uint16_t soft_float_to_half(float f) {
+	uint32_t u = float_bits(f);
+	uint32_t sign = u & 0x80000000u;
+	u ^= sign;
+
+	// overflow to infinity, NaN stays quiet and keeps the top of its payload
+	uint32_t big = 0x7c00u | ((0x200u | ((u >> 13) & 0x3ffu)) & mask(u > (255u << 23)));
+	// results below the smallest normal half: the float add does the rounding
+	const uint32_t magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+	uint32_t small = float_bits(bits_float(u) + bits_float(magic)) - magic;
+	// normal results: rebias and round to nearest even on the 13 dropped bits
+	uint32_t normal = (u + ((15u - 127u) << 23) + 0xfffu + ((u >> 13) & 1u)) >> 13;
+
+	uint32_t o = (big & mask(u >= ((127u + 16u) << 23)))
+				| (small & mask(u < (113u << 23)))
+				| (normal & mask(u >= (113u << 23) && u < ((127u + 16u) << 23)));
+	return static_cast<uint16_t>(o | (sign >> 16));
+}
+
+inline float half_to_float(uint16_t h) {
+#if defined(__F16C__)
+	return _cvtsh_ss(h);
+#else
+	return soft_half_to_float(h);
+#endif
+}
+
+inline uint16_t float_to_half(float f) {
+#if defined(__F16C__)
+	return static_cast<uint16_t>(_cvtss_sh(f, 0));
+#else
+	return soft_float_to_half(f);
+#endif
+}
+
+inline float bfloat16_to_float(uint16_t b) {
+	return bits_float(static_cast<uint32_t>(b) << 16);
+}
+
+inline uint16_t float_to_bfloat16(float f) {
+	uint32_t u = float_bits(f);
+	uint32_t rounded = (u + 0x7fffu + ((u >> 16) & 1u)) >> 16;
+	uint32_t nan = (u >> 16) | 0x40u;
+	bool is_nan = (u & 0x7fffffffu) > 0x7f800000u;
+	return static_cast<uint16_t>((nan & mask(is_nan)) | (rounded & ~mask(is_nan)));
+}
+
+}	// detail
+
+
+/** @brief IEEE 754 binary16 storage type. Converts to and from float implicitly;
+	all arithmetic is done in float.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class half {
+	public:
+		/** Creates a positive zero. */
+		half() : _bits(0) {}
+
+		/** Rounds `f` to the nearest representable half, ties to even.
+			@param f - value to store
+		*/
+		half(float f) : _bits(detail::float_to_half(f)) {}
+
+		/** Widens to float exactly. */
+		operator float() const { return detail::half_to_float(_bits); }
+
+		/** Creates a half from its bit pattern.
+			@param b - raw binary16 bits
+		*/
+		static half from_bits(uint16_t b) { half h; h._bits = b; return h; }
+
+		/** Get the raw binary16 bits. */
+		uint16_t bits() const { return _bits; }
+
+		half& operator+=(float x) { return *this = half(float(*this) + x); }
+		half& operator-=(float x) { return *this = half(float(*this) - x); }
+		half& operator*=(float x) { return *this = half(float(*this) * x); }
+		half& operator/=(float x) { return *this = half(float(*this) / x); }
+
+	private:
+		uint16_t _bits;		/**<binary16 bit pattern*/
+};
+
+
+/** @brief bfloat16 storage type: the sign, 8 bit exponent and top 7 mantissa bits
+	of a float. Same range as float with about 3 significant decimal digits.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class bfloat16 {
+	public:
+		/** Creates a positive zero. */
+		bfloat16() : _bits(0) {}
+
+		/** Rounds `f` to the nearest representable bfloat16, ties to even.
+			@param f - value to store
+		*/
+		bfloat16(float f) : _bits(detail::float_to_bfloat16(f)) {}
+
+		/** Widens to float exactly. */
+		operator float() const { return detail::bfloat16_to_float(_bits); }
+
+		/** Creates a bfloat16 from its bit pattern.
+			@param b - raw bits
+		*/
+		static bfloat16 from_bits(uint16_t b) { bfloat16 h; h._bits = b; return h; }
+
+		/** Get the raw bits. */
+		uint16_t bits() const { return _bits; }
+
+		bfloat16& operator+=(float x) { return *this = bfloat16(float(*this) + x); }
+		bfloat16& operator-=(float x) { return *this = bfloat16(float(*this) - x); }
+		bfloat16& operator*=(float x) { return *this = bfloat16(float(*this) * x); }
+		bfloat16& operator/=(float x) { return *this = bfloat16(float(*this) / x); }
+
+	private:
+		uint16_t _bits;		/**<upper 16 bits of the float*/
+};
+
+
+/** half precision matrix */
+typedef Matrix<half> hMatrix;
+/** bfloat16 matrix */
+typedef Matrix<bfloat16> bf16Matrix;
+
+
+/** half computes in float */
+template<>
+struct accumulator<half> {
+	typedef float type;
+};
+
+/** bfloat16 computes in float */
+template<>
+struct accumulator<bfloat16> {
+	typedef float type;
+};
+
+
+namespace detail {
+
+template<>
+struct convert<half, float> {
+	static void run(const half* in, float* out, ul n) {
+		ul i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+		for (; i + 8 <= n; i += 8)
+			_mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i))));
+#endif
+		for (; i < n; ++i) out[i] = half_to_float(in[i].bits());
+	}
+};
+
+template<>
+struct convert<float, half> {
+	static void run(const float* in, half* out, ul n) {
+		ul i = 0;
+#if defined(__F16C__) && defined(__AVX__)
+		for (; i + 8 <= n; i += 8)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm256_cvtps_ph(_mm256_loadu_ps(in + i), 0));
+#endif
+		for (; i < n; ++i) out[i] = half::from_bits(float_to_half(in[i]));
+	}
+};
+
+template<>
+struct convert<bfloat16, float> {
+	static void run(const bfloat16* in, float* out, ul n) {
+		for (ul i = 0; i < n; ++i) out[i] = bfloat16_to_float(in[i].bits());
+	}
+};
+
+template<>
+struct convert<float, bfloat16> {
+	static void run(const float* in, bfloat16* out, ul n) {
+		for (ul i = 0; i < n; ++i) out[i] = bfloat16::from_bits(float_to_bfloat16(in[i]));
+	}
+};
+
+}	// detail
+
+}	// math
+
+#endif
@@ -0,0 +1,299 @@
+/** @file Instrument.hpp
+	Contains the opt-in counters that record calls, flops, bytes moved, heap
+	allocations and wall time for each kind of Matrix operation.
+
+	Counting is off until `instrument::enabled()` is set. Each thread adds to its
+	own counters with relaxed atomic stores, so there is no contention between
+	threads and a disabled build only pays for one branch per operation. Counters
+	of threads that exit are folded into a shared total. `snapshot()` sums every
+	thread and `reset()` records a new baseline rather than clearing other threads.
+
+	Bytes are the compulsory traffic of an operation: each operand read once and
+	each result written once. Flops count one per element-wise result and 2mnk
+	for a product.
+
+	With `hardware()` also set, each operation additionally reads the calling
+	thread's hardware counters (see Perf.hpp) on entry and exit. This costs a
+	system call per read, and work the operation hands to the thread pool is
+	not included.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _INSTRUMENT_H_
+#define _INSTRUMENT_H_
+
+#include <atomic>		// atomic
+#include <mutex>		// mutex, lock_guard
+#include <vector>		// vector
+#include <string>		// string
+#include <sstream>		// ostringstream
+#include <chrono>		// steady_clock
+#include <algorithm>	// find
+#include "Perf.hpp"		// CounterSet, Reading, EVENTS
+#include "typedefs.h"	// ull
+
+
+namespace math {
+namespace instrument {
+
+/** Kinds of operation counted separately. */
+enum Op {
+	GEMM,			/**<matrix products*/
+	ELEMENTWISE,	/**<operators, broadcasting, map, zip and apply*/
+	TRANSPOSE,		/**<in place transposes*/
+	COPY,			/**<copy construction, assignment and copy-on-write detaches*/
+	CONSTRUCTION,	/**<matrices built from a fill value or nested arrays*/
+	OPS				/**<number of operation kinds*/
+};
+
+/** @brief Totals for one kind of operation.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Counters {
+	ull calls;			/**<operations run*/
+	ull flops;			/**<arithmetic operations performed*/
+	ull bytes;			/**<bytes read and written*/
+	ull allocations;	/**<heap buffers allocated*/
+	ull nanoseconds;	/**<wall time spent*/
+	ull hardware[perf::EVENTS];	/**<hardware events indexed by perf::Event, 0 unless counted*/
+};
+
+/** @brief Totals for every kind of operation at one point in time.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Snapshot {
+	Counters ops[OPS];	/**<totals indexed by Op*/
+
+	/** Get the totals for one kind of operation.
+		@param op - operation kind
+		@return its counters
+	*/
+	const Counters& operator[](Op op) const { return ops[op]; }
+};
+
+/** Whether operations are counted. Off by default.
+	@return reference to the flag so it can be changed at runtime
+*/
+inline bool& enabled() {
+	static bool e = false;
+	return e;
+}
+
+/** Whether counted operations also read hardware counters. Off by default and
+	ignored while `enabled()` is off.
+	@return reference to the flag so it can be changed at runtime
+*/
+inline bool& hardware() {
+	static bool h = false;
+	return h;
+}
+
+/** Name of an operation kind as used by `export_text`.
+	@param op - operation kind
+	@return lower case name such as "gemm"
+*/
+inline const char* op_name(Op op) {
+	static const char* names[OPS] = { "gemm", "elementwise", "transpose", "copy", "construction" };
+	return names[op];
+}
+
+/** Sums the counters of every thread since the last `reset()`.
+	@return the totals
+*/
+inline Snapshot snapshot();
+
+/** Starts counting from zero again for every thread. */
+inline void reset();
+
+/** Formats a snapshot in the Prometheus text exposition format, one
+	`gpml_<field>_total{op="<name>"}` sample per counter.
+	@param s - totals to export
+	@return the text, ending in a newline
+*/
+inline std::string export_text(const Snapshot& s);
+
+
+/** @brief Counts one operation. Construct it at the start of the operation; the
+	wall time is recorded when it is destroyed. Does nothing unless counting is
+	enabled when it is constructed.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class Scope {
+	public:
+		/** Counts a call with its work.
+			@param op - operation kind
+			@param flops - arithmetic operations it performs
+			@param bytes - bytes it reads and writes
+			@param allocations - heap buffers it allocates
+		*/
+		Scope(Op op, ull flops, ull bytes, ull allocations = 0);
+
+		/** Destructor. Adds the elapsed wall time. */
+		~Scope();
+
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+
+		Op _op;											/**<operation being timed*/
+		bool _on;										/**<true if counting was enabled at construction*/
+		bool _hw;										/**<true if hardware counters are read*/
+		std::chrono::steady_clock::time_point _start;	/**<construction time*/
+		perf::Reading _events;							/**<hardware counters at construction*/
+};
+
+
+
+// implementation
+
+namespace detail {
+
+enum Field { CALLS, FLOPS, BYTES, ALLOCATIONS, NANOSECONDS, HARDWARE, FIELDS = HARDWARE + perf::EVENTS };
+
+// one thread's counters. only the owning thread writes, any thread may read.
+struct ThreadCounters {
+	std::atomic<ull> v[OPS][FIELDS];
+
+	ThreadCounters() {
+		for (uint o = 0; o < OPS; ++o)
+			for (uint f = 0; f < FIELDS; ++f) v[o][f].store(0, std::memory_order_relaxed);
+	}
+
+	void add(Op op, Field f, ull x) {
+		std::atomic<ull>& a = v[op][f];
+		a.store(a.load(std::memory_order_relaxed) + x, std::memory_order_relaxed);
+	}
+};
+
+// live threads, totals of exited threads and the baseline subtracted by snapshot
+struct Registry {
+	std::mutex mutex;
+	std::vector<ThreadCounters*> live;
+	ull retired[OPS][FIELDS];
+	ull base[OPS][FIELDS];
+
+	Registry() {
+		for (uint o = 0; o < OPS; ++o)
+			for (uint f = 0; f < FIELDS; ++f) retired[o][f] = base[o][f] = 0;
+	}
+
+	// raw totals over every thread. caller holds mutex.
+	void totals(ull out[OPS][FIELDS]) {
+		for (uint o = 0; o < OPS; ++o)
+			for (uint f = 0; f < FIELDS; ++f) {
+				out[o][f] = retired[o][f];
+				for (ul t = 0; t < live.size(); ++t) out[o][f] += live[t]->v[o][f].load(std::memory_order_relaxed);
+			}
+	}
+};
+
+inline Registry& registry() {
+	static Registry r;
+	return r;
+}
+
+// registers a thread's counters on first use and folds them into the total when it exits
+struct LocalCounters {
+	ThreadCounters counters;
+
+	LocalCounters() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock (r.mutex);
+		r.live.push_back(&counters);
+	}
+
+	~LocalCounters() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock (r.mutex);
+		for (uint o = 0; o < OPS; ++o)
+			for (uint f = 0; f < FIELDS; ++f) r.retired[o][f] += counters.v[o][f].load(std::memory_order_relaxed);
+		r.live.erase(std::find(r.live.begin(), r.live.end(), &counters));
+	}
+};
+
+inline ThreadCounters& local() {
+	thread_local LocalCounters l;
+	return l.counters;
+}
+
+}	// detail
+
+
+inline Scope::Scope(Op op, ull flops, ull bytes, ull allocations) : _op(op), _on(enabled()), _hw(false) {
+	if (!_on) return;
+	detail::ThreadCounters& c = detail::local();
+	c.add(op, detail::CALLS, 1);
+	c.add(op, detail::FLOPS, flops);
+	c.add(op, detail::BYTES, bytes);
+	c.add(op, detail::ALLOCATIONS, allocations);
+	_hw = hardware() && perf::local().available();
+	if (_hw) _events = perf::local().read();
+	_start = std::chrono::steady_clock::now();
+}
+
+inline Scope::~Scope() {
+	if (!_on) return;
+	std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - _start;
+	detail::ThreadCounters& c = detail::local();
+	c.add(_op, detail::NANOSECONDS, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+	if (_hw) {
+		perf::Reading events = perf::local().read() - _events;
+		for (uint e = 0; e < perf::EVENTS; ++e) c.add(_op, static_cast<detail::Field>(detail::HARDWARE + e), events.value[e]);
+	}
+}
+
+inline Snapshot snapshot() {
+	detail::Registry& r = detail::registry();
+	ull t[OPS][detail::FIELDS];
+	{
+		std::lock_guard<std::mutex> lock (r.mutex);
+		r.totals(t);
+		for (uint o = 0; o < OPS; ++o)
+			for (uint f = 0; f < detail::FIELDS; ++f) t[o][f] -= r.base[o][f];
+	}
+
+	Snapshot s;
+	for (uint o = 0; o < OPS; ++o) {
+		s.ops[o].calls = t[o][detail::CALLS];
+		s.ops[o].flops = t[o][detail::FLOPS];
+		s.ops[o].bytes = t[o][detail::BYTES];
+		s.ops[o].allocations = t[o][detail::ALLOCATIONS];
+		s.ops[o].nanoseconds = t[o][detail::NANOSECONDS];
+		for (uint e = 0; e < perf::EVENTS; ++e) s.ops[o].hardware[e] = t[o][detail::HARDWARE + e];
+	}
+	return s;
+}
+
+inline void reset() {
+	detail::Registry& r = detail::registry();
+	std::lock_guard<std::mutex> lock (r.mutex);
+	r.totals(r.base);
+}
+
+inline std::string export_text(const Snapshot& s) {
+	static const char* fields[] = { "calls", "flops", "bytes", "allocations", "nanoseconds" };
+	std::ostringstream out;
+	for (uint f = 0; f < detail::FIELDS; ++f) {
+		const char* name = (f < detail::HARDWARE) ? fields[f] : perf::event_name(static_cast<perf::Event>(f - detail::HARDWARE));
+		out << "# TYPE gpml_" << name << "_total counter\n";
+		for (uint o = 0; o < OPS; ++o) {
+			const Counters& c = s.ops[o];
+			ull v = (f == 0) ? c.calls : (f == 1) ? c.flops : (f == 2) ? c.bytes : (f == 3) ? c.allocations
+					: (f == 4) ? c.nanoseconds : c.hardware[f - detail::HARDWARE];
+			out << "gpml_" << name << "_total{op=\"" << op_name(static_cast<Op>(o)) << "\"} " << v << "\n";
+		}
+	}
+	return out.str();
+}
+
+}	// instrument
+}	// math
+
+#endif
@@ -1,5 +1,16 @@
 /** @file Matrix.hpp
 	Contains Matrix class definition and implementation.
+
+	A matrix can opt into copy-on-write with `set_copy_on_write(true)`. Copies of
+	such a matrix share its buffer through an atomic reference count, so passing
+	it by value is O(1). The first mutation through `set()`, a compound operator,
+	`T()` or a non-const `operator()` or `data()` gives the mutated copy its own
+	buffer. Pointers obtained from `data()` are only safe to write through until
+	the matrix is copied again.
+
+	Matrices of at most `GPML_SBO_ELEMENTS` elements (16 unless defined before
+	this header is included) keep their data inside the object and never touch
+	the heap. Such small buffers are always copied, never shared.
 	@author Daniel Nichols
 	@date October 2018
 */
@@ -10,7 +21,20 @@
 #include <utility>		// pair, make_pair
 #include <stdexcept>	// invalid_argument
 #include <vector>		// vector
+#include <algorithm>	// fill, copy
+#include <type_traits>	// integral_constant, is_same
+#include <atomic>		// atomic
+#include <new>			// placement new
 #include "typedefs.h"	// uint
+#include "Parallel.hpp"	// parallel_for
+#include "Gemm.hpp"		// gemm, accumulator, convert
+#include "Instrument.hpp"	// Scope
+#include "NUMA.hpp"		// allocate, deallocate, placement
+#include "Trace.hpp"		// GPML_TRACE_SPAN
+
+#ifndef GPML_SBO_ELEMENTS
+#define GPML_SBO_ELEMENTS 16
+#endif
 
 
 namespace math {
@@ -91,6 +115,32 @@ class Matrix {
 			@throw invalid_argument thrown if r<0 or r>=rows() or c<0 or c>=cols()
 		*/
 		void set(uint r, uint c, N val);
+
+		/** Unchecked access to element r, c. Intended for kernels that have already
+			validated their bounds.
+			@param r - row of element
+			@param c - column of element
+			@return reference to the element at r,c
+		*/
+		N& operator()(uint r, uint c) { detach(); return _data[static_cast<ul>(r) * _cols + c]; }
+
+		/** Unchecked access to element r, c.
+			@param r - row of element
+			@param c - column of element
+			@return const reference to the element at r,c
+		*/
+		const N& operator()(uint r, uint c) const { return _data[static_cast<ul>(r) * _cols + c]; }
+
+		/** Get the contiguous row-major buffer backing the matrix. Element r,c lives
+			at `data()[r * cols() + c]`.
+			@return pointer to the first element
+		*/
+		N* data() { detach(); return _data; }
+
+		/** Get the contiguous row-major buffer backing the matrix.
+			@return const pointer to the first element
+		*/
+		const N* data() const { return _data; }
 	
 		/** Get the shape or (rows, cols). This is equivalent to `std::make_pair(rows(), cols());`
 			@return an STL pair containing the row count and column count 
@@ -117,6 +167,23 @@ class Matrix {
         */
         void T();
 
+		/** Turns copy-on-write on or off for this matrix. When on, copies share the
+			buffer until one of them is modified, and are copy-on-write themselves.
+			Turning it off gives this matrix its own buffer.
+			@param on - true to share the buffer with copies
+		*/
+		void set_copy_on_write(bool on);
+
+		/** Get whether copies of this matrix share its buffer.
+			@return true if copy-on-write is on
+		*/
+		bool copy_on_write() const { return _cow; }
+
+		/** Get the number of matrices sharing this buffer, 1 if it is not shared.
+			@return the reference count
+		*/
+		uint use_count() const { return _refs ? _refs->load(std::memory_order_acquire) : 1; }
+
 
 		// overloaded operators
 
@@ -127,20 +194,35 @@ class Matrix {
 		*/
 		Matrix& operator=(const Matrix& m);
 
-		/**	Adds matrix `m` to `this` element-wise
-			@param m - matrix to add to `this`. rows and cols must be equivalent.
+		/**	Adds matrix `m` to `this` element-wise. `m` may also be a 1 x `cols()` row
+			vector, a `rows()` x 1 column vector or a 1 x 1 matrix, in which case it is
+			broadcast across `this` without being expanded.
+			@param m - matrix to add to `this`. must have the same shape or broadcast to it.
 			@return a pointer to `this` after addition
-			@throw invalid_argument thrown if `rows()!=m.rows()` or `cols()!=m.cols()`
+			@throw invalid_argument thrown if `m` does not broadcast to the shape of `this`
 		*/
 		Matrix& operator+=(const Matrix& m);
 
-		/**	Subtracts matrix `m` from `this` element-wise
-			@param m - matrix to subtract from `this`. rows and cols must be equivalent.
+		/**	Subtracts matrix `m` from `this` element-wise. `m` is broadcast the same
+			way as in `operator+=`.
+			@param m - matrix to subtract from `this`. must have the same shape or broadcast to it.
 			@return a pointer to `this` after subtraction
-			@throw invalid_argument thrown if `rows()!=m.rows()` or `cols()!=m.cols()`
+			@throw invalid_argument thrown if `m` does not broadcast to the shape of `this`
 		*/
 		Matrix& operator-=(const Matrix& m);
 
+		/**	Adds scalar `scal` to every element of `this`
+			@param scal - scalar to add
+			@return a pointer to `this` after addition
+		*/
+		Matrix& operator+=(const N& scal);
+
+		/**	Subtracts scalar `scal` from every element of `this`
+			@param scal - scalar to subtract
+			@return a pointer to `this` after subtraction
+		*/
+		Matrix& operator-=(const N& scal);
+
 		/**	Adds Multiplies `this` by scaler `scal`
 			@param scal - scaler to multiply `this` by
 			@return a pointer to `m` after multiplication
@@ -170,33 +252,81 @@ class Matrix {
 		~Matrix();
 		
 	private:
-		uint _size;		/**<size of matrix*/
-		uint _cols;		/**<number of columns in matrix*/
-		uint _rows;		/**<number of rows in matrix*/
-		N** _matrix;	/**<internal array to store matrix data*/
+		static const uint small_size = GPML_SBO_ELEMENTS;
+
+		void detach() { if (_refs && _refs->load(std::memory_order_acquire) > 1) unshare(); }
+		N* allocate(uint n) { return (n <= small_size) ? _small : heap(n); }
+		static N* heap(uint n);
+		static void free_heap(N* d, uint n);
+		void unshare();
+		void release();
+		void adopt(N* data);
+
+		uint _size;					/**<size of matrix*/
+		uint _cols;					/**<number of columns in matrix*/
+		uint _rows;					/**<number of rows in matrix*/
+		N* _data;					/**<contiguous row-major array storing matrix data, _small or heap*/
+		std::atomic<uint>* _refs;	/**<matrices sharing a heap _data, NULL unless copy-on-write*/
+		bool _cow;					/**<true if copies should share _data*/
+		N _small[GPML_SBO_ELEMENTS > 0 ? GPML_SBO_ELEMENTS : 1];	/**<inline storage for small matrices*/
 };
 
 
 
 // free standing operator declarations
-/**	Adds lhs and rhs matrices element-wise. Copies lhs and add rhs to it.
+/**	Adds lhs and rhs matrices element-wise with NumPy-style broadcasting: each
+	dimension must either match or be 1 in one of the operands. The result has
+	the larger size in each dimension.
 	@param lhs - left hand side matrix of addition
 	@param rhs - right hand side matrix of addition
 	@return a new matrix with elements from element-wise addition of `lhs` and `rhs`
-	@throw invalid_argument if `lhs` and `rhs` do not have same shape
+	@throw invalid_argument if the shapes of `lhs` and `rhs` cannot be broadcast together
 */
 template<typename N>
 Matrix<N> operator+(Matrix<N> lhs,const Matrix<N>& rhs);
 
-/**	Subtracts lhs and rhs matrices element-wise. Copies lhs and subtract rhs from it.
+/**	Subtracts lhs and rhs matrices element-wise with the same broadcasting
+	rules as `operator+`.
 	@param lhs - left hand side matrix of subtraction
 	@param rhs - right hand side matrix of subtraction
 	@return a new matrix with elements from element-wise subtraction of `lhs` and `rhs`
-	@throw invalid_argument if `lhs` and `rhs` do not have same shape
+	@throw invalid_argument if the shapes of `lhs` and `rhs` cannot be broadcast together
 */
 template<typename N>
 Matrix<N> operator-(Matrix<N> lhs, const Matrix<N>& rhs);
 
+/**	Adds scalar rhs to every element of lhs.
+	@param lhs - left hand side matrix
+	@param rhs - right hand side scalar
+	@return a new matrix with `rhs` added to each element of `lhs`
+*/
+template<typename N>
+Matrix<N> operator+(Matrix<N> lhs, const N& rhs);
+
+/**	Adds scalar lhs to every element of rhs.
+	@param lhs - left hand side scalar
+	@param rhs - right hand side matrix
+	@return a new matrix with `lhs` added to each element of `rhs`
+*/
+template<typename N>
+Matrix<N> operator+(const N& lhs, Matrix<N> rhs);
+
+/**	Subtracts scalar rhs from every element of lhs.
+	@param lhs - left hand side matrix
+	@param rhs - right hand side scalar
+	@return a new matrix with `rhs` subtracted from each element of `lhs`
+*/
+template<typename N>
+Matrix<N> operator-(Matrix<N> lhs, const N& rhs);
+
+/**	Subtracts every element of rhs from scalar lhs.
+	@param lhs - left hand side scalar
+	@param rhs - right hand side matrix
+	@return a new matrix with elements `lhs - rhs(r,c)`
+*/
+template<typename N>
+Matrix<N> operator-(const N& lhs, Matrix<N> rhs);
+
 /**	Multiplies lhs and scalar rhs. Copies lhs and multiplies by scalar rhs
 	@param lhs - left hand side matrix 
 	@param rhs - right hand side scalar
@@ -231,6 +361,14 @@ Matrix<N> operator/(Matrix<N> lhs, const N& rhs);
 template<typename N>
 Matrix<N> operator*(Matrix<N> lhs, const Matrix<N>& rhs);
 
+/**	Converts every element of `m` to `To`, using the SIMD conversions for the 16
+	bit floating point types in Half.hpp where they apply.
+	@param m - matrix to convert
+	@return a new matrix of the same shape holding `To(m(r, c))`
+*/
+template<typename To, typename From>
+Matrix<To> matrix_cast(const Matrix<From>& m);
+
 
 // define standard Matrix classes for easier use
 /** integer matrix */
@@ -245,77 +383,192 @@ typedef Matrix<double> dMatrix;
 // implementation
 
 
-template<typename N>
-Matrix<N>::Matrix(uint size, const N& fill) : Matrix(size, size, fill) {}
+namespace detail {
+
+/*
+	computes the broadcast shape of an ar*ac and a br*bc operand. every dimension
+	must match or be 1 in one operand. returns false if they are incompatible.
+*/
+inline bool broadcast_shape(uint ar, uint ac, uint br, uint bc, uint& rows, uint& cols) {
+	if (ar != br && ar != 1 && br != 1) return false;
+	if (ac != bc && ac != 1 && bc != 1) return false;
+	rows = (ar == 1) ? br : ar;
+	cols = (ac == 1) ? bc : ac;
+	return true;
+}
 
+// element-wise operations with a templated call so they run in the accumulator type
+struct Plus { template<typename T> T operator()(T x, T y) const { return x + y; } };
+struct Minus { template<typename T> T operator()(T x, T y) const { return x - y; } };
+struct Times { template<typename T> T operator()(T x, T y) const { return x * y; } };
+struct Divides { template<typename T> T operator()(T x, T y) const { return x / y; } };
 
 /*
-	initilize with dimensions rows*cols and elements fill
+	fill and copy for new buffers. unless the NUMA placement is NUMA_DEFAULT they run
+	through parallel_for, so each page is first touched on the node whose threads
+	will work on it.
 */
 template<typename N>
-Matrix<N>::Matrix(uint rows, uint cols, const N& fill) : _size(rows*cols), _cols(cols), _rows(rows) {
-	// allocate rows
-	_matrix = new N*[_rows];
+inline void touch_fill(N* d, ul n, const N& v) {
+	if (numa::placement() == numa::NUMA_DEFAULT) {
+		std::fill(d, d + n, v);
+		return;
+	}
+	N x = v;
+	parallel::parallel_for(0, n, [d, x](ul lo, ul hi) { std::fill(d + lo, d + hi, x); });
+}
 
-	// allocate col in each row
-	for (uint r = 0; r < _rows; ++r) {
-		_matrix[r] = new N[_cols];
+template<typename N>
+inline void touch_copy(const N* s, ul n, N* d) {
+	if (numa::placement() == numa::NUMA_DEFAULT) {
+		std::copy(s, s + n, d);
+		return;
+	}
+	parallel::parallel_for(0, n, [s, d](ul lo, ul hi) { std::copy(s + lo, s + hi, d + lo); });
+}
 
-		// set each value to fill
-		for (uint c = 0; c < _cols; ++c)
-			_matrix[r][c] = fill;
+/*
+	o[0:n] = op(x, y) where x and y are either full spans (xs/ys true) or a single
+	broadcast value.
+*/
+template<typename R, typename A, typename B, typename Op>
+inline void span_kernel(R* o, const A* x, bool xs, const B* y, bool ys, ul n, Op op, std::true_type) {
+	if (xs && ys) {
+		for (ul i = 0; i < n; ++i) o[i] = op(x[i], y[i]);
+	} else if (xs) {
+		B v = y[0];
+		for (ul i = 0; i < n; ++i) o[i] = op(x[i], v);
+	} else if (ys) {
+		A u = x[0];
+		for (ul i = 0; i < n; ++i) o[i] = op(u, y[i]);
+	} else {
+		R v = op(x[0], y[0]);
+		for (ul i = 0; i < n; ++i) o[i] = v;
 	}
 }
 
+/*
+	same as above for storage types such as half: operands are widened to their
+	accumulator type a block at a time, op runs there and the result is narrowed
+	back, so the inner loop sees plain floats.
+*/
+template<typename R, typename A, typename B, typename Op>
+inline void span_kernel(R* o, const A* x, bool xs, const B* y, bool ys, ul n, Op op, std::false_type) {
+	typedef typename accumulator<R>::type RR;
+	typedef typename accumulator<A>::type AA;
+	typedef typename accumulator<B>::type BB;
+	const ul block = 256;
+	RR ob[block];
+	AA xb[block];
+	BB yb[block];
+	if (!xs) convert<A, AA>::run(x, xb, 1);
+	if (!ys) convert<B, BB>::run(y, yb, 1);
+
+	for (ul i0 = 0; i0 < n; i0 += block) {
+		ul nb = (i0 + block < n) ? block : n - i0;
+		if (xs) convert<A, AA>::run(x + i0, xb, nb);
+		if (ys) convert<B, BB>::run(y + i0, yb, nb);
+		span_kernel(ob, xb, xs, yb, ys, nb, op, std::true_type());
+		convert<RR, R>::run(ob, o + i0, nb);
+	}
+}
+
+/*
+	out = op(a, b) over a rows*cols result where a and b are each full size, a row
+	vector, a column vector or a scalar. broadcast operands are read in place and
+	never expanded. columns are walked in blocks so a broadcast row stays in L1
+	while it is reused for every row. out may alias a full size a.
+*/
+template<typename R, typename A, typename B, typename Op>
+void broadcast_kernel(R* out, uint rows, uint cols, const A* a, uint ar, uint ac,
+						const B* b, uint br, uint bc, Op op) {
+	typedef std::integral_constant<bool, std::is_same<typename accumulator<R>::type, R>::value
+		&& std::is_same<typename accumulator<A>::type, A>::value
+		&& std::is_same<typename accumulator<B>::type, B>::value> direct;
+	ul n = static_cast<ul>(rows) * cols;
+	GPML_TRACE_SPAN("elementwise", rows, cols);
+	instrument::Scope scope (instrument::ELEMENTWISE, n,
+		n * sizeof(R) + static_cast<ul>(ar) * ac * sizeof(A) + static_cast<ul>(br) * bc * sizeof(B));
+
+	if (ar == rows && ac == cols && br == rows && bc == cols) {
+		// same shapes: one flat loop over the whole buffer
+		parallel::parallel_for(0, static_cast<ul>(rows) * cols, [out, a, b, op](ul lo, ul hi) {
+			span_kernel(out + lo, a + lo, true, b + lo, true, hi - lo, op, direct());
+		});
+		return;
+	}
+
+	const uint block = 2048;
+	ul grain = cols ? parallel::threshold() / cols : 1;
+	parallel::parallel_for(0, rows, [=](ul lo, ul hi) {
+		for (uint c0 = 0; c0 < cols; c0 += block) {
+			uint c1 = (c0 + block < cols) ? c0 + block : cols;
+
+			for (ul r = lo; r < hi; ++r) {
+				const A* x = a + ((ar == 1) ? 0 : r * ac) + ((ac == 1) ? 0 : c0);
+				const B* y = b + ((br == 1) ? 0 : r * bc) + ((bc == 1) ? 0 : c0);
+				span_kernel(out + r * cols + c0, x, ac != 1, y, bc != 1, c1 - c0, op, direct());
+			}
+		}
+	}, grain ? grain : 1);
+}
+
+}	// detail
+
+
 template<typename N>
-Matrix<N>::Matrix(uint size, N** data) : Matrix(size, size, data) {}
+Matrix<N>::Matrix(uint size, const N& fill) : Matrix(size, size, fill) {}
+
 
+/*
+	initilize with dimensions rows*cols and elements fill
+*/
 template<typename N>
-Matrix<N>::Matrix(uint rows, uint cols, N** data) : _size(rows*cols), _cols(cols), _rows(rows) {
-	// allocate rows
-	_matrix = new N*[_rows];
+Matrix<N>::Matrix(uint rows, uint cols, const N& fill) : _size(rows*cols), _cols(cols), _rows(rows), _refs(NULL), _cow(false) {
+	instrument::Scope scope (instrument::CONSTRUCTION, 0, static_cast<ull>(_size) * sizeof(N), _size > small_size);
+	_data = allocate(_size);
+	detail::touch_fill(_data, _size, fill);
+}
 
-	for (uint r = 0; r < _rows; ++r) {
-		// allocate columns
-		_matrix[r] = new N[_cols];
+template<typename N>
+Matrix<N>::Matrix(uint size, N** data) : Matrix(size, size, data) {}
 
-		for (uint c = 0; c < _cols; ++c)
-			_matrix[r][c] = data[r][c];
-	}	
+template<typename N>
+Matrix<N>::Matrix(uint rows, uint cols, N** data) : _size(rows*cols), _cols(cols), _rows(rows), _refs(NULL), _cow(false) {
+	instrument::Scope scope (instrument::CONSTRUCTION, 0, 2ull * _size * sizeof(N), _size > small_size);
+	_data = allocate(_size);
+
+	// copy each row into its slot of the contiguous buffer
+	for (uint r = 0; r < _rows; ++r)
+		std::copy(data[r], data[r] + _cols, _data + static_cast<ul>(r) * _cols);
 }
 
 template<typename N>
 Matrix<N>::Matrix(uint size, const std::vector<std::vector<N> >& data) : Matrix(size, size, data) {}
 
 template<typename N>
-Matrix<N>::Matrix(uint rows, uint cols, const std::vector<std::vector<N> >& data) : _size(rows*cols), _cols(cols), _rows(rows) {
-	// allocate rows
-	_matrix = new N*[_rows];
-
-	for (uint r = 0; r < _rows; ++r) {
-		// allocate columns	
-		_matrix[r] = new N[_cols];
+Matrix<N>::Matrix(uint rows, uint cols, const std::vector<std::vector<N> >& data) : _size(rows*cols), _cols(cols), _rows(rows), _refs(NULL), _cow(false) {
+	instrument::Scope scope (instrument::CONSTRUCTION, 0, 2ull * _size * sizeof(N), _size > small_size);
+	_data = allocate(_size);
 
+	for (uint r = 0; r < _rows; ++r)
 		for (uint c = 0; c < _cols; ++c)
-			_matrix[r][c] = data[r][c];
-	}
+			_data[static_cast<ul>(r) * _cols + c] = data[r][c];
 }
 
 
 // copy constructor
 template<typename N>
-Matrix<N>::Matrix(const Matrix& m) : _size(m.size()), _cols(m.cols()), _rows(m.rows()) {
-	// allocate rows
-	_matrix = new N*[_rows];
-
-	// allocate col in each row
-	for (uint r = 0; r < _rows; ++r) {
-		_matrix[r] = new N[_cols];
-		
-		// set each value from m
-		for (uint c = 0; c < _cols; ++c) {
-			_matrix[r][c] = m.at(r,c);
-		}
+Matrix<N>::Matrix(const Matrix& m) : _size(m.size()), _cols(m.cols()), _rows(m.rows()), _refs(m._refs), _cow(m._cow) {
+	GPML_TRACE_SPAN("copy", _rows, _cols);
+	instrument::Scope scope (instrument::COPY, 0, _refs ? 0 : 2ull * _size * sizeof(N), !_refs && _size > small_size);
+	if (_refs) {
+		// copy-on-write: share the buffer until one side is modified
+		_refs->fetch_add(1, std::memory_order_relaxed);
+		_data = m._data;
+	} else {
+		_data = allocate(_size);
+		detail::touch_copy(m._data, _size, _data);
 	}
 }
 
@@ -331,7 +584,7 @@ N Matrix<N>::at(uint r, uint c) const {
 	if (c < 0 || c >= _cols)
 		throw std::invalid_argument("column out of range");
 
-	return _matrix[r][c];
+	return (*this)(r, c);
 }
 
 
@@ -348,18 +601,83 @@ void Matrix<N>::set(uint r, uint c, N val) {
 	if (c < 0 || c >= _cols)
 		throw std::invalid_argument("column out of range");
 
-	_matrix[r][c] = val;
+	(*this)(r, c) = val;
 }
 
 template<typename N>
 void Matrix<N>::T() {
     if (_rows == 0 || _cols == 0) return;
+    GPML_TRACE_SPAN("transpose", _rows, _cols);
+    instrument::Scope scope (instrument::TRANSPOSE, 0, 2ull * _size * sizeof(N), _data != _small);
 
-    Matrix t (_cols, _rows, 0);
+    // small buffers are transposed through the stack and copied back in place
+    N tmp[small_size > 0 ? small_size : 1];
+    N* t = (_data == _small) ? tmp : heap(_size);
     for (uint r = 0; r < _rows; r++)
         for (uint c = 0; c < _cols; c++)
-            t._matrix[c][r] = _matrix[r][c];
-    *this = t;
+            t[static_cast<ul>(c) * _rows + r] = _data[static_cast<ul>(r) * _cols + c];
+
+    if (t == tmp) std::copy(tmp, tmp + _size, _small);
+    else adopt(t);
+    std::swap(_rows, _cols);
+}
+
+template<typename N>
+void Matrix<N>::set_copy_on_write(bool on) {
+	if (on && !_cow) {
+		if (_data != _small) _refs = new std::atomic<uint>(1);
+	} else if (!on && _cow && _refs) {
+		detach();
+		delete _refs;
+		_refs = NULL;
+	}
+	_cow = on;
+}
+
+// gives this matrix a private copy of a shared buffer
+template<typename N>
+void Matrix<N>::unshare() {
+	GPML_TRACE_SPAN("detach", _rows, _cols);
+	instrument::Scope scope (instrument::COPY, 0, 2ull * _size * sizeof(N), _size > small_size);
+	N* d = allocate(_size);
+	detail::touch_copy(_data, _size, d);
+	adopt(d);
+}
+
+// heap buffer with the NUMA placement policy applied; elements are default initialized as by new[]
+template<typename N>
+N* Matrix<N>::heap(uint n) {
+	N* d = static_cast<N*>(numa::allocate(static_cast<ul>(n) * sizeof(N)));
+	for (uint i = 0; i < n; ++i) new (d + i) N;
+	return d;
+}
+
+// frees a buffer of n elements from heap
+template<typename N>
+void Matrix<N>::free_heap(N* d, uint n) {
+	for (uint i = 0; i < n; ++i) d[i].~N();
+	numa::deallocate(d);
+}
+
+// drops this matrix's reference to its buffer, freeing it if it was the last one
+template<typename N>
+void Matrix<N>::release() {
+	if (_data == _small) {
+		return;
+	} else if (!_refs) {
+		free_heap(_data, _size);
+	} else if (_refs->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+		free_heap(_data, _size);
+		delete _refs;
+	}
+}
+
+// replaces the buffer with data, either _small or a heap buffer this matrix now owns alone
+template<typename N>
+void Matrix<N>::adopt(N* data) {
+	release();
+	_data = data;
+	_refs = (_cow && data != _small) ? new std::atomic<uint>(1) : NULL;
 }
 
 
@@ -370,82 +688,157 @@ void Matrix<N>::T() {
 template<typename N>
 Matrix<N>& Matrix<N>::operator=(const Matrix& m) {
 	if (this != &m) {	// ignore self-assignment
-		if (_rows != m._rows || _cols != m._cols) {		// cannot reuse memory
-	
-			// delete current memory
-			for (int r = 0; r < _rows; ++r) delete[] _matrix[r];
-			delete[] _matrix;
-
-			// create new memory and reinit property vars
-			_size = 0;
-			_rows = 0;
-			_cols = 0;			
-
-			_matrix = new N*[m._rows];
-			for (int r = 0; r < m._rows; ++r) _matrix[r] = new N[m._cols];
-			
-			_size = m._size;
-			_rows = m._rows;
-			_cols = m._cols;	
-		} 
-		for (int r = 0; r < _rows; ++r)
-			for (int c = 0; c < _cols; ++c)
-				_matrix[r][c] = m._matrix[r][c];
+		bool reuse = !_refs && (_size == m._size || (_data == _small && m._size <= small_size));
+		GPML_TRACE_SPAN("assign", m._rows, m._cols);
+		instrument::Scope scope (instrument::COPY, 0, m._refs ? 0 : 2ull * m._size * sizeof(N),
+								!m._refs && !reuse && m._size > small_size);
+		if (m._refs) {
+			// share m's buffer
+			if (m._data != _data) {
+				m._refs->fetch_add(1, std::memory_order_relaxed);
+				release();
+				_data = m._data;
+				_refs = m._refs;
+			}
+		} else {
+			if (!reuse) {	// cannot reuse memory
+				release();
+				_data = allocate(m._size);
+				_refs = NULL;
+			}
+			detail::touch_copy(m._data, m._size, _data);
+			if (m._cow && !_refs && _data != _small) _refs = new std::atomic<uint>(1);
+		}
+		_cow = m._cow;
+		_size = m._size;
+		_rows = m._rows;
+		_cols = m._cols;
 	}
 	return *this;
 }
 
 template<typename N>
 Matrix<N>& Matrix<N>::operator+=(const Matrix& m) {
-	// error if they don't have same shape
-	if (m._rows != _rows || m._cols != _cols) 
+	detach();
+
+	// error if m does not broadcast to our shape
+	uint rows, cols;
+	if (!detail::broadcast_shape(_rows, _cols, m._rows, m._cols, rows, cols) || rows != _rows || cols != _cols)
 		throw std::invalid_argument("arrays must have same size");
 
 	// add each element
-	for (int r = 0; r < _rows; ++r)
-		for (int c = 0; c < _cols; ++c)
-			_matrix[r][c] += m._matrix[r][c];
+	detail::broadcast_kernel(_data, _rows, _cols, _data, _rows, _cols, m._data, m._rows, m._cols,
+							detail::Plus());
+
+	return *this;
+}
 
+template<typename N>
+Matrix<N>& Matrix<N>::operator+=(const N& scal) {
+	detach();
+	detail::broadcast_kernel(_data, _rows, _cols, _data, _rows, _cols, &scal, 1u, 1u,
+							detail::Plus());
 	return *this;
 }
 
 template<typename N>
 Matrix<N> operator+(Matrix<N> lhs, const Matrix<N>& rhs) {
-	// lhs is copy of argument, so we can use +=
+	uint rows, cols;
+	if (!detail::broadcast_shape(lhs.rows(), lhs.cols(), rhs.rows(), rhs.cols(), rows, cols))
+		throw std::invalid_argument("arrays must have same size");
+
+	// lhs is copy of argument, so we can use += when it already has the result shape
+	if (rows == lhs.rows() && cols == lhs.cols()) {
+		lhs += rhs;
+		return lhs;
+	}
+
+	// read lhs through a const reference so a shared copy is not detached
+	const Matrix<N>& l = lhs;
+	Matrix<N> result (rows, cols, N());
+	detail::broadcast_kernel(result.data(), rows, cols, l.data(), l.rows(), l.cols(),
+							rhs.data(), rhs.rows(), rhs.cols(), detail::Plus());
+	return result;
+}
+
+template<typename N>
+Matrix<N> operator+(Matrix<N> lhs, const N& rhs) {
 	lhs += rhs;
 	return lhs;
 }
 
+template<typename N>
+Matrix<N> operator+(const N& lhs, Matrix<N> rhs) {
+	rhs += lhs;
+	return rhs;
+}
+
 
 template<typename N>
 Matrix<N>& Matrix<N>::operator-=(const Matrix& m) {
-	// error if they don't have same shape
-	if (m._rows != _rows || m._cols != _cols)
+	detach();
+
+	// error if m does not broadcast to our shape
+	uint rows, cols;
+	if (!detail::broadcast_shape(_rows, _cols, m._rows, m._cols, rows, cols) || rows != _rows || cols != _cols)
 		throw std::invalid_argument("arrays must have same size");
 	
 	// subtract every element from *this
-	for (int r = 0; r < _rows; ++r) 
-		for (int c = 0; c < _cols; ++c)
-			_matrix[r][c] -= m._matrix[r][c];
+	detail::broadcast_kernel(_data, _rows, _cols, _data, _rows, _cols, m._data, m._rows, m._cols,
+							detail::Minus());
 
 	return *this;
 }
 
+template<typename N>
+Matrix<N>& Matrix<N>::operator-=(const N& scal) {
+	detach();
+	detail::broadcast_kernel(_data, _rows, _cols, _data, _rows, _cols, &scal, 1u, 1u,
+							detail::Minus());
+	return *this;
+}
+
 template<typename N>
 Matrix<N> operator-(Matrix<N> lhs, const Matrix<N>& rhs) {
-	// lhs is a copy, so use -=
+	uint rows, cols;
+	if (!detail::broadcast_shape(lhs.rows(), lhs.cols(), rhs.rows(), rhs.cols(), rows, cols))
+		throw std::invalid_argument("arrays must have same size");
+
+	// lhs is a copy, so use -= when it already has the result shape
+	if (rows == lhs.rows() && cols == lhs.cols()) {
+		lhs -= rhs;
+		return lhs;
+	}
+
+	// read lhs through a const reference so a shared copy is not detached
+	const Matrix<N>& l = lhs;
+	Matrix<N> result (rows, cols, N());
+	detail::broadcast_kernel(result.data(), rows, cols, l.data(), l.rows(), l.cols(),
+							rhs.data(), rhs.rows(), rhs.cols(), detail::Minus());
+	return result;
+}
+
+template<typename N>
+Matrix<N> operator-(Matrix<N> lhs, const N& rhs) {
 	lhs -= rhs;
 	return lhs;
 }
 
+template<typename N>
+Matrix<N> operator-(const N& lhs, Matrix<N> rhs) {
+	N* a = rhs.data();
+	detail::broadcast_kernel(a, rhs.rows(), rhs.cols(), &lhs, 1u, 1u, a, rhs.rows(), rhs.cols(),
+							detail::Minus());
+	return rhs;
+}
+
 
 template<typename N>
 Matrix<N>& Matrix<N>::operator*=(const N& scal) {
+	detach();
 	// multiply each element by scalar
-	for (int r = 0; r < _rows; ++r)
-		for (int c = 0; c < _cols; ++c)
-			_matrix[r][c] *= scal;
-	return *this;	
+	detail::broadcast_kernel(_data, _rows, _cols, _data, _rows, _cols, &scal, 1u, 1u, detail::Times());
+	return *this;
 }
 
 template<typename N>
@@ -467,19 +860,20 @@ Matrix<N>& Matrix<N>::operator*=(const Matrix& m) {
 	if (_cols != m._rows)
 		throw std::invalid_argument("Matrix Multiplication is undefined if m.rows() must equal cols().");
 
-	Matrix<N> result (_rows, m._cols);
-	
-	N sum;
-	for (int r = 0; r < _rows; ++r) {
-		for (int c = 0; c < m._cols; ++c) {
-			sum = N();
-			for (int i = 0; i < _cols; ++i)
-				sum += _matrix[r][i] * m._matrix[i][c];
-
-			result._matrix[r][c] = sum;
-		}
+	Matrix<N> result (_rows, m._cols, N());
+	gemm(_rows, m._cols, _cols, N(1), _data, _cols, m._data, m._cols, N(), result._data, result._cols);
+
+	// take over the result's buffer instead of copying it back; small results are copied
+	if (result._data == result._small) {
+		N* d = allocate(result._size);
+		std::copy(result._small, result._small + result._size, d);
+		if (d != _data) adopt(d);
+	} else {
+		adopt(result._data);
+		result._data = result._small;
 	}
-	(*this) = result;
+	_cols = result._cols;
+	_size = result._size;
 	return *this;			
 }
 
@@ -487,16 +881,15 @@ Matrix<N>& Matrix<N>::operator*=(const Matrix& m) {
 template<typename N>
 Matrix<N> operator*(Matrix<N> lhs, const Matrix<N>& rhs) {
 	lhs *= rhs;
-	return rhs;
+	return lhs;
 }
 
 
 template<typename N>
 Matrix<N>& Matrix<N>::operator/=(const N& scal) {
+	detach();
 	// divide each element by scal
-	for (int r = 0; r < _rows; ++r) 
-		for (int c = 0; c < _cols; ++c)
-			_matrix[r][c] /= scal;
+	detail::broadcast_kernel(_data, _rows, _cols, _data, _rows, _cols, &scal, 1u, 1u, detail::Divides());
 
 	return *this;
 }
@@ -508,12 +901,21 @@ Matrix<N> operator/(Matrix<N> lhs, const N& rhs) {
 }
 
 
+template<typename To, typename From>
+Matrix<To> matrix_cast(const Matrix<From>& m) {
+	Matrix<To> result (m.rows(), m.cols(), To());
+	const From* in = m.data();
+	To* out = result.data();
+	parallel::parallel_for(0, m.size(), [in, out](ul lo, ul hi) {
+		detail::convert<From, To>::run(in + lo, out + lo, hi - lo);
+	});
+	return result;
+}
+
+
 template<typename N>
 Matrix<N>::~Matrix() {
-	for (uint r = 0; r < _rows; ++r) {
-		delete[] _matrix[r];
-	}
-	delete[] _matrix;
+	release();
 }
 
 }	// math
@@ -0,0 +1,338 @@
+/** @file NUMA.hpp
+	Contains the NUMA topology of the host and the page placement policy used
+	for large Matrix buffers.
+
+	The topology is read once from `/sys/devices/system/node`; nodes without
+	CPUs are ignored. Placement uses the `mbind` and `sched_setaffinity` system
+	calls directly, so no libnuma is needed at build or run time. On hosts with
+	a single node, and on other platforms, every call here is a no-op and the
+	library behaves exactly as before.
+
+	With the default `NUMA_FIRST_TOUCH` policy, large buffers are filled by
+	`parallel_for`, whose chunks are claimed node by node (see Parallel.hpp), so
+	each page lands on the node of the threads that later work on that part of
+	the matrix. `NUMA_INTERLEAVE` spreads pages round-robin over every node,
+	which suits buffers read by all threads equally, and `NUMA_BLOCKED` binds
+	the i-th of `nodes()` equal slices to node i.
+
+	A memory policy belongs to the pages, not to the buffer, and outlives a
+	`delete`: on heap memory it would go on to apply to unrelated allocations.
+	`allocate` therefore gives every buffer placed by these two policies on a
+	multi-node host its own anonymous mapping, which `deallocate` unmaps. The cost is one `mmap` and
+	`munmap` per large buffer and a rounding up to whole pages plus one page for
+	the allocation header.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _NUMA_H_
+#define _NUMA_H_
+
+#include <vector>		// vector
+#include <string>		// string
+#include <fstream>		// ifstream
+#include <sstream>		// ostringstream
+#include <cstdlib>		// strtoul
+#include <new>			// operator new, bad_alloc
+#include "typedefs.h"	// uint, ul
+
+#ifdef __linux__
+#include <unistd.h>			// syscall, sysconf
+#include <sched.h>			// sched_getcpu, sched_setaffinity, cpu_set_t
+#include <sys/syscall.h>	// __NR_mbind
+#include <sys/mman.h>		// mmap, munmap
+#endif
+
+
+namespace math {
+namespace numa {
+
+/** Where the pages of large buffers are placed. */
+enum Placement {
+	NUMA_DEFAULT,		/**<serial fill, pages land wherever the kernel puts them*/
+	NUMA_FIRST_TOUCH,	/**<parallel fill, pages land on the node of the thread that fills them*/
+	NUMA_INTERLEAVE,	/**<pages spread round-robin over every node*/
+	NUMA_BLOCKED		/**<buffer split into one contiguous slice per node*/
+};
+
+/** @brief NUMA nodes of the host that have CPUs.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Topology {
+	std::vector<uint> ids;					/**<kernel id of each node*/
+	std::vector<std::vector<uint> > cpus;	/**<CPUs of each node*/
+	std::vector<uint> cpu_node;				/**<index into ids of each CPU's node*/
+};
+
+/** Policy for buffers of at least `min_bytes()`. Defaults to `NUMA_FIRST_TOUCH`.
+	@return reference to the policy so it can be changed at runtime
+*/
+inline Placement& placement() {
+	static Placement p = NUMA_FIRST_TOUCH;
+	return p;
+}
+
+/** Smallest buffer that is placed; smaller buffers fit in a few pages and stay
+	where they are allocated. Defaults to 2 MiB.
+	@return reference to the size in bytes so it can be changed at runtime
+*/
+inline ul& min_bytes() {
+	static ul b = 1ul << 21;
+	return b;
+}
+
+/** Whether the library pool binds each worker to the CPUs of one node, spread
+	round-robin over the nodes. Binding keeps first touch placement stable but
+	overrides the affinity the caller may expect, so it is off by default and
+	never applied on single node hosts. Read when the pool starts, so it must be
+	set before the first parallel operation.
+	@return reference to the flag
+*/
+inline bool& bind_threads() {
+	static bool b = false;
+	return b;
+}
+
+/** Get the host topology, read on first use.
+	@return the nodes and their CPUs, a single node holding every CPU if it cannot be read
+*/
+inline const Topology& topology();
+
+/** Get the number of nodes with CPUs.
+	@return at least 1
+*/
+inline uint nodes() { return static_cast<uint>(topology().ids.size()); }
+
+/** Get the node the calling thread is running on.
+	@return index into `topology().ids`, 0 if unknown
+*/
+inline uint current_node();
+
+/** Restricts the calling thread to the CPUs of a node that it is allowed to run on.
+	@param node - index into `topology().ids`
+	@return true if the affinity was changed
+*/
+inline bool bind_thread(uint node);
+
+/** Applies `placement()` to the whole pages of a buffer. Pages already touched
+	are migrated. Does nothing for buffers under `min_bytes()`, on single node
+	hosts or with the first touch and default policies. The policy stays on the
+	pages after the buffer is freed, so only use this on memory that is unmapped
+	when it is freed, such as buffers from `allocate`.
+	@param p - start of the buffer
+	@param bytes - size of the buffer
+	@return true if a policy was applied
+*/
+inline bool place(void* p, ul bytes);
+
+/** Allocates a buffer with `placement()` applied. Buffers of at least
+	`min_bytes()` under `NUMA_INTERLEAVE` or `NUMA_BLOCKED` on a multi-node host
+	get their own anonymous mapping, so the policy covers every page and ends with the buffer;
+	the rest come from operator new.
+	@param bytes - size of the buffer
+	@return uninitialized memory aligned like operator new, freed with `deallocate`
+	@throw bad_alloc if the memory cannot be allocated
+*/
+inline void* allocate(ul bytes);
+
+/** Frees a buffer from `allocate`.
+	@param p - buffer, may be NULL
+*/
+inline void deallocate(void* p);
+
+
+
+// implementation
+
+namespace detail {
+
+// bytes in front of every buffer from allocate, holding the length of its mapping or 0
+const ul HEADER_BYTES = 64;
+
+inline ul& mapped_length(void* p) {
+	return *reinterpret_cast<ul*>(static_cast<char*>(p) - HEADER_BYTES);
+}
+
+// true if allocate maps buffers of this size under the current policy; place does nothing on one node
+inline bool maps(ul bytes) {
+	return nodes() >= 2 && bytes >= min_bytes() && (placement() == NUMA_INTERLEAVE || placement() == NUMA_BLOCKED);
+}
+
+inline void* heap_allocate(ul bytes) {
+	void* p = static_cast<char*>(::operator new(bytes + HEADER_BYTES)) + HEADER_BYTES;
+	mapped_length(p) = 0;
+	return p;
+}
+
+// parses a kernel cpu list such as "0-3,8,10-11"
+inline std::vector<uint> parse_list(const std::string& s) {
+	std::vector<uint> out;
+	const char* c = s.c_str();
+	while (*c) {
+		char* end;
+		ul lo = std::strtoul(c, &end, 10);
+		if (end == c) break;
+		ul hi = lo;
+		c = end;
+		if (*c == '-') {
+			hi = std::strtoul(c + 1, &end, 10);
+			c = end;
+		}
+		for (ul i = lo; i <= hi; ++i) out.push_back(static_cast<uint>(i));
+		while (*c == ',' || *c == '\n' || *c == ' ') ++c;
+	}
+	return out;
+}
+
+inline std::string read_line(const std::string& path) {
+	std::ifstream in (path.c_str());
+	std::string line;
+	std::getline(in, line);
+	return line;
+}
+
+inline Topology load_topology() {
+	Topology t;
+	std::vector<uint> online = parse_list(read_line("/sys/devices/system/node/online"));
+	for (ul i = 0; i < online.size(); ++i) {
+		std::ostringstream path;
+		path << "/sys/devices/system/node/node" << online[i] << "/cpulist";
+		std::vector<uint> cpus = parse_list(read_line(path.str()));
+		if (cpus.empty()) continue;
+		t.ids.push_back(online[i]);
+		t.cpus.push_back(cpus);
+	}
+
+	if (t.ids.empty()) {
+		t.ids.assign(1, 0);
+		t.cpus.assign(1, std::vector<uint>());
+		return t;
+	}
+	for (ul n = 0; n < t.cpus.size(); ++n)
+		for (ul c = 0; c < t.cpus[n].size(); ++c) {
+			uint cpu = t.cpus[n][c];
+			if (cpu >= t.cpu_node.size()) t.cpu_node.resize(cpu + 1, 0);
+			t.cpu_node[cpu] = static_cast<uint>(n);
+		}
+	return t;
+}
+
+#ifdef __linux__
+
+// mbind modes and flags from linux/mempolicy.h
+const int MPOL_BIND_MODE = 2;
+const int MPOL_INTERLEAVE_MODE = 3;
+const unsigned MPOL_MOVE = 1u << 1;
+
+inline bool bind_range(void* p, ul bytes, int mode, const std::vector<uint>& ids) {
+	const ul bits = 8 * sizeof(unsigned long);
+	std::vector<unsigned long> mask (1, 0);
+	for (ul i = 0; i < ids.size(); ++i) {
+		if (ids[i] / bits >= mask.size()) mask.resize(ids[i] / bits + 1, 0);
+		mask[ids[i] / bits] |= 1ul << (ids[i] % bits);
+	}
+	// the kernel reads one bit less than maxnode
+	return syscall(__NR_mbind, p, bytes, mode, mask.data(), mask.size() * bits + 1, MPOL_MOVE) == 0;
+}
+
+#endif
+
+}	// detail
+
+
+inline const Topology& topology() {
+	static const Topology t = detail::load_topology();
+	return t;
+}
+
+#ifdef __linux__
+
+inline uint current_node() {
+	const Topology& t = topology();
+	int cpu = sched_getcpu();
+	return (cpu >= 0 && static_cast<ul>(cpu) < t.cpu_node.size()) ? t.cpu_node[cpu] : 0;
+}
+
+inline bool bind_thread(uint node) {
+	const Topology& t = topology();
+	if (node >= t.cpus.size()) return false;
+
+	// stay inside the affinity the process was started with
+	cpu_set_t allowed, set;
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return false;
+	CPU_ZERO(&set);
+	for (ul c = 0; c < t.cpus[node].size(); ++c)
+		if (t.cpus[node][c] < CPU_SETSIZE && CPU_ISSET(t.cpus[node][c], &allowed)) CPU_SET(t.cpus[node][c], &set);
+	if (CPU_COUNT(&set) == 0) return false;
+	return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+inline bool place(void* p, ul bytes) {
+	Placement policy = placement();
+	if (bytes < min_bytes() || nodes() < 2 || (policy != NUMA_INTERLEAVE && policy != NUMA_BLOCKED)) return false;
+
+	// mbind works on whole pages, so the partial pages at either end are left alone
+	const ul page = static_cast<ul>(sysconf(_SC_PAGESIZE));
+	ul lo = (reinterpret_cast<ul>(p) + page - 1) / page * page;
+	ul hi = (reinterpret_cast<ul>(p) + bytes) / page * page;
+	if (hi <= lo) return false;
+
+	const Topology& t = topology();
+	if (policy == NUMA_INTERLEAVE)
+		return detail::bind_range(reinterpret_cast<void*>(lo), hi - lo, detail::MPOL_INTERLEAVE_MODE, t.ids);
+
+	bool ok = true;
+	ul pages = (hi - lo) / page, n = t.ids.size();
+	for (ul i = 0; i < n; ++i) {
+		ul first = lo + pages * i / n * page, last = lo + pages * (i + 1) / n * page;
+		if (first < last)
+			ok = detail::bind_range(reinterpret_cast<void*>(first), last - first, detail::MPOL_BIND_MODE,
+				std::vector<uint>(1, t.ids[i])) && ok;
+	}
+	return ok;
+}
+
+inline void* allocate(ul bytes) {
+	if (!detail::maps(bytes)) return detail::heap_allocate(bytes);
+
+	// the header takes the first page so the buffer itself starts on a page
+	const ul page = static_cast<ul>(sysconf(_SC_PAGESIZE));
+	ul length = page + (bytes + page - 1) / page * page;
+	void* m = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (m == MAP_FAILED) throw std::bad_alloc();
+
+	void* p = static_cast<char*>(m) + page;
+	detail::mapped_length(p) = length;
+	place(p, length - page);
+	return p;
+}
+
+inline void deallocate(void* p) {
+	if (!p) return;
+	ul length = detail::mapped_length(p);
+	if (length) munmap(static_cast<char*>(p) - sysconf(_SC_PAGESIZE), length);
+	else ::operator delete(static_cast<char*>(p) - detail::HEADER_BYTES);
+}
+
+#else
+
+inline uint current_node() { return 0; }
+
+inline bool bind_thread(uint) { return false; }
+
+inline bool place(void*, ul) { return false; }
+
+inline void* allocate(ul bytes) { return detail::heap_allocate(bytes); }
+
+inline void deallocate(void* p) {
+	if (p) ::operator delete(static_cast<char*>(p) - detail::HEADER_BYTES);
+}
+
+#endif
+
+}	// numa
+}	// math
+
+#endif
@@ -0,0 +1,573 @@
+/** @file OutOfCore.hpp
+	Contains a disk-backed tiled matrix for data larger than memory, with a bounded
+	LRU tile cache and asynchronous prefetching, plus out-of-core gemm, transpose
+	and reductions that stream tiles through that cache.
+
+	The file holds a 64 byte header followed by square tile x tile tiles in
+	row-major tile order. Edge tiles are padded with zeros so every tile has the
+	same size and offset arithmetic, and so full tile products stay exact. Tiles are
+	read and written with pread/pwrite on a local file.
+
+	At most `cache_tiles` tiles are cached, plus at most `cache_tiles` prefetches
+	in flight. Dirty tiles are written back on eviction, `flush()` and destruction.
+	A DiskMatrix is not safe to use from several threads at once.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _OUT_OF_CORE_H_
+#define _OUT_OF_CORE_H_
+
+#include <string>			// string
+#include <vector>			// vector
+#include <list>				// list
+#include <unordered_map>	// unordered_map
+#include <memory>			// shared_ptr
+#include <future>			// async, shared_future
+#include <algorithm>		// copy, fill, min
+#include <functional>		// plus
+#include <cstring>			// memcpy, memcmp
+#include <stdexcept>		// invalid_argument, runtime_error
+#include <stdint.h>			// uint64_t
+#include <fcntl.h>			// open
+#include <unistd.h>			// pread, pwrite, close, ftruncate
+#include <sys/stat.h>		// fstat
+#include "Matrix.hpp"		// Matrix
+#include "Gemm.hpp"			// gemm
+#include "typedefs.h"		// uint, ul
+
+
+namespace math {
+
+
+/** @brief rows x cols matrix stored in a file as square tiles, with an LRU cache
+	of tiles in memory.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class DiskMatrix {
+	public:
+		/** read-only view of one tile, tile x tile elements row-major */
+		typedef std::shared_ptr<const std::vector<N> > TilePtr;
+
+		/** Creates (or truncates) the file at path and fills the matrix with zeros.
+			@param path - file to create
+			@param rows - number of rows
+			@param cols - number of columns
+			@param tile - tile edge length
+			@param cache_tiles - number of tiles kept in memory
+			@throw invalid_argument if tile or cache_tiles is 0
+			@throw runtime_error if the file cannot be created
+		*/
+		DiskMatrix(const std::string& path, uint rows, uint cols, uint tile, uint cache_tiles);
+
+		/** Opens a matrix previously written by DiskMatrix.
+			@param path - file to open
+			@param cache_tiles - number of tiles kept in memory
+			@throw invalid_argument if cache_tiles is 0
+			@throw runtime_error if the file cannot be read, was written for another element type
+				or is shorter than its header's shape implies
+		*/
+		DiskMatrix(const std::string& path, uint cache_tiles);
+
+		/** Destructor. Writes back dirty tiles and closes the file. */
+		~DiskMatrix();
+
+		/** Get element r, c, loading its tile if needed.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c);
+
+		/** Set element r, c, loading its tile if needed.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Get tile tr, tc, from the cache or the file. The view stays valid after
+			eviction; its contents change if the tile is written while cached.
+			@param tr - tile row
+			@param tc - tile column
+			@return the tile
+			@throw invalid_argument if the tile is out of range
+		*/
+		TilePtr load(uint tr, uint tc);
+
+		/** Replaces tile tr, tc. Entries past the edge of the matrix must be zero.
+			@param tr - tile row
+			@param tc - tile column
+			@param data - tile x tile elements row-major
+			@throw invalid_argument if the tile is out of range
+		*/
+		void store(uint tr, uint tc, const N* data);
+
+		/** Starts reading tile tr, tc in the background if it is neither cached nor
+			already in flight. Out of range tiles are ignored.
+			@param tr - tile row
+			@param tc - tile column
+		*/
+		void prefetch(uint tr, uint tc);
+
+		/** Writes every dirty cached tile back to the file. */
+		void flush();
+
+		/** Copies a dense matrix of the same shape into the file.
+			@param m - rows x cols matrix
+			@throw invalid_argument if the shapes do not agree
+		*/
+		void assign(const Matrix<N>& m);
+
+		/** Reads the whole matrix into memory.
+			@return a new rows x cols Matrix
+		*/
+		Matrix<N> dense();
+
+		/** Get the number of rows. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _cols; }
+
+		/** Get the tile edge length. */
+		uint tile_size() const { return _tile; }
+
+		/** Get the number of tile rows. */
+		uint tile_rows() const { return (_rows + _tile - 1) / _tile; }
+
+		/** Get the number of tile columns. */
+		uint tile_cols() const { return (_cols + _tile - 1) / _tile; }
+
+		/** Get the maximum number of cached tiles. */
+		uint cache_tiles() const { return _capacity; }
+
+		/** Get the number of tile requests served from the cache or a finished prefetch. */
+		ul hits() const { return _hits; }
+
+		/** Get the number of tile requests that had to read the file synchronously. */
+		ul misses() const { return _misses; }
+
+	private:
+		typedef std::shared_ptr<std::vector<N> > Buffer;
+
+		struct Entry {
+			Buffer data;						/**<tile contents*/
+			bool dirty;							/**<true if the file copy is stale*/
+			std::list<ul>::iterator lru;		/**<position in _lru*/
+		};
+
+		DiskMatrix(const DiskMatrix&);
+		DiskMatrix& operator=(const DiskMatrix&);
+
+		ul tile_elements() const { return static_cast<ul>(_tile) * _tile; }
+		ul key(uint tr, uint tc) const;
+		Buffer read(ul k) const;
+		void write(ul k, const std::vector<N>& data) const;
+		Entry& entry(ul k);
+		void insert(ul k, Buffer data, bool dirty);
+
+		int _fd;									/**<file descriptor*/
+		uint _rows;									/**<number of rows*/
+		uint _cols;									/**<number of columns*/
+		uint _tile;									/**<tile edge length*/
+		uint _capacity;								/**<maximum cached tiles*/
+		ul _hits;									/**<cache and prefetch hits*/
+		ul _misses;									/**<synchronous reads*/
+		std::unordered_map<ul, Entry> _cache;		/**<cached tiles by key*/
+		std::list<ul> _lru;							/**<cached keys, most recent first*/
+		std::unordered_map<ul, std::shared_future<Buffer> > _inflight;	/**<pending prefetches*/
+};
+
+
+/**	Computes `C = A * B` tile by tile. Each output tile accumulates the products of
+	a tile row of A and a tile column of B in memory, prefetching the next pair of
+	tiles while the current pair is multiplied. Output tiles are visited row by row
+	so a cache of `A.tile_cols() + 2` tiles reuses the panel of A.
+	@param A - m x k disk matrix
+	@param B - k x n disk matrix
+	@param C - m x n disk matrix, a different file from A and B
+	@throw invalid_argument if the shapes or tile sizes do not agree
+*/
+template<typename N>
+void disk_gemm(DiskMatrix<N>& A, DiskMatrix<N>& B, DiskMatrix<N>& C);
+
+/**	Computes `T = A^T` tile by tile, prefetching the next tile of A.
+	@param A - m x n disk matrix
+	@param T - n x m disk matrix, a different file from A
+	@throw invalid_argument if the shapes or tile sizes do not agree
+*/
+template<typename N>
+void disk_transpose(DiskMatrix<N>& A, DiskMatrix<N>& T);
+
+/**	Folds every element of A into `init` in tile order with `acc = f(acc, x)`,
+	prefetching the next tile. The zero padding is skipped.
+	@param A - disk matrix
+	@param init - starting value
+	@param f - fold function
+	@return the folded value
+*/
+template<typename N, typename T, typename F>
+T disk_reduce(DiskMatrix<N>& A, T init, F f);
+
+/**	Sum of every element of A.
+	@param A - disk matrix
+	@return the sum
+*/
+template<typename N>
+N disk_sum(DiskMatrix<N>& A);
+
+
+/** double precision disk matrix */
+typedef DiskMatrix<double> dDiskMatrix;
+/** single precision disk matrix */
+typedef DiskMatrix<float> fDiskMatrix;
+
+
+
+// implementation
+
+namespace detail {
+
+struct DiskHeader {
+	char magic[8];			/**<"GPMLDSK1"*/
+	uint64_t rows;			/**<number of rows*/
+	uint64_t cols;			/**<number of columns*/
+	uint64_t tile;			/**<tile edge length*/
+	uint64_t elem_size;		/**<sizeof(N) when written*/
+	char pad[24];			/**<pads the header to 64 bytes*/
+};
+
+const ul disk_header_size = 64;
+
+// pread/pwrite until every byte is moved; false on error or end of file
+inline bool pread_all(int fd, void* buf, ul n, ul off) {
+	char* p = static_cast<char*>(buf);
+	while (n > 0) {
+		ssize_t got = ::pread(fd, p, n, static_cast<off_t>(off));
+		if (got <= 0) return false;
+		p += got; off += got; n -= got;
+	}
+	return true;
+}
+
+inline bool pwrite_all(int fd, const void* buf, ul n, ul off) {
+	const char* p = static_cast<const char*>(buf);
+	while (n > 0) {
+		ssize_t put = ::pwrite(fd, p, n, static_cast<off_t>(off));
+		if (put <= 0) return false;
+		p += put; off += put; n -= put;
+	}
+	return true;
+}
+
+}	// detail
+
+
+template<typename N>
+DiskMatrix<N>::DiskMatrix(const std::string& path, uint rows, uint cols, uint tile, uint cache_tiles)
+	: _fd(-1), _rows(rows), _cols(cols), _tile(tile), _capacity(cache_tiles), _hits(0), _misses(0) {
+	if (tile == 0 || cache_tiles == 0)
+		throw std::invalid_argument("tile size and cache size must be positive");
+
+	_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (_fd < 0)
+		throw std::runtime_error("cannot create " + path);
+
+	detail::DiskHeader h;
+	std::memset(&h, 0, sizeof(h));
+	std::memcpy(h.magic, "GPMLDSK1", 8);
+	h.rows = rows; h.cols = cols; h.tile = tile; h.elem_size = sizeof(N);
+
+	// the file is extended without writing, so unwritten tiles read back as zeros
+	ul bytes = detail::disk_header_size + static_cast<ul>(tile_rows()) * tile_cols() * tile_elements() * sizeof(N);
+	if (!detail::pwrite_all(_fd, &h, sizeof(h), 0) || ::ftruncate(_fd, static_cast<off_t>(bytes)) != 0) {
+		::close(_fd);
+		throw std::runtime_error("cannot size " + path);
+	}
+}
+
+template<typename N>
+DiskMatrix<N>::DiskMatrix(const std::string& path, uint cache_tiles)
+	: _fd(-1), _rows(0), _cols(0), _tile(0), _capacity(cache_tiles), _hits(0), _misses(0) {
+	if (cache_tiles == 0)
+		throw std::invalid_argument("cache size must be positive");
+
+	_fd = ::open(path.c_str(), O_RDWR);
+	if (_fd < 0)
+		throw std::runtime_error("cannot open " + path);
+
+	detail::DiskHeader h;
+	if (!detail::pread_all(_fd, &h, sizeof(h), 0) || std::memcmp(h.magic, "GPMLDSK1", 8) != 0
+		|| h.elem_size != sizeof(N) || h.tile == 0) {
+		::close(_fd);
+		throw std::runtime_error(path + " is not a disk matrix of this element type");
+	}
+	_rows = static_cast<uint>(h.rows);
+	_cols = static_cast<uint>(h.cols);
+	_tile = static_cast<uint>(h.tile);
+
+	// a truncated file would otherwise only fail later as a short tile read
+	struct stat st;
+	ul bytes = detail::disk_header_size + static_cast<ul>(tile_rows()) * tile_cols() * tile_elements() * sizeof(N);
+	if (h.rows != _rows || h.cols != _cols || h.tile != _tile
+		|| ::fstat(_fd, &st) != 0 || static_cast<ul>(st.st_size) < bytes) {
+		::close(_fd);
+		throw std::runtime_error(path + " is shorter than its header says");
+	}
+}
+
+template<typename N>
+DiskMatrix<N>::~DiskMatrix() {
+	try {
+		for (typename std::unordered_map<ul, std::shared_future<Buffer> >::iterator it = _inflight.begin(); it != _inflight.end(); ++it)
+			it->second.wait();
+		flush();
+	} catch (...) {}
+	::close(_fd);
+}
+
+template<typename N>
+ul DiskMatrix<N>::key(uint tr, uint tc) const {
+	if (tr >= tile_rows() || tc >= tile_cols())
+		throw std::invalid_argument("tile out of range");
+	return static_cast<ul>(tr) * tile_cols() + tc;
+}
+
+template<typename N>
+typename DiskMatrix<N>::Buffer DiskMatrix<N>::read(ul k) const {
+	Buffer b = std::make_shared<std::vector<N> >(tile_elements());
+	ul bytes = tile_elements() * sizeof(N);
+	if (!detail::pread_all(_fd, b->data(), bytes, detail::disk_header_size + k * bytes))
+		throw std::runtime_error("tile read failed");
+	return b;
+}
+
+template<typename N>
+void DiskMatrix<N>::write(ul k, const std::vector<N>& data) const {
+	ul bytes = tile_elements() * sizeof(N);
+	if (!detail::pwrite_all(_fd, data.data(), bytes, detail::disk_header_size + k * bytes))
+		throw std::runtime_error("tile write failed");
+}
+
+template<typename N>
+void DiskMatrix<N>::insert(ul k, Buffer data, bool dirty) {
+	while (_cache.size() >= _capacity) {
+		ul victim = _lru.back();
+		Entry& e = _cache[victim];
+		if (e.dirty) write(victim, *e.data);
+		_lru.pop_back();
+		_cache.erase(victim);
+	}
+	_lru.push_front(k);
+	Entry e = { data, dirty, _lru.begin() };
+	_cache[k] = e;
+}
+
+template<typename N>
+typename DiskMatrix<N>::Entry& DiskMatrix<N>::entry(ul k) {
+	typename std::unordered_map<ul, Entry>::iterator it = _cache.find(k);
+	if (it != _cache.end()) {
+		++_hits;
+		_lru.splice(_lru.begin(), _lru, it->second.lru);
+		return it->second;
+	}
+
+	Buffer b;
+	typename std::unordered_map<ul, std::shared_future<Buffer> >::iterator f = _inflight.find(k);
+	if (f != _inflight.end()) {
+		++_hits;
+		b = f->second.get();
+		_inflight.erase(f);
+	} else {
+		++_misses;
+		b = read(k);
+	}
+	insert(k, b, false);
+	return _cache[k];
+}
+
+template<typename N>
+N DiskMatrix<N>::at(uint r, uint c) {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	return (*entry(key(r / _tile, c / _tile)).data)[static_cast<ul>(r % _tile) * _tile + c % _tile];
+}
+
+template<typename N>
+void DiskMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	Entry& e = entry(key(r / _tile, c / _tile));
+	(*e.data)[static_cast<ul>(r % _tile) * _tile + c % _tile] = val;
+	e.dirty = true;
+}
+
+template<typename N>
+typename DiskMatrix<N>::TilePtr DiskMatrix<N>::load(uint tr, uint tc) {
+	return entry(key(tr, tc)).data;
+}
+
+template<typename N>
+void DiskMatrix<N>::store(uint tr, uint tc, const N* data) {
+	ul k = key(tr, tc);
+
+	// a pending read of this tile would bring back stale contents
+	typename std::unordered_map<ul, std::shared_future<Buffer> >::iterator f = _inflight.find(k);
+	if (f != _inflight.end()) {
+		f->second.wait();
+		_inflight.erase(f);
+	}
+
+	typename std::unordered_map<ul, Entry>::iterator it = _cache.find(k);
+	if (it != _cache.end()) {
+		std::copy(data, data + tile_elements(), it->second.data->begin());
+		it->second.dirty = true;
+		_lru.splice(_lru.begin(), _lru, it->second.lru);
+	} else {
+		insert(k, std::make_shared<std::vector<N> >(data, data + tile_elements()), true);
+	}
+}
+
+template<typename N>
+void DiskMatrix<N>::prefetch(uint tr, uint tc) {
+	if (tr >= tile_rows() || tc >= tile_cols()) return;
+
+	ul k = key(tr, tc);
+	if (_cache.count(k) || _inflight.count(k) || _inflight.size() >= _capacity) return;
+
+	const DiskMatrix* self = this;
+	_inflight[k] = std::async(std::launch::async, [self, k]() { return self->read(k); }).share();
+}
+
+template<typename N>
+void DiskMatrix<N>::flush() {
+	for (typename std::unordered_map<ul, Entry>::iterator it = _cache.begin(); it != _cache.end(); ++it) {
+		if (!it->second.dirty) continue;
+		write(it->first, *it->second.data);
+		it->second.dirty = false;
+	}
+}
+
+template<typename N>
+void DiskMatrix<N>::assign(const Matrix<N>& m) {
+	if (m.rows() != _rows || m.cols() != _cols)
+		throw std::invalid_argument("matrix shape does not match disk matrix");
+
+	std::vector<N> buf (tile_elements());
+	for (uint tr = 0; tr < tile_rows(); ++tr) {
+		for (uint tc = 0; tc < tile_cols(); ++tc) {
+			std::fill(buf.begin(), buf.end(), N());
+			uint r1 = std::min(_tile, _rows - tr * _tile), c1 = std::min(_tile, _cols - tc * _tile);
+			for (uint i = 0; i < r1; ++i) {
+				const N* src = m.data() + static_cast<ul>(tr * _tile + i) * _cols + static_cast<ul>(tc) * _tile;
+				std::copy(src, src + c1, buf.begin() + static_cast<ul>(i) * _tile);
+			}
+			store(tr, tc, buf.data());
+		}
+	}
+}
+
+template<typename N>
+Matrix<N> DiskMatrix<N>::dense() {
+	Matrix<N> m (_rows, _cols, N());
+	for (uint tr = 0; tr < tile_rows(); ++tr) {
+		for (uint tc = 0; tc < tile_cols(); ++tc) {
+			TilePtr t = load(tr, tc);
+			uint r1 = std::min(_tile, _rows - tr * _tile), c1 = std::min(_tile, _cols - tc * _tile);
+			for (uint i = 0; i < r1; ++i)
+				std::copy(t->begin() + static_cast<ul>(i) * _tile, t->begin() + static_cast<ul>(i) * _tile + c1,
+					m.data() + static_cast<ul>(tr * _tile + i) * _cols + static_cast<ul>(tc) * _tile);
+		}
+	}
+	return m;
+}
+
+
+template<typename N>
+void disk_gemm(DiskMatrix<N>& A, DiskMatrix<N>& B, DiskMatrix<N>& C) {
+	if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+		throw std::invalid_argument("Matrix Multiplication is undefined if m.rows() must equal cols().");
+	if (A.tile_size() != B.tile_size() || A.tile_size() != C.tile_size())
+		throw std::invalid_argument("disk matrices must share a tile size");
+
+	uint ts = A.tile_size(), tm = C.tile_rows(), tn = C.tile_cols(), tk = A.tile_cols();
+	std::vector<N> acc (static_cast<ul>(ts) * ts);
+	for (uint i = 0; i < tm; ++i) {
+		for (uint j = 0; j < tn; ++j) {
+			std::fill(acc.begin(), acc.end(), N());
+			for (uint p = 0; p < tk; ++p) {
+				// the next pair in the schedule, wrapping to the next output tile
+				if (p + 1 < tk) { A.prefetch(i, p + 1); B.prefetch(p + 1, j); }
+				else if (j + 1 < tn) { A.prefetch(i, 0); B.prefetch(0, j + 1); }
+				else if (i + 1 < tm) { A.prefetch(i + 1, 0); B.prefetch(0, 0); }
+
+				typename DiskMatrix<N>::TilePtr a = A.load(i, p), b = B.load(p, j);
+				gemm(ts, ts, ts, N(1), a->data(), ts, b->data(), ts, N(1), acc.data(), ts);
+			}
+			C.store(i, j, acc.data());
+		}
+	}
+}
+
+template<typename N>
+void disk_transpose(DiskMatrix<N>& A, DiskMatrix<N>& T) {
+	if (T.rows() != A.cols() || T.cols() != A.rows())
+		throw std::invalid_argument("transpose needs a cols x rows destination");
+	if (A.tile_size() != T.tile_size())
+		throw std::invalid_argument("disk matrices must share a tile size");
+
+	uint ts = A.tile_size(), tm = A.tile_rows(), tn = A.tile_cols();
+	std::vector<N> out (static_cast<ul>(ts) * ts);
+	for (uint i = 0; i < tm; ++i) {
+		for (uint j = 0; j < tn; ++j) {
+			if (j + 1 < tn) A.prefetch(i, j + 1);
+			else A.prefetch(i + 1, 0);
+
+			typename DiskMatrix<N>::TilePtr a = A.load(i, j);
+			const N* in = a->data();
+			for (uint r = 0; r < ts; ++r)
+				for (uint c = 0; c < ts; ++c) out[static_cast<ul>(c) * ts + r] = in[static_cast<ul>(r) * ts + c];
+			T.store(j, i, out.data());
+		}
+	}
+}
+
+template<typename N, typename T, typename F>
+T disk_reduce(DiskMatrix<N>& A, T init, F f) {
+	uint ts = A.tile_size(), tm = A.tile_rows(), tn = A.tile_cols();
+	for (uint i = 0; i < tm; ++i) {
+		uint r1 = std::min(ts, A.rows() - i * ts);
+		for (uint j = 0; j < tn; ++j) {
+			if (j + 1 < tn) A.prefetch(i, j + 1);
+			else A.prefetch(i + 1, 0);
+
+			typename DiskMatrix<N>::TilePtr a = A.load(i, j);
+			uint c1 = std::min(ts, A.cols() - j * ts);
+			for (uint r = 0; r < r1; ++r) {
+				const N* row = a->data() + static_cast<ul>(r) * ts;
+				for (uint c = 0; c < c1; ++c) init = f(init, row[c]);
+			}
+		}
+	}
+	return init;
+}
+
+template<typename N>
+N disk_sum(DiskMatrix<N>& A) {
+	return disk_reduce(A, N(), std::plus<N>());
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,857 @@
+/** @file Packed.hpp
+	Contains symmetric and triangular matrices in packed storage along with their
+	kernels: symv and symm for symmetric, trmv, trmm, trsv and trsm for triangular.
+	Symmetric systems are solved in the packed storage by Cholesky (pptrf, pptrs)
+	when positive definite and by Bunch-Kaufman LDL^T (sptrf, sptrs) otherwise.
+
+	Both store one triangle row by row, n * (n + 1) / 2 elements instead of n^2.
+	Every kernel walks the packed rows with unit stride so they reuse the dot and
+	axpy kernels from Vector.hpp. The matrix kernels split the columns of the dense
+	operand across the thread pool, which keeps the updates of different threads
+	disjoint.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _PACKED_H_
+#define _PACKED_H_
+
+#include <vector>		// vector
+#include <algorithm>	// copy, fill, swap, swap_ranges
+#include <cmath>		// sqrt, fabs
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix
+#include "Vector.hpp"	// Vector, dot_kernel, axpy_kernel
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief Which triangle of a matrix is stored. */
+enum Triangle {
+	LOWER,		/**<entries with c <= r*/
+	UPPER		/**<entries with c >= r*/
+};
+
+
+/** @brief Symmetric n x n matrix storing only its lower triangle, packed by rows:
+	element (r, c) with c <= r lives at `r * (r + 1) / 2 + c`.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class SymmetricMatrix {
+	public:
+		/** Creates an n x n symmetric matrix with every entry set to fill.
+			@param n - number of rows and columns
+			@param fill - default value for every entry
+		*/
+		SymmetricMatrix(uint n, const N& fill);
+
+		/** Packs the lower triangle of a dense square matrix. The upper triangle is
+			not read.
+			@param m - square matrix to pack
+			@throw invalid_argument if m is not square
+		*/
+		explicit SymmetricMatrix(const Matrix<N>& m);
+
+		/** Get element r, c. Either triangle may be addressed.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Set element r, c, and therefore c, r.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Unchecked access to stored element r, c with c <= r. */
+		N& operator()(uint r, uint c) { return _data[index(r, c)]; }
+
+		/** Unchecked access to stored element r, c with c <= r. */
+		const N& operator()(uint r, uint c) const { return _data[index(r, c)]; }
+
+		/** Get the number of rows. */
+		uint rows() const { return _n; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _n; }
+
+		/** Get the number of stored elements, n * (n + 1) / 2. */
+		ul size() const { return _data.size(); }
+
+		/** Get the packed buffer. Row r starts at `r * (r + 1) / 2`. */
+		N* data() { return _data.data(); }
+
+		/** Get the packed buffer. Row r starts at `r * (r + 1) / 2`. */
+		const N* data() const { return _data.data(); }
+
+		/** Expands to a dense matrix.
+			@return a new n x n Matrix
+		*/
+		Matrix<N> dense() const;
+
+	private:
+		static ul index(uint r, uint c) { return static_cast<ul>(r) * (r + 1) / 2 + c; }
+
+		uint _n;				/**<number of rows and columns*/
+		std::vector<N> _data;	/**<packed lower triangle*/
+};
+
+
+/** @brief Lower or upper triangular n x n matrix in packed row storage. Lower
+	rows hold columns 0..r, upper rows hold columns r..n-1.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class TriangularMatrix {
+	public:
+		/** Creates an n x n triangular matrix with the stored triangle set to fill.
+			@param n - number of rows and columns
+			@param uplo - which triangle is stored
+			@param fill - default value for every stored entry
+		*/
+		TriangularMatrix(uint n, Triangle uplo, const N& fill);
+
+		/** Packs one triangle of a dense square matrix. The other is not read.
+			@param m - square matrix to pack
+			@param uplo - which triangle to keep
+			@throw invalid_argument if m is not square
+		*/
+		TriangularMatrix(const Matrix<N>& m, Triangle uplo);
+
+		/** Get element r, c; zero outside the stored triangle.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Set element r, c inside the stored triangle.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r, c is out of range or outside the triangle
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Unchecked access to stored element r, c. */
+		N& operator()(uint r, uint c) { return _data[index(r, c)]; }
+
+		/** Unchecked access to stored element r, c. */
+		const N& operator()(uint r, uint c) const { return _data[index(r, c)]; }
+
+		/** Get the stored triangle. */
+		Triangle uplo() const { return _uplo; }
+
+		/** Get the number of rows. */
+		uint rows() const { return _n; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _n; }
+
+		/** Get the number of stored elements, n * (n + 1) / 2. */
+		ul size() const { return _data.size(); }
+
+		/** Get the packed buffer. */
+		N* data() { return _data.data(); }
+
+		/** Get the packed buffer. */
+		const N* data() const { return _data.data(); }
+
+		/** Get a pointer to the first stored element of row r and the column it
+			belongs to (0 for lower, r for upper).
+			@param r - row
+			@return pointer into the packed buffer
+		*/
+		const N* row(uint r) const { return _data.data() + index(r, _uplo == LOWER ? 0 : r); }
+
+		/** Expands to a dense matrix with zeros outside the triangle.
+			@return a new n x n Matrix
+		*/
+		Matrix<N> dense() const;
+
+	private:
+		ul index(uint r, uint c) const {
+			return (_uplo == LOWER) ? static_cast<ul>(r) * (r + 1) / 2 + c
+				: static_cast<ul>(r) * _n - static_cast<ul>(r) * (r - 1) / 2 + (c - r);
+		}
+
+		uint _n;				/**<number of rows and columns*/
+		Triangle _uplo;			/**<stored triangle*/
+		std::vector<N> _data;	/**<packed triangle*/
+};
+
+
+/**	Computes `y = alpha * S * x + beta * y`. Each stored element is read once and
+	used for both of its mirror positions.
+	@param alpha - scale applied to `S * x`
+	@param S - n x n symmetric matrix
+	@param x - vector of size n
+	@param beta - scale applied to y first. When zero y is not read.
+	@param y - vector of size n updated in place
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void symv(const N& alpha, const SymmetricMatrix<N>& S, const Vector<N>& x, const N& beta, Vector<N>& y);
+
+/**	Computes `C = alpha * S * B + beta * C` for symmetric S and dense B and C.
+	@param alpha - scale applied to `S * B`
+	@param S - n x n symmetric matrix
+	@param B - n x m matrix
+	@param beta - scale applied to C first. When zero C is not read.
+	@param C - n x m matrix updated in place
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void symm(const N& alpha, const SymmetricMatrix<N>& S, const Matrix<N>& B, const N& beta, Matrix<N>& C);
+
+/**	Computes `x = T * x` in place.
+	@param T - n x n triangular matrix
+	@param x - vector of size n
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void trmv(const TriangularMatrix<N>& T, Vector<N>& x);
+
+/**	Computes `B = T * B` in place.
+	@param T - n x n triangular matrix
+	@param B - n x m matrix
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void trmm(const TriangularMatrix<N>& T, Matrix<N>& B);
+
+/**	Solves `T x = b` in place by forward or backward substitution.
+	@param T - n x n triangular matrix
+	@param b - right hand side of size n, overwritten by x
+	@throw invalid_argument if the sizes do not agree or T has a zero on its diagonal
+*/
+template<typename N>
+void trsv(const TriangularMatrix<N>& T, Vector<N>& b);
+
+/**	Solves `T X = B` in place for every column of B.
+	@param T - n x n triangular matrix
+	@param B - n x m right hand sides, overwritten by X
+	@throw invalid_argument if the shapes do not agree or T has a zero on its diagonal
+*/
+template<typename N>
+void trsm(const TriangularMatrix<N>& T, Matrix<N>& B);
+
+/**	Cholesky factorization `S = L L^T` in place, in O(n^3 / 3) with every inner
+	product over unit-stride packed rows. S is overwritten by L, which takes the
+	same packed lower storage, and is then only meaningful to `pptrs`.
+	@param S - n x n symmetric positive definite matrix, overwritten by L
+	@throw invalid_argument if S is not positive definite
+*/
+template<typename N>
+void pptrf(SymmetricMatrix<N>& S);
+
+/**	Solves `A x = b` from the Cholesky factor of A.
+	@param L - factor from `pptrf`
+	@param b - right hand side of size n, overwritten by x
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void pptrs(const SymmetricMatrix<N>& L, Vector<N>& b);
+
+/**	Solves `A X = B` from the Cholesky factor of A for every column of B.
+	@param L - factor from `pptrf`
+	@param B - n x m right hand sides, overwritten by X
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void pptrs(const SymmetricMatrix<N>& L, Matrix<N>& B);
+
+/**	Factorizes a symmetric, possibly indefinite, matrix as `P L D L^T P^T` in place
+	with Bunch-Kaufman diagonal pivoting, as LAPACK's sptrf. D has 1 x 1 and 2 x 2
+	blocks and L is unit lower triangular; both overwrite S.
+	@param S - n x n symmetric matrix, overwritten by L and D
+	@param piv - set to n pivots: `piv[k] = p >= 0` for a 1 x 1 block at k after
+		swapping rows k and p, `piv[k] = piv[k + 1] = -(p + 1)` for a 2 x 2 block at
+		k, k + 1 after swapping rows k + 1 and p
+	@throw invalid_argument if S is singular
+*/
+template<typename N>
+void sptrf(SymmetricMatrix<N>& S, std::vector<int>& piv);
+
+/**	Solves `A x = b` from the LDL^T factorization of A.
+	@param LD - factorization from `sptrf`
+	@param piv - pivots from `sptrf`
+	@param b - right hand side of size n, overwritten by x
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void sptrs(const SymmetricMatrix<N>& LD, const std::vector<int>& piv, Vector<N>& b);
+
+/**	Solves `A X = B` from the LDL^T factorization of A for every column of B.
+	@param LD - factorization from `sptrf`
+	@param piv - pivots from `sptrf`
+	@param B - n x m right hand sides, overwritten by X
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+void sptrs(const SymmetricMatrix<N>& LD, const std::vector<int>& piv, Matrix<N>& B);
+
+/**	Symmetric matrix-vector product.
+	@param lhs - n x n symmetric matrix
+	@param rhs - vector of size n
+	@return a new vector `lhs * rhs`
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+Vector<N> operator*(const SymmetricMatrix<N>& lhs, const Vector<N>& rhs);
+
+/**	Symmetric times dense matrix product.
+	@param lhs - n x n symmetric matrix
+	@param rhs - n x m matrix
+	@return a new n x m matrix `lhs * rhs`
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+Matrix<N> operator*(const SymmetricMatrix<N>& lhs, const Matrix<N>& rhs);
+
+/**	Triangular matrix-vector product.
+	@param lhs - n x n triangular matrix
+	@param rhs - vector of size n
+	@return a new vector `lhs * rhs`
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+Vector<N> operator*(const TriangularMatrix<N>& lhs, Vector<N> rhs);
+
+/**	Triangular times dense matrix product.
+	@param lhs - n x n triangular matrix
+	@param rhs - n x m matrix
+	@return a new n x m matrix `lhs * rhs`
+	@throw invalid_argument if the shapes do not agree
+*/
+template<typename N>
+Matrix<N> operator*(const TriangularMatrix<N>& lhs, Matrix<N> rhs);
+
+
+/** double precision packed symmetric matrix */
+typedef SymmetricMatrix<double> dSymmetricMatrix;
+/** double precision packed triangular matrix */
+typedef TriangularMatrix<double> dTriangularMatrix;
+
+
+
+// implementation
+
+
+template<typename N>
+SymmetricMatrix<N>::SymmetricMatrix(uint n, const N& fill) : _n(n), _data(static_cast<ul>(n) * (n + 1) / 2, fill) {}
+
+template<typename N>
+SymmetricMatrix<N>::SymmetricMatrix(const Matrix<N>& m) : _n(m.rows()), _data(static_cast<ul>(m.rows()) * (m.rows() + 1) / 2) {
+	if (m.rows() != m.cols())
+		throw std::invalid_argument("symmetric matrix must be square");
+
+	for (uint r = 0; r < _n; ++r)
+		std::copy(m.data() + static_cast<ul>(r) * _n, m.data() + static_cast<ul>(r) * _n + r + 1, _data.begin() + index(r, 0));
+}
+
+template<typename N>
+N SymmetricMatrix<N>::at(uint r, uint c) const {
+	if (r >= _n)
+		throw std::invalid_argument("row out of range");
+	if (c >= _n)
+		throw std::invalid_argument("column out of range");
+
+	return (c <= r) ? _data[index(r, c)] : _data[index(c, r)];
+}
+
+template<typename N>
+void SymmetricMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= _n)
+		throw std::invalid_argument("row out of range");
+	if (c >= _n)
+		throw std::invalid_argument("column out of range");
+
+	if (c <= r) _data[index(r, c)] = val;
+	else _data[index(c, r)] = val;
+}
+
+template<typename N>
+Matrix<N> SymmetricMatrix<N>::dense() const {
+	Matrix<N> m (_n, _n, N());
+	for (uint r = 0; r < _n; ++r)
+		for (uint c = 0; c <= r; ++c) m(r, c) = m(c, r) = _data[index(r, c)];
+	return m;
+}
+
+
+template<typename N>
+TriangularMatrix<N>::TriangularMatrix(uint n, Triangle uplo, const N& fill)
+	: _n(n), _uplo(uplo), _data(static_cast<ul>(n) * (n + 1) / 2, fill) {}
+
+template<typename N>
+TriangularMatrix<N>::TriangularMatrix(const Matrix<N>& m, Triangle uplo)
+	: _n(m.rows()), _uplo(uplo), _data(static_cast<ul>(m.rows()) * (m.rows() + 1) / 2) {
+	if (m.rows() != m.cols())
+		throw std::invalid_argument("triangular matrix must be square");
+
+	for (uint r = 0; r < _n; ++r) {
+		const N* src = m.data() + static_cast<ul>(r) * _n;
+		if (_uplo == LOWER) std::copy(src, src + r + 1, _data.begin() + index(r, 0));
+		else std::copy(src + r, src + _n, _data.begin() + index(r, r));
+	}
+}
+
+template<typename N>
+N TriangularMatrix<N>::at(uint r, uint c) const {
+	if (r >= _n)
+		throw std::invalid_argument("row out of range");
+	if (c >= _n)
+		throw std::invalid_argument("column out of range");
+
+	bool stored = (_uplo == LOWER) ? c <= r : c >= r;
+	return stored ? _data[index(r, c)] : N();
+}
+
+template<typename N>
+void TriangularMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= _n)
+		throw std::invalid_argument("row out of range");
+	if (c >= _n)
+		throw std::invalid_argument("column out of range");
+	if ((_uplo == LOWER) ? c > r : c < r)
+		throw std::invalid_argument("element is outside the stored triangle");
+
+	_data[index(r, c)] = val;
+}
+
+template<typename N>
+Matrix<N> TriangularMatrix<N>::dense() const {
+	Matrix<N> m (_n, _n, N());
+	for (uint r = 0; r < _n; ++r) {
+		uint c0 = (_uplo == LOWER) ? 0 : r, c1 = (_uplo == LOWER) ? r + 1 : _n;
+		std::copy(row(r), row(r) + (c1 - c0), m.data() + static_cast<ul>(r) * _n + c0);
+	}
+	return m;
+}
+
+
+namespace detail {
+
+// C[:, lo:hi] = beta * C[:, lo:hi] for an n x ldc matrix
+template<typename N>
+inline void scale_columns(N* C, uint n, ul ldc, ul lo, ul hi, N beta) {
+	for (uint r = 0; r < n; ++r) {
+		N* c = C + r * ldc;
+		if (beta == N()) for (ul j = lo; j < hi; ++j) c[j] = N();
+		else if (beta != N(1)) for (ul j = lo; j < hi; ++j) c[j] *= beta;
+	}
+}
+
+// start of packed lower row r
+inline ul packed_row(uint r) { return static_cast<ul>(r) * (r + 1) / 2; }
+
+// forward and back substitution with a packed Cholesky factor on columns lo..hi of an n x ldb B
+template<typename N>
+void cholesky_solve(const N* a, uint n, N* b, ul ldb, ul lo, ul hi) {
+	ul w = hi - lo;
+	for (uint i = 0; i < n; ++i) {
+		const N* row = a + packed_row(i);
+		N* bi = b + i * ldb + lo;
+		for (uint k = 0; k < i; ++k) axpy_kernel(-row[k], b + k * ldb + lo, bi, w);
+		for (ul j = 0; j < w; ++j) bi[j] /= row[i];
+	}
+	// L^T is walked by rows of L: once x[i] is known it is removed from the rows above
+	for (uint i = n; i-- > 0; ) {
+		const N* row = a + packed_row(i);
+		N* bi = b + i * ldb + lo;
+		for (ul j = 0; j < w; ++j) bi[j] /= row[i];
+		for (uint k = 0; k < i; ++k) axpy_kernel(-row[k], bi, b + k * ldb + lo, w);
+	}
+}
+
+// applies the sptrf factorization to columns lo..hi of an n x ldb B, as LAPACK's sytrs
+template<typename N>
+void ldlt_solve(const N* a, const int* piv, uint n, N* b, ul ldb, ul lo, ul hi) {
+	ul w = hi - lo;
+	auto row = [=](uint i) { return b + static_cast<ul>(i) * ldb + lo; };
+	auto at = [=](uint r, uint c) { return a[packed_row(r) + c]; };
+
+	// L D y = P b
+	for (uint k = 0; k < n; ) {
+		if (piv[k] >= 0) {
+			uint p = static_cast<uint>(piv[k]);
+			if (p != k) std::swap_ranges(row(k), row(k) + w, row(p));
+			for (uint i = k + 1; i < n; ++i) axpy_kernel(-at(i, k), row(k), row(i), w);
+			N d = at(k, k);
+			for (ul j = 0; j < w; ++j) row(k)[j] /= d;
+			k += 1;
+		} else {
+			uint p = static_cast<uint>(-piv[k] - 1);
+			if (p != k + 1) std::swap_ranges(row(k + 1), row(k + 1) + w, row(p));
+			for (uint i = k + 2; i < n; ++i) {
+				axpy_kernel(-at(i, k), row(k), row(i), w);
+				axpy_kernel(-at(i, k + 1), row(k + 1), row(i), w);
+			}
+			N d21 = at(k + 1, k), a0 = at(k, k) / d21, a1 = at(k + 1, k + 1) / d21;
+			N denom = a0 * a1 - N(1);
+			N* b0 = row(k);
+			N* b1 = row(k + 1);
+			for (ul j = 0; j < w; ++j) {
+				N x0 = b0[j] / d21, x1 = b1[j] / d21;
+				b0[j] = (a1 * x0 - x1) / denom;
+				b1[j] = (a0 * x1 - x0) / denom;
+			}
+			k += 2;
+		}
+	}
+
+	// L^T P^T x = y, walking the rows of L from the bottom
+	for (uint k = n; k-- > 0; ) {
+		bool pair = piv[k] < 0;
+		for (uint i = k + 1; i < n; ++i) {
+			axpy_kernel(-at(i, k), row(i), row(k), w);
+			if (pair) axpy_kernel(-at(i, k - 1), row(i), row(k - 1), w);
+		}
+		uint p = static_cast<uint>(pair ? -piv[k] - 1 : piv[k]);
+		if (p != k) std::swap_ranges(row(k), row(k) + w, row(p));
+		if (pair) --k;
+	}
+}
+
+}	// detail
+
+
+template<typename N>
+void symv(const N& alpha, const SymmetricMatrix<N>& S, const Vector<N>& x, const N& beta, Vector<N>& y) {
+	uint n = S.rows();
+	if (x.size() != n || y.size() != n)
+		throw std::invalid_argument("vector sizes do not match matrix shape");
+
+	const N* a = S.data();
+	const N* xp = x.data();
+	N* yp = y.data();
+	N al = alpha, be = beta;
+
+	// rows are split into chunks of equal stored element counts; each chunk
+	// accumulates into its own buffer so the mirrored updates do not race
+	ul total = S.size();
+	ul chunks = (total < parallel::threshold()) ? 1 : parallel::num_threads();
+	chunks = chunks ? chunks : 1;
+	std::vector<uint> bounds (chunks + 1, n);
+	bounds[0] = 0;
+	for (uint r = 0, k = 1; r < n && k < chunks; ++r)
+		if (static_cast<ul>(r) * (r + 1) / 2 >= total * k / chunks) bounds[k++] = r;
+
+	std::vector<N> partial (chunks * static_cast<ul>(n), N());
+	N* pp = partial.data();
+	const uint* bp = bounds.data();
+	parallel::parallel_for(0, chunks, [=](ul lo, ul hi) {
+		for (ul t = lo; t < hi; ++t) {
+			N* acc = pp + t * n;
+			for (uint r = bp[t]; r < bp[t + 1]; ++r) {
+				const N* row = a + static_cast<ul>(r) * (r + 1) / 2;
+				acc[r] += detail::dot_kernel(row, xp, r + 1);
+				detail::axpy_kernel(xp[r], row, acc, r);
+			}
+		}
+	}, 1);
+
+	for (uint i = 0; i < n; ++i) {
+		N s = N();
+		for (ul t = 0; t < chunks; ++t) s += pp[t * n + i];
+		yp[i] = (be == N()) ? al * s : al * s + be * yp[i];
+	}
+}
+
+template<typename N>
+void symm(const N& alpha, const SymmetricMatrix<N>& S, const Matrix<N>& B, const N& beta, Matrix<N>& C) {
+	uint n = S.rows(), m = B.cols();
+	if (B.rows() != n || C.rows() != n || C.cols() != m)
+		throw std::invalid_argument("matrix shapes do not agree for symm");
+
+	const N* a = S.data();
+	const N* b = B.data();
+	N* c = C.data();
+	N al = alpha, be = beta;
+
+	// every thread owns a slice of columns of C, so the mirrored updates stay private
+	ul grain = (S.size() ? parallel::threshold() * 8 / S.size() : 1);
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		ul w = hi - lo;
+		detail::scale_columns(c, n, m, lo, hi, be);
+		for (uint r = 0; r < n; ++r) {
+			const N* row = a + static_cast<ul>(r) * (r + 1) / 2;
+			const N* br = b + static_cast<ul>(r) * m + lo;
+			N* cr = c + static_cast<ul>(r) * m + lo;
+			for (uint k = 0; k < r; ++k) {
+				detail::axpy_kernel(al * row[k], b + static_cast<ul>(k) * m + lo, cr, w);
+				detail::axpy_kernel(al * row[k], br, c + static_cast<ul>(k) * m + lo, w);
+			}
+			detail::axpy_kernel(al * row[r], br, cr, w);
+		}
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+void trmv(const TriangularMatrix<N>& T, Vector<N>& x) {
+	uint n = T.rows();
+	if (x.size() != n)
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	// each x[i] only depends on entries not yet overwritten in this order
+	N* xp = x.data();
+	if (T.uplo() == LOWER) {
+		for (uint i = n; i-- > 0; ) xp[i] = detail::dot_kernel(T.row(i), xp, i + 1);
+	} else {
+		for (uint i = 0; i < n; ++i) xp[i] = detail::dot_kernel(T.row(i), xp + i, n - i);
+	}
+}
+
+template<typename N>
+void trmm(const TriangularMatrix<N>& T, Matrix<N>& B) {
+	uint n = T.rows(), m = B.cols();
+	if (B.rows() != n)
+		throw std::invalid_argument("matrix shapes do not agree for trmm");
+
+	N* b = B.data();
+	const TriangularMatrix<N>* tp = &T;
+	bool lower = T.uplo() == LOWER;
+	ul grain = (T.size() ? parallel::threshold() * 8 / T.size() : 1);
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		ul w = hi - lo;
+		std::vector<N> acc (w);
+		for (uint s = 0; s < n; ++s) {
+			uint i = lower ? n - 1 - s : s;
+			uint c0 = lower ? 0 : i, c1 = lower ? i + 1 : n;
+			const N* row = tp->row(i);
+			std::fill(acc.begin(), acc.end(), N());
+			for (uint k = c0; k < c1; ++k)
+				detail::axpy_kernel(row[k - c0], b + static_cast<ul>(k) * m + lo, acc.data(), w);
+			std::copy(acc.begin(), acc.end(), b + static_cast<ul>(i) * m + lo);
+		}
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+void trsv(const TriangularMatrix<N>& T, Vector<N>& b) {
+	uint n = T.rows();
+	if (b.size() != n)
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	N* x = b.data();
+	if (T.uplo() == LOWER) {
+		for (uint i = 0; i < n; ++i) {
+			const N* row = T.row(i);
+			if (row[i] == N())
+				throw std::invalid_argument("triangular matrix is singular");
+			x[i] = (x[i] - detail::dot_kernel(row, x, i)) / row[i];
+		}
+	} else {
+		for (uint i = n; i-- > 0; ) {
+			const N* row = T.row(i);
+			if (row[0] == N())
+				throw std::invalid_argument("triangular matrix is singular");
+			x[i] = (x[i] - detail::dot_kernel(row + 1, x + i + 1, n - i - 1)) / row[0];
+		}
+	}
+}
+
+template<typename N>
+void trsm(const TriangularMatrix<N>& T, Matrix<N>& B) {
+	uint n = T.rows(), m = B.cols();
+	if (B.rows() != n)
+		throw std::invalid_argument("matrix shapes do not agree for trsm");
+
+	bool lower = T.uplo() == LOWER;
+	for (uint i = 0; i < n; ++i)
+		if (T.row(i)[lower ? i : 0] == N())
+			throw std::invalid_argument("triangular matrix is singular");
+
+	N* b = B.data();
+	const TriangularMatrix<N>* tp = &T;
+	ul grain = (T.size() ? parallel::threshold() * 8 / T.size() : 1);
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		ul w = hi - lo;
+		for (uint s = 0; s < n; ++s) {
+			uint i = lower ? s : n - 1 - s;
+			const N* row = tp->row(i);
+			N* bi = b + static_cast<ul>(i) * m + lo;
+			uint c0 = lower ? 0 : i + 1, c1 = lower ? i : n;
+			const N* coef = lower ? row : row + 1;
+			for (uint k = c0; k < c1; ++k)
+				detail::axpy_kernel(-coef[k - c0], b + static_cast<ul>(k) * m + lo, bi, w);
+
+			N d = lower ? row[i] : row[0];
+			for (ul j = 0; j < w; ++j) bi[j] /= d;
+		}
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+void pptrf(SymmetricMatrix<N>& S) {
+	uint n = S.rows();
+	N* a = S.data();
+	for (uint i = 0; i < n; ++i) {
+		N* ri = a + detail::packed_row(i);
+		for (uint j = 0; j < i; ++j) {
+			const N* rj = a + detail::packed_row(j);
+			ri[j] = (ri[j] - detail::dot_kernel(ri, rj, j)) / rj[j];
+		}
+		N d = ri[i] - detail::dot_kernel(ri, ri, i);
+		if (!(d > N()))
+			throw std::invalid_argument("symmetric matrix is not positive definite");
+		ri[i] = std::sqrt(d);
+	}
+}
+
+template<typename N>
+void pptrs(const SymmetricMatrix<N>& L, Vector<N>& b) {
+	if (b.size() != L.rows())
+		throw std::invalid_argument("vector size does not match matrix shape");
+	detail::cholesky_solve(L.data(), L.rows(), b.data(), 1, 0, 1);
+}
+
+template<typename N>
+void pptrs(const SymmetricMatrix<N>& L, Matrix<N>& B) {
+	uint n = L.rows(), m = B.cols();
+	if (B.rows() != n)
+		throw std::invalid_argument("matrix shapes do not agree for pptrs");
+
+	const N* a = L.data();
+	N* b = B.data();
+	ul grain = (L.size() ? parallel::threshold() * 8 / L.size() : 1);
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		detail::cholesky_solve(a, n, b, m, lo, hi);
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+void sptrf(SymmetricMatrix<N>& S, std::vector<int>& piv) {
+	uint n = S.rows();
+	N* a = S.data();
+	auto at = [a](uint r, uint c) -> N& { return a[detail::packed_row(r) + c]; };
+	const N alpha = (N(1) + std::sqrt(N(17))) / N(8);
+	piv.assign(n, 0);
+
+	// columns of the packed lower triangle are strided, so each pivot column is
+	// copied out once and the trailing update runs along the packed rows
+	std::vector<N> c0 (n), c1 (n);
+	for (uint k = 0; k < n; ) {
+		uint step = 1, p = k;
+		N akk = std::fabs(at(k, k)), colmax = N();
+		uint imax = k;
+		for (uint i = k + 1; i < n; ++i)
+			if (std::fabs(at(i, k)) > colmax) { colmax = std::fabs(at(i, k)); imax = i; }
+		if (!(akk > N()) && !(colmax > N()))
+			throw std::invalid_argument("symmetric matrix is singular");
+
+		if (akk < alpha * colmax) {
+			// largest off-diagonal in row and column imax of the trailing matrix
+			N rowmax = N();
+			for (uint j = k; j < imax; ++j) rowmax = std::max(rowmax, static_cast<N>(std::fabs(at(imax, j))));
+			for (uint j = imax + 1; j < n; ++j) rowmax = std::max(rowmax, static_cast<N>(std::fabs(at(j, imax))));
+			if (akk * rowmax >= alpha * colmax * colmax) p = k;
+			else if (std::fabs(at(imax, imax)) >= alpha * rowmax) p = imax;
+			else { p = imax; step = 2; }
+		}
+
+		// symmetric swap of kk and p inside the trailing matrix
+		uint kk = k + step - 1;
+		if (p != kk) {
+			for (uint i = p + 1; i < n; ++i) std::swap(at(i, kk), at(i, p));
+			for (uint j = kk + 1; j < p; ++j) std::swap(at(j, kk), at(p, j));
+			std::swap(at(kk, kk), at(p, p));
+			if (step == 2) std::swap(at(k + 1, k), at(p, k));
+		}
+
+		if (step == 1) {
+			N d = N(1) / at(k, k);
+			for (uint i = k + 1; i < n; ++i) c0[i] = at(i, k);
+			for (uint i = k + 1; i < n; ++i) {
+				detail::axpy_kernel(-d * c0[i], c0.data() + k + 1, &at(i, k + 1), i - k);
+				at(i, k) = c0[i] * d;
+			}
+			piv[k] = static_cast<int>(p);
+		} else {
+			N d21 = at(k + 1, k), a1 = at(k + 1, k + 1) / d21, a0 = at(k, k) / d21;
+			N t = N(1) / (a1 * a0 - N(1));
+			d21 = t / d21;
+			// c0 and c1 hold the columns of L, the old columns are read from the matrix first
+			for (uint i = k + 2; i < n; ++i) {
+				c0[i] = d21 * (a1 * at(i, k) - at(i, k + 1));
+				c1[i] = d21 * (a0 * at(i, k + 1) - at(i, k));
+			}
+			for (uint i = k + 2; i < n; ++i) {
+				N w0 = at(i, k), w1 = at(i, k + 1);
+				detail::axpy_kernel(-w0, c0.data() + k + 2, &at(i, k + 2), i - k - 1);
+				detail::axpy_kernel(-w1, c1.data() + k + 2, &at(i, k + 2), i - k - 1);
+			}
+			for (uint i = k + 2; i < n; ++i) {
+				at(i, k) = c0[i];
+				at(i, k + 1) = c1[i];
+			}
+			piv[k] = piv[k + 1] = -static_cast<int>(p) - 1;
+		}
+		k += step;
+	}
+}
+
+template<typename N>
+void sptrs(const SymmetricMatrix<N>& LD, const std::vector<int>& piv, Vector<N>& b) {
+	if (b.size() != LD.rows() || piv.size() != LD.rows())
+		throw std::invalid_argument("vector size does not match matrix shape");
+	detail::ldlt_solve(LD.data(), piv.data(), LD.rows(), b.data(), 1, 0, 1);
+}
+
+template<typename N>
+void sptrs(const SymmetricMatrix<N>& LD, const std::vector<int>& piv, Matrix<N>& B) {
+	uint n = LD.rows(), m = B.cols();
+	if (B.rows() != n || piv.size() != n)
+		throw std::invalid_argument("matrix shapes do not agree for sptrs");
+
+	const N* a = LD.data();
+	const int* pp = piv.data();
+	N* b = B.data();
+	ul grain = (LD.size() ? parallel::threshold() * 8 / LD.size() : 1);
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		detail::ldlt_solve(a, pp, n, b, m, lo, hi);
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+Vector<N> operator*(const SymmetricMatrix<N>& lhs, const Vector<N>& rhs) {
+	Vector<N> result (lhs.rows(), N());
+	symv(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+template<typename N>
+Matrix<N> operator*(const SymmetricMatrix<N>& lhs, const Matrix<N>& rhs) {
+	Matrix<N> result (lhs.rows(), rhs.cols(), N());
+	symm(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+template<typename N>
+Vector<N> operator*(const TriangularMatrix<N>& lhs, Vector<N> rhs) {
+	trmv(lhs, rhs);
+	return rhs;
+}
+
+template<typename N>
+Matrix<N> operator*(const TriangularMatrix<N>& lhs, Matrix<N> rhs) {
+	trmm(lhs, rhs);
+	return rhs;
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,319 @@
+/** @file Parallel.hpp
+	Contains the library thread pool and `parallel_for` used by the
+	element-wise kernels.
+
+	On hosts with several NUMA nodes the pool workers are spread over the nodes
+	and `parallel_for` gives each node a contiguous share of the chunks, which
+	its threads claim before helping elsewhere. Consecutive loops over the same
+	range therefore touch each part of it mostly from the same node (see NUMA.hpp).
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <thread>				// thread, hardware_concurrency
+#include <mutex>				// mutex, unique_lock
+#include <condition_variable>	// condition_variable
+#include <functional>			// function
+#include <deque>				// deque
+#include <vector>				// vector
+#include <atomic>				// atomic
+#include <memory>				// shared_ptr, make_shared
+#include <exception>			// exception_ptr
+#include "typedefs.h"			// uint, ul
+#include "Trace.hpp"			// GPML_TRACE_SPAN
+#include "NUMA.hpp"				// nodes, current_node, bind_thread
+
+
+namespace math {
+namespace parallel {
+
+
+/** Number of elements a loop must cover before it is split across threads.
+	Below this the cost of waking the pool outweighs the work.
+	@return reference to the threshold so it can be changed at runtime
+*/
+inline ul& threshold() {
+	static ul t = 1 << 15;
+	return t;
+}
+
+/** Maximum number of threads (including the caller) a `parallel_for` may use.
+	Defaults to `std::thread::hardware_concurrency()`.
+	@return reference to the thread count so it can be changed at runtime
+*/
+inline uint& num_threads() {
+	static uint n = std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+	return n;
+}
+
+
+/** Whether parallel loops started on the calling thread run on it alone. Set
+	by workers that already run one task per thread, such as the task graph
+	scheduler, so the kernels inside their tasks do not split again.
+	@return reference to the calling thread's flag
+*/
+inline bool& serial() {
+	thread_local bool s = false;
+	return s;
+}
+
+
+/** @brief Fixed size pool of worker threads fed from a FIFO queue.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class ThreadPool {
+	public:
+		/** Starts `threads` workers. At least one worker is always started. With
+			`numa::bind_threads()` set on a multi-node host, worker i runs on the
+			CPUs of node i modulo `numa::nodes()`.
+			@param threads - number of worker threads
+		*/
+		explicit ThreadPool(uint threads);
+
+		/** Queues `task` to be run by the next free worker.
+			@param task - callable to run
+		*/
+		void submit(std::function<void()> task);
+
+		/** Get the number of worker threads.
+			@return the number of workers in the pool
+		*/
+		uint size() const { return static_cast<uint>(_workers.size()); }
+
+		/** Destructor. Finishes queued tasks then joins every worker. */
+		~ThreadPool();
+
+	private:
+		void worker(uint index);
+
+		std::vector<std::thread> _workers;			/**<worker threads*/
+		std::deque<std::function<void()> > _tasks;	/**<queued tasks*/
+		std::mutex _mutex;							/**<guards _tasks and _stop*/
+		std::condition_variable _cv;				/**<signals new tasks or shutdown*/
+		bool _stop;									/**<set when the pool is shutting down*/
+};
+
+
+/** Get the library wide thread pool. It is created on first use with one
+	worker per hardware thread minus the calling thread.
+	@return the shared pool
+*/
+inline ThreadPool& pool() {
+	static ThreadPool p (std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() - 1 : 1);
+	return p;
+}
+
+
+/**	Runs `f(lo, hi)` over disjoint sub-ranges covering `[begin, end)`. If the range
+	is smaller than `grain`, only one thread is allowed or `serial()` is set,
+	`f(begin, end)` is called directly on the calling thread. The caller always works on chunks itself,
+	so calling this from inside a pool task cannot deadlock.
+	@param begin - first index
+	@param end - one past the last index
+	@param f - callable taking `(ul lo, ul hi)`
+	@param grain - minimum indices per thread, 0 uses `threshold()`
+	@throw rethrows the first exception thrown by `f`
+*/
+template<typename F>
+void parallel_for(ul begin, ul end, F f, ul grain = 0);
+
+/**	Reduces `[begin, end)` by splitting it into one block per thread, computing
+	`f(lo, hi)` for each block and folding the partial results with `combine` in
+	block order. The split only depends on `num_threads()` and `threshold()`, so
+	floating point results are reproducible from run to run.
+	@param begin - first index
+	@param end - one past the last index
+	@param init - value returned for an empty range and the start of the fold
+	@param f - callable `T(ul lo, ul hi)` reducing one block
+	@param combine - callable `T(T, T)` joining partial results
+	@return the combined result
+*/
+template<typename T, typename F, typename C>
+T parallel_reduce(ul begin, ul end, T init, F f, C combine);
+
+
+
+// implementation
+
+
+inline ThreadPool::ThreadPool(uint threads) : _stop(false) {
+	if (threads == 0) threads = 1;
+	for (uint i = 0; i < threads; ++i)
+		_workers.push_back(std::thread(&ThreadPool::worker, this, i));
+}
+
+inline void ThreadPool::submit(std::function<void()> task) {
+	{
+		std::unique_lock<std::mutex> lock (_mutex);
+		_tasks.push_back(std::move(task));
+	}
+	_cv.notify_one();
+}
+
+inline void ThreadPool::worker(uint index) {
+	if (numa::bind_threads() && numa::nodes() > 1) numa::bind_thread(index % numa::nodes());
+
+	for (;;) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock (_mutex);
+			_cv.wait(lock, [this] { return _stop || !_tasks.empty(); });
+			if (_stop && _tasks.empty()) return;
+
+			task = std::move(_tasks.front());
+			_tasks.pop_front();
+		}
+		GPML_TRACE_SPAN("pool_task");
+		task();
+	}
+}
+
+inline ThreadPool::~ThreadPool() {
+	{
+		std::unique_lock<std::mutex> lock (_mutex);
+		_stop = true;
+	}
+	_cv.notify_all();
+	for (uint i = 0; i < _workers.size(); ++i)
+		_workers[i].join();
+}
+
+
+namespace detail {
+
+/*
+	shared between the caller and helpers of one parallel_for. the chunks are split
+	into one contiguous group per NUMA node and claimed through that group's `next`,
+	so late helpers find nothing left and exit without touching `body`.
+*/
+struct ForState {
+	std::function<void(ul, ul)> body;
+	ul begin, end, chunk, chunks, groups;
+	std::vector<std::atomic<ul> > next;
+	std::atomic<ul> done;
+	std::exception_ptr error;
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	explicit ForState(ul g) : begin(0), end(0), chunk(0), chunks(0), groups(g), next(g), done(0) {
+		for (ul i = 0; i < g; ++i) next[i].store(0, std::memory_order_relaxed);
+	}
+
+	// first chunk of group g
+	ul group_start(ul g) const { return chunks * g / groups; }
+
+	// claims the next chunk, from the calling thread's node first, then from the others
+	bool claim(ul& i) {
+		ul home = (groups > 1) ? numa::current_node() % groups : 0;
+		for (ul k = 0; k < groups; ++k) {
+			ul g = (home + k) % groups;
+			ul size = group_start(g + 1) - group_start(g);
+			if (next[g].load(std::memory_order_relaxed) >= size) continue;
+			ul j = next[g].fetch_add(1);
+			if (j < size) {
+				i = group_start(g) + j;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// claim and run chunks until none are left
+	void run() {
+		ul i;
+		while (claim(i)) {
+			ul lo = begin + i * chunk;
+			ul hi = (lo + chunk < end) ? lo + chunk : end;
+			GPML_TRACE_SPAN("parallel_chunk", hi - lo);
+			try {
+				body(lo, hi);
+			} catch (...) {
+				std::unique_lock<std::mutex> lock (mutex);
+				if (!error) error = std::current_exception();
+			}
+			if (done.fetch_add(1) + 1 == chunks) {
+				std::unique_lock<std::mutex> lock (mutex);
+				cv.notify_all();
+			}
+		}
+	}
+};
+
+}	// detail
+
+
+template<typename F>
+void parallel_for(ul begin, ul end, F f, ul grain) {
+	if (end <= begin) return;
+
+	ul n = end - begin;
+	if (grain == 0) grain = threshold() ? threshold() : 1;
+	ul threads = num_threads();
+	if (threads > (n + grain - 1) / grain) threads = (n + grain - 1) / grain;
+
+	if (threads <= 1 || serial()) {
+		f(begin, end);
+		return;
+	}
+	GPML_TRACE_SPAN("parallel_for", n, threads);
+
+	// a few chunks per thread smooths out uneven work
+	ul groups = (numa::nodes() < threads) ? numa::nodes() : threads;
+	std::shared_ptr<detail::ForState> state = std::make_shared<detail::ForState>(groups);
+	state->body = f;
+	state->begin = begin;
+	state->end = end;
+	state->chunks = threads * 4;
+	state->chunk = (n + state->chunks - 1) / state->chunks;
+	state->chunks = (n + state->chunk - 1) / state->chunk;
+
+	for (ul t = 1; t < threads; ++t)
+		pool().submit([state] { state->run(); });
+
+	state->run();
+
+	{
+		std::unique_lock<std::mutex> lock (state->mutex);
+		state->cv.wait(lock, [&state] { return state->done.load() == state->chunks; });
+	}
+
+	if (state->error) std::rethrow_exception(state->error);
+}
+
+
+template<typename T, typename F, typename C>
+T parallel_reduce(ul begin, ul end, T init, F f, C combine) {
+	if (end <= begin) return init;
+
+	ul n = end - begin;
+	ul grain = threshold() ? threshold() : 1;
+	ul blocks = num_threads();
+	if (blocks > (n + grain - 1) / grain) blocks = (n + grain - 1) / grain;
+	if (blocks <= 1) return combine(init, f(begin, end));
+
+	ul chunk = (n + blocks - 1) / blocks;
+	std::vector<T> partial (blocks, init);
+	T* out = partial.data();
+	parallel_for(0, blocks, [=](ul lo, ul hi) {
+		for (ul b = lo; b < hi; ++b) {
+			ul first = begin + b * chunk;
+			ul last = (first + chunk < end) ? first + chunk : end;
+			if (first < last) out[b] = f(first, last);
+		}
+	}, 1);
+
+	T result = init;
+	for (ul b = 0; b < blocks; ++b)
+		if (begin + b * chunk < end) result = combine(result, partial[b]);
+	return result;
+}
+
+}	// parallel
+}	// math
+
+#endif
@@ -0,0 +1,232 @@
+/** @file Perf.hpp
+	Contains hardware performance counters read through Linux `perf_event_open`:
+	cycles, instructions, L1 data and last level cache misses, data TLB misses and
+	branch misses.
+
+	A `CounterSet` counts user space events of the thread that created it. The
+	counters are opened as one group so they are read with a single system call.
+	Any counter the kernel refuses, as is common in containers or with a strict
+	`perf_event_paranoid`, is marked unavailable and reads as zero; nothing
+	throws. Values are scaled when the kernel multiplexes the group. On other
+	platforms no counter is ever available.
+
+	Work handed to the thread pool runs on other threads and is not counted. Set
+	`parallel::num_threads() = 1` to attribute a whole kernel to its caller.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _PERF_H_
+#define _PERF_H_
+
+#include <cstring>		// memset
+#include <stdint.h>		// uint64_t
+#include "typedefs.h"	// uint, ull
+
+#ifdef __linux__
+#include <unistd.h>				// syscall, read, close
+#include <sys/syscall.h>		// __NR_perf_event_open
+#include <linux/perf_event.h>	// perf_event_attr
+#endif
+
+
+namespace math {
+namespace perf {
+
+/** Hardware events that can be counted. */
+enum Event {
+	CYCLES,			/**<core clock cycles*/
+	INSTRUCTIONS,	/**<instructions retired*/
+	L1D_MISSES,		/**<L1 data cache read misses*/
+	LLC_MISSES,		/**<last level cache misses*/
+	DTLB_MISSES,	/**<data TLB read misses*/
+	BRANCH_MISSES,	/**<mispredicted branches*/
+	EVENTS			/**<number of events*/
+};
+
+/** Name of an event as used in reports.
+	@param e - event
+	@return lower case name such as "cycles"
+*/
+inline const char* event_name(Event e) {
+	static const char* names[EVENTS] = { "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses" };
+	return names[e];
+}
+
+/** @brief Counter values at one point, or the difference between two points.
+	`Reading()` has every event unavailable.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Reading {
+	ull value[EVENTS];	/**<count of each event, 0 when unavailable*/
+	bool valid[EVENTS];	/**<whether each event was counted*/
+
+	/** Get the events counted between `start` and this reading.
+		@param start - earlier reading from the same counters
+		@return the difference, valid where both readings are
+	*/
+	Reading operator-(const Reading& start) const {
+		Reading d = Reading();
+		for (uint e = 0; e < EVENTS; ++e) {
+			d.valid[e] = valid[e] && start.valid[e];
+			d.value[e] = (d.valid[e] && value[e] > start.value[e]) ? value[e] - start.value[e] : 0;
+		}
+		return d;
+	}
+};
+
+
+/** @brief Group of hardware counters for the calling thread.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class CounterSet {
+	public:
+		/** Opens every event the kernel allows for the calling thread. */
+		CounterSet();
+
+		/** Get whether any event could be opened.
+			@return true if at least one event is counted
+		*/
+		bool available() const { return _members > 0; }
+
+		/** Get whether an event could be opened.
+			@param e - event
+			@return true if e is counted
+		*/
+		bool available(Event e) const { return _fd[e] >= 0; }
+
+		/** Reads the current totals. Only meaningful on the thread that created the set.
+			@return totals since the counters were opened
+		*/
+		Reading read() const;
+
+		/** Destructor. Closes the counters. */
+		~CounterSet();
+
+	private:
+		CounterSet(const CounterSet&);
+		CounterSet& operator=(const CounterSet&);
+
+		int _fd[EVENTS];	/**<file descriptor of each event, -1 if unavailable*/
+		uint _slot[EVENTS];	/**<position of each event in a group read*/
+		uint _members;		/**<events in the group*/
+};
+
+/** Get the calling thread's counters, opened on first use.
+	@return the thread's counter set
+*/
+inline CounterSet& local() {
+	thread_local CounterSet c;
+	return c;
+}
+
+/** Counts the events of one call of `f` on the calling thread.
+	@param f - callable to run
+	@return the events it caused, all unavailable if counters cannot be opened
+*/
+template<typename F>
+Reading measure(F f) {
+	CounterSet& c = local();
+	Reading start = c.read();
+	f();
+	return c.read() - start;
+}
+
+
+
+// implementation
+
+#ifdef __linux__
+
+namespace detail {
+
+inline bool event_config(Event e, __u32& type, __u64& config) {
+	const __u64 read_miss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	switch (e) {
+		case CYCLES: type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_CPU_CYCLES; return true;
+		case INSTRUCTIONS: type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_INSTRUCTIONS; return true;
+		case L1D_MISSES: type = PERF_TYPE_HW_CACHE; config = PERF_COUNT_HW_CACHE_L1D | read_miss; return true;
+		case LLC_MISSES: type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_CACHE_MISSES; return true;
+		case DTLB_MISSES: type = PERF_TYPE_HW_CACHE; config = PERF_COUNT_HW_CACHE_DTLB | read_miss; return true;
+		case BRANCH_MISSES: type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_BRANCH_MISSES; return true;
+		default: return false;
+	}
+}
+
+// opens one event of the calling thread, joining group if it is not -1
+inline int open_event(Event e, int group) {
+	perf_event_attr attr;
+	std::memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	if (!event_config(e, attr.type, attr.config)) return -1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+}	// detail
+
+inline CounterSet::CounterSet() : _members(0) {
+	int leader = -1;
+	for (uint e = 0; e < EVENTS; ++e) {
+		_slot[e] = 0;
+		_fd[e] = detail::open_event(static_cast<Event>(e), leader);
+		if (_fd[e] < 0) {
+			_fd[e] = -1;
+			continue;
+		}
+		if (leader < 0) leader = _fd[e];
+		_slot[e] = _members++;
+	}
+}
+
+inline Reading CounterSet::read() const {
+	Reading r = Reading();
+	if (_members == 0) return r;
+
+	int leader = -1;
+	for (uint e = 0; e < EVENTS && leader < 0; ++e) leader = _fd[e];
+
+	// nr, time enabled, time running, then one value per member
+	uint64_t buf[3 + EVENTS];
+	ssize_t want = static_cast<ssize_t>((3 + _members) * sizeof(uint64_t));
+	if (::read(leader, buf, sizeof(buf)) < want || buf[0] != _members || buf[2] == 0) return r;
+
+	double scale = static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+	for (uint e = 0; e < EVENTS; ++e) {
+		if (_fd[e] < 0) continue;
+		r.valid[e] = true;
+		r.value[e] = static_cast<ull>(buf[3 + _slot[e]] * scale);
+	}
+	return r;
+}
+
+inline CounterSet::~CounterSet() {
+	for (uint e = 0; e < EVENTS; ++e)
+		if (_fd[e] >= 0) close(_fd[e]);
+}
+
+#else
+
+inline CounterSet::CounterSet() : _members(0) {
+	for (uint e = 0; e < EVENTS; ++e) {
+		_fd[e] = -1;
+		_slot[e] = 0;
+	}
+}
+
+inline Reading CounterSet::read() const { return Reading(); }
+
+inline CounterSet::~CounterSet() {}
+
+#endif
+
+}	// perf
+}	// math
+
+#endif
@@ -0,0 +1,455 @@
+/** @file Quantize.hpp
+	Contains 8 and 16 bit quantized matrices, quantize/dequantize for fMatrix and
+	an integer GEMM that accumulates in 32 bits.
+
+	Unsigned storage types are quantized asymmetrically (scale and zero point),
+	signed ones symmetrically (zero point 0), which matches the usual
+	`uint8 activations x int8 weights` inference setup.
+
+	B is packed transposed and each row of A is applied to four packed columns
+	per pass. The inner products use `vpdpbusd` from AVX-512 VNNI or AVX-VNNI when
+	the compiler targets them. Plain AVX2 widens to 16 bits and uses `vpmaddwd`,
+	which unlike `vpmaddubsw` cannot saturate, so every path returns the same
+	exact result as the portable loop.
+	Full range int16 operands overflow a 32 bit sum after two products, so int16
+	is only exact when the data leaves enough headroom for the inner dimension.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _QUANTIZE_H_
+#define _QUANTIZE_H_
+
+#include <vector>		// vector
+#include <limits>		// numeric_limits
+#include <cmath>		// nearbyint
+#include <stdexcept>	// invalid_argument
+#include <stdint.h>		// int8_t, uint8_t, int16_t, int32_t
+#include "Matrix.hpp"	// Matrix
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+namespace math {
+
+
+/** @brief How many scale/zero point pairs a quantized matrix carries. */
+enum QuantScheme {
+	PER_TENSOR,		/**<one pair for the whole matrix*/
+	PER_ROW,		/**<one pair per row*/
+	PER_COLUMN		/**<one pair per column*/
+};
+
+
+/** @brief Matrix of 8 or 16 bit integers with the scales and zero points needed
+	to map them back to real values: `x = scale * (q - zero_point)`.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename Q>
+class QMatrix {
+	public:
+		/** Creates a zero filled rows x cols quantized matrix with unit scales.
+			@param rows - number of rows
+			@param cols - number of columns
+			@param scheme - granularity of the scales and zero points
+		*/
+		QMatrix(uint rows, uint cols, QuantScheme scheme);
+
+		/** Get element at r, c of the matrix 0-indexed.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		Q at(uint r, uint c) const;
+
+		/** Get the real value represented by element r, c.
+			@param r - row of element
+			@param c - column of element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		float value(uint r, uint c) const;
+
+		/** Get the scale that applies to element r, c.
+			@param r - row of element
+			@param c - column of element
+		*/
+		float scale(uint r, uint c) const { return _scale[group(r, c)]; }
+
+		/** Get the zero point that applies to element r, c.
+			@param r - row of element
+			@param c - column of element
+		*/
+		int32_t zero_point(uint r, uint c) const { return _zero[group(r, c)]; }
+
+		/** Get the number of rows in the matrix. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns in the matrix. */
+		uint cols() const { return _cols; }
+
+		/** Get the granularity of the scales and zero points. */
+		QuantScheme scheme() const { return _scheme; }
+
+		/** Get the contiguous row-major buffer of quantized values. */
+		Q* data() { return _data.data(); }
+
+		/** Get the contiguous row-major buffer of quantized values. */
+		const Q* data() const { return _data.data(); }
+
+		/** Get the scales, one per tensor, row or column depending on `scheme()`. */
+		std::vector<float>& scales() { return _scale; }
+
+		/** Get the scales, one per tensor, row or column depending on `scheme()`. */
+		const std::vector<float>& scales() const { return _scale; }
+
+		/** Get the zero points, one per tensor, row or column depending on `scheme()`. */
+		std::vector<int32_t>& zero_points() { return _zero; }
+
+		/** Get the zero points, one per tensor, row or column depending on `scheme()`. */
+		const std::vector<int32_t>& zero_points() const { return _zero; }
+
+	private:
+		uint group(uint r, uint c) const { return _scheme == PER_ROW ? r : (_scheme == PER_COLUMN ? c : 0); }
+
+		uint _rows;						/**<number of rows*/
+		uint _cols;						/**<number of columns*/
+		QuantScheme _scheme;			/**<granularity of _scale and _zero*/
+		std::vector<Q> _data;			/**<row-major quantized values*/
+		std::vector<float> _scale;		/**<scales per group*/
+		std::vector<int32_t> _zero;		/**<zero points per group*/
+};
+
+/** unsigned 8 bit quantized matrix, usually activations */
+typedef QMatrix<uint8_t> u8Matrix;
+/** signed 8 bit quantized matrix, usually weights */
+typedef QMatrix<int8_t> i8Matrix;
+/** signed 16 bit quantized matrix */
+typedef QMatrix<int16_t> i16Matrix;
+
+
+/**	Quantizes `m` to storage type `Q`. Each group's range is widened to include 0
+	so zero is exactly representable. Unsigned `Q` uses an asymmetric mapping with
+	a zero point; signed `Q` uses a symmetric one with zero point 0.
+	@param m - matrix to quantize
+	@param scheme - granularity of the scales and zero points
+	@return the quantized matrix
+*/
+template<typename Q>
+QMatrix<Q> quantize(const Matrix<float>& m, QuantScheme scheme);
+
+/**	Maps a quantized matrix back to floats.
+	@param q - quantized matrix
+	@return fMatrix with `scale * (q - zero_point)` in every element
+*/
+template<typename Q>
+Matrix<float> dequantize(const QMatrix<Q>& q);
+
+/**	Integer matrix multiply with 32 bit accumulation and zero point correction:
+	`C(r, c) = sum_i (A(r, i) - za) * (B(i, c) - zb)`. `A` may be per tensor or per
+	row and `B` per tensor or per column, so each output has a single scale pair.
+	The sums are exact as long as they fit in 32 bits.
+	@param A - m x k quantized matrix
+	@param B - k x n quantized matrix
+	@return m x n matrix of int32 accumulators
+	@throw invalid_argument if the shapes or quantization schemes do not agree
+*/
+template<typename QA, typename QB>
+Matrix<int32_t> qgemm_s32(const QMatrix<QA>& A, const QMatrix<QB>& B);
+
+/**	Quantized matrix multiply returning real values: the int32 result of
+	`qgemm_s32` is scaled by the row scale of `A` and column scale of `B`.
+	@param A - m x k quantized matrix, per tensor or per row
+	@param B - k x n quantized matrix, per tensor or per column
+	@return m x n fMatrix approximating the product of the dequantized inputs
+	@throw invalid_argument if the shapes or quantization schemes do not agree
+*/
+template<typename QA, typename QB>
+Matrix<float> qgemm(const QMatrix<QA>& A, const QMatrix<QB>& B);
+
+
+
+// implementation
+
+
+template<typename Q>
+QMatrix<Q>::QMatrix(uint rows, uint cols, QuantScheme scheme)
+	: _rows(rows), _cols(cols), _scheme(scheme), _data(static_cast<ul>(rows) * cols, Q()) {
+	uint groups = scheme == PER_ROW ? rows : (scheme == PER_COLUMN ? cols : 1);
+	_scale.assign(groups, 1.f);
+	_zero.assign(groups, 0);
+}
+
+template<typename Q>
+Q QMatrix<Q>::at(uint r, uint c) const {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	return _data[static_cast<ul>(r) * _cols + c];
+}
+
+template<typename Q>
+float QMatrix<Q>::value(uint r, uint c) const {
+	return scale(r, c) * static_cast<float>(static_cast<int32_t>(at(r, c)) - zero_point(r, c));
+}
+
+
+namespace detail {
+
+// scale and zero point mapping [lo, hi] onto the range of Q
+template<typename Q>
+inline void quant_params(float lo, float hi, float& scale, int32_t& zero) {
+	const float qmin = static_cast<float>(std::numeric_limits<Q>::min());
+	const float qmax = static_cast<float>(std::numeric_limits<Q>::max());
+	lo = lo < 0.f ? lo : 0.f;
+	hi = hi > 0.f ? hi : 0.f;
+
+	if (std::numeric_limits<Q>::is_signed) {
+		float mx = -lo > hi ? -lo : hi;
+		scale = mx > 0.f ? mx / qmax : 1.f;
+		zero = 0;
+	} else {
+		scale = hi > lo ? (hi - lo) / (qmax - qmin) : 1.f;
+		float z = std::nearbyint(qmin - lo / scale);
+		z = (z == z) ? z : qmin;	// an infinite lo gives inf / inf
+		zero = static_cast<int32_t>(z < qmin ? qmin : (z > qmax ? qmax : z));
+	}
+}
+
+template<typename Q>
+inline Q quant_value(float x, float inv_scale, int32_t zero) {
+	const float qmin = static_cast<float>(std::numeric_limits<Q>::min());
+	const float qmax = static_cast<float>(std::numeric_limits<Q>::max());
+	float q = std::nearbyint(x * inv_scale) + static_cast<float>(zero);
+	// NaN fails both clamp comparisons and casting it is undefined, so it maps to the zero point
+	q = (q == q) ? q : static_cast<float>(zero);
+	return static_cast<Q>(q < qmin ? qmin : (q > qmax ? qmax : q));
+}
+
+
+// sum_i a[i] * b[i] in 32 bits
+template<typename QA, typename QB>
+inline int32_t qdot(const QA* a, const QB* b, uint k) {
+	int32_t sum = 0;
+	for (uint i = 0; i < k; ++i) sum += static_cast<int32_t>(a[i]) * static_cast<int32_t>(b[i]);
+	return sum;
+}
+
+/*
+	out[j] = sum_i a[i] * b[j * ldb + i] for j < 4 in 32 bits. one row of A is
+	loaded once and applied to four packed columns of B, and the four sums are
+	reduced together at the end.
+*/
+template<typename QA, typename QB>
+inline void qdot4(const QA* a, const QB* b, ul ldb, uint k, int32_t* out) {
+	for (uint j = 0; j < 4; ++j) out[j] = qdot(a, b + j * ldb, k);
+}
+
+#if defined(__AVX2__)
+
+// horizontal sums of four accumulators, returned in lanes 0..3
+inline __m128i hsum4(__m256i s0, __m256i s1, __m256i s2, __m256i s3) {
+	__m256i t = _mm256_hadd_epi32(_mm256_hadd_epi32(s0, s1), _mm256_hadd_epi32(s2, s3));
+	return _mm_add_epi32(_mm256_castsi256_si128(t), _mm256_extracti128_si256(t, 1));
+}
+
+// acc += groups of four u8 * s8 products, 32 bytes per call
+inline __m256i madd_u8s8(__m256i acc, __m256i x, const int8_t* b) {
+	__m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b));
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+	return _mm256_dpbusd_epi32(acc, x, y);
+#elif defined(__AVXVNNI__)
+	return _mm256_dpbusd_avx_epi32(acc, x, y);
+#else
+	// widen to 16 bits so vpmaddwd is exact; vpmaddubsw would saturate
+	__m256i xl = _mm256_unpacklo_epi8(x, _mm256_setzero_si256());
+	__m256i xh = _mm256_unpackhi_epi8(x, _mm256_setzero_si256());
+	__m256i yl = _mm256_srai_epi16(_mm256_unpacklo_epi8(y, y), 8);
+	__m256i yh = _mm256_srai_epi16(_mm256_unpackhi_epi8(y, y), 8);
+	return _mm256_add_epi32(acc, _mm256_add_epi32(_mm256_madd_epi16(xl, yl), _mm256_madd_epi16(xh, yh)));
+#endif
+}
+
+template<>
+inline void qdot4<uint8_t, int8_t>(const uint8_t* a, const int8_t* b, ul ldb, uint k, int32_t* out) {
+	__m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+	uint i = 0;
+	for (; i + 32 <= k; i += 32) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		s0 = madd_u8s8(s0, x, b + i);
+		s1 = madd_u8s8(s1, x, b + ldb + i);
+		s2 = madd_u8s8(s2, x, b + 2 * ldb + i);
+		s3 = madd_u8s8(s3, x, b + 3 * ldb + i);
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), hsum4(s0, s1, s2, s3));
+
+	for (; i < k; ++i) {
+		int32_t x = a[i];
+		for (uint j = 0; j < 4; ++j) out[j] += x * static_cast<int32_t>(b[j * ldb + i]);
+	}
+}
+
+template<>
+inline void qdot4<int16_t, int16_t>(const int16_t* a, const int16_t* b, ul ldb, uint k, int32_t* out) {
+	__m256i s0 = _mm256_setzero_si256(), s1 = s0, s2 = s0, s3 = s0;
+	uint i = 0;
+	for (; i + 16 <= k; i += 16) {
+		__m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+		s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i))));
+		s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + ldb + i))));
+		s2 = _mm256_add_epi32(s2, _mm256_madd_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 2 * ldb + i))));
+		s3 = _mm256_add_epi32(s3, _mm256_madd_epi16(x, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + 3 * ldb + i))));
+	}
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out), hsum4(s0, s1, s2, s3));
+
+	for (; i < k; ++i) {
+		int32_t x = a[i];
+		for (uint j = 0; j < 4; ++j) out[j] += x * static_cast<int32_t>(b[j * ldb + i]);
+	}
+}
+
+#endif
+
+}	// detail
+
+
+template<typename Q>
+QMatrix<Q> quantize(const Matrix<float>& m, QuantScheme scheme) {
+	QMatrix<Q> q (m.rows(), m.cols(), scheme);
+	uint rows = m.rows(), cols = m.cols();
+	const float* in = m.data();
+	std::vector<float>& scale = q.scales();
+	std::vector<int32_t>& zero = q.zero_points();
+
+	// range of every group
+	std::vector<float> lo (scale.size(), 0.f), hi (scale.size(), 0.f);
+	for (uint r = 0; r < rows; ++r) {
+		for (uint c = 0; c < cols; ++c) {
+			uint g = scheme == PER_ROW ? r : (scheme == PER_COLUMN ? c : 0);
+			float x = in[static_cast<ul>(r) * cols + c];
+			lo[g] = x < lo[g] ? x : lo[g];
+			hi[g] = x > hi[g] ? x : hi[g];
+		}
+	}
+	for (uint g = 0; g < scale.size(); ++g)
+		detail::quant_params<Q>(lo[g], hi[g], scale[g], zero[g]);
+
+	Q* out = q.data();
+	const float* s = scale.data();
+	const int32_t* z = zero.data();
+	parallel::parallel_for(0, rows, [=](ul lo_r, ul hi_r) {
+		for (ul r = lo_r; r < hi_r; ++r) {
+			for (uint c = 0; c < cols; ++c) {
+				uint g = scheme == PER_ROW ? static_cast<uint>(r) : (scheme == PER_COLUMN ? c : 0);
+				out[r * cols + c] = detail::quant_value<Q>(in[r * cols + c], 1.f / s[g], z[g]);
+			}
+		}
+	}, cols ? (parallel::threshold() / cols ? parallel::threshold() / cols : 1) : 1);
+
+	return q;
+}
+
+template<typename Q>
+Matrix<float> dequantize(const QMatrix<Q>& q) {
+	Matrix<float> m (q.rows(), q.cols(), 0.f);
+	uint cols = q.cols();
+	const Q* in = q.data();
+	float* out = m.data();
+	const QMatrix<Q>* qp = &q;
+	parallel::parallel_for(0, q.rows(), [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r)
+			for (uint c = 0; c < cols; ++c)
+				out[r * cols + c] = qp->scale(static_cast<uint>(r), c)
+					* static_cast<float>(static_cast<int32_t>(in[r * cols + c]) - qp->zero_point(static_cast<uint>(r), c));
+	}, cols ? (parallel::threshold() / cols ? parallel::threshold() / cols : 1) : 1);
+	return m;
+}
+
+template<typename QA, typename QB>
+Matrix<int32_t> qgemm_s32(const QMatrix<QA>& A, const QMatrix<QB>& B) {
+	if (A.cols() != B.rows())
+		throw std::invalid_argument("Matrix Multiplication is undefined if m.rows() must equal cols().");
+	if (A.scheme() == PER_COLUMN || B.scheme() == PER_ROW)
+		throw std::invalid_argument("qgemm needs A per tensor or per row and B per tensor or per column");
+
+	uint m = A.rows(), n = B.cols(), k = A.cols();
+	Matrix<int32_t> C (m, n, 0);
+	if (m == 0 || n == 0) return C;
+
+	// pack B transposed so every output is a contiguous dot product over k
+	std::vector<QB> bt (static_cast<ul>(n) * k);
+	std::vector<int32_t> colsum (n, 0);
+	const QB* b = B.data();
+	for (uint i = 0; i < k; ++i)
+		for (uint c = 0; c < n; ++c) {
+			bt[static_cast<ul>(c) * k + i] = b[static_cast<ul>(i) * n + c];
+			colsum[c] += b[static_cast<ul>(i) * n + c];
+		}
+
+	const QA* a = A.data();
+	const QB* bp = bt.data();
+	const int32_t* cs = colsum.data();
+	int32_t* out = C.data();
+	const QMatrix<QA>* ap = &A;
+	const QMatrix<QB>* bq = &B;
+
+	// columns of B^T are walked in blocks that stay in L2 across the rows of a chunk
+	uint nb = k ? 131072 / k : n;
+	nb = nb ? nb : 1;
+	ul work = static_cast<ul>(n) * k;
+	ul grain = (work != 0) ? parallel::threshold() * 64 / work : 1;
+
+	parallel::parallel_for(0, m, [=](ul lo, ul hi) {
+		for (uint c0 = 0; c0 < n; c0 += nb) {
+			uint c1 = (c0 + nb < n) ? c0 + nb : n;
+			for (ul r = lo; r < hi; ++r) {
+				const QA* ar = a + r * k;
+				int32_t za = ap->zero_point(static_cast<uint>(r), 0);
+				int32_t rowsum = 0;
+				for (uint i = 0; i < k; ++i) rowsum += ar[i];
+
+				int32_t raw[4];
+				uint c = c0;
+				for (; c + 4 <= c1; c += 4) {
+					detail::qdot4(ar, bp + static_cast<ul>(c) * k, k, k, raw);
+					for (uint j = 0; j < 4; ++j) {
+						int32_t zb = bq->zero_point(0, c + j);
+						out[r * n + c + j] = raw[j] - zb * rowsum - za * cs[c + j] + static_cast<int32_t>(k) * za * zb;
+					}
+				}
+				for (; c < c1; ++c) {
+					int32_t zb = bq->zero_point(0, c);
+					int32_t r1 = detail::qdot(ar, bp + static_cast<ul>(c) * k, k);
+					out[r * n + c] = r1 - zb * rowsum - za * cs[c] + static_cast<int32_t>(k) * za * zb;
+				}
+			}
+		}
+	}, grain ? grain : 1);
+
+	return C;
+}
+
+template<typename QA, typename QB>
+Matrix<float> qgemm(const QMatrix<QA>& A, const QMatrix<QB>& B) {
+	Matrix<int32_t> acc = qgemm_s32(A, B);
+	Matrix<float> C (acc.rows(), acc.cols(), 0.f);
+
+	uint n = acc.cols();
+	for (uint r = 0; r < acc.rows(); ++r) {
+		float sa = A.scale(r, 0);
+		for (uint c = 0; c < n; ++c)
+			C(r, c) = sa * B.scale(0, c) * static_cast<float>(acc(r, c));
+	}
+	return C;
+}
+
+}	// math
+
+#endif
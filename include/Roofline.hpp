@@ -0,0 +1,302 @@
+/** @file Roofline.hpp
+	Contains roofline analysis for GPML kernels: measuring the host's peak memory
+	bandwidth and peak flop rate, timing kernels, and reporting how close each
+	one runs to the roof set by its arithmetic intensity.
+
+	Bandwidth is measured with a STREAM-style triad over arrays much larger than
+	the last level cache and peak flops with independent multiply-add chains that
+	stay in registers, both on every `parallel::num_threads()` thread. A kernel's
+	flops and bytes come from the instrumentation counters (see Instrument.hpp)
+	unless they are given explicitly, so bytes are compulsory traffic and the
+	intensity is an upper bound on the one the hardware sees.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _ROOFLINE_H_
+#define _ROOFLINE_H_
+
+#include <string>		// string
+#include <vector>		// vector
+#include <sstream>		// ostringstream
+#include <chrono>		// steady_clock
+#include <algorithm>	// sort
+#include <stdexcept>	// invalid_argument
+#include "Instrument.hpp"	// enabled, reset, snapshot
+#include "Parallel.hpp"	// parallel_for, num_threads
+#include "typedefs.h"	// uint, ul, ull
+
+
+namespace math {
+namespace roofline {
+
+/** @brief Peak rates of the host.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Machine {
+	double bandwidth;	/**<sustained memory bandwidth in bytes per second*/
+	double flops;		/**<peak double precision flops per second*/
+
+	/** Get the intensity at which the memory and compute roofs meet.
+		@return flops per byte
+	*/
+	double ridge() const { return flops / bandwidth; }
+};
+
+/** @brief Work and best time of one kernel.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Kernel {
+	std::string name;	/**<label used in the report*/
+	double flops;		/**<flops per run*/
+	double bytes;		/**<bytes moved per run*/
+	double seconds;		/**<fastest run*/
+
+	/** Get the arithmetic intensity.
+		@return flops per byte, 0 if no bytes were counted
+	*/
+	double intensity() const { return bytes > 0 ? flops / bytes : 0; }
+
+	/** Get the achieved flop rate.
+		@return flops per second
+	*/
+	double rate() const { return seconds > 0 ? flops / seconds : 0; }
+
+	/** Get the flop rate the roofline allows at this kernel's intensity.
+		@param m - host peaks
+		@return min(peak flops, intensity * bandwidth)
+	*/
+	double attainable(const Machine& m) const {
+		double mem = intensity() * m.bandwidth;
+		return (bytes > 0 && mem < m.flops) ? mem : m.flops;
+	}
+
+	/** Get the shortest time the roofline allows for this kernel. Unlike
+		`attainable` this is also meaningful for pure data movement.
+		@param m - host peaks
+		@return max(flops / peak flops, bytes / bandwidth) in seconds
+	*/
+	double roof_time(const Machine& m) const {
+		double tf = flops / m.flops, tb = bytes / m.bandwidth;
+		return (tf > tb) ? tf : tb;
+	}
+
+	/** Get the fraction of the roof reached.
+		@param m - host peaks
+		@return roof_time / seconds. Above 1 when the data came from cache.
+	*/
+	double efficiency(const Machine& m) const { return seconds > 0 ? roof_time(m) / seconds : 0; }
+};
+
+
+/**	Measures sustained memory bandwidth with the triad `a = b + s * c`.
+	@param bytes - total size of the three arrays, should be several times the last level cache
+	@param reps - runs, the fastest of which is kept
+	@return bytes per second, counting one read of b and c and one write of a
+	@throw invalid_argument if reps is 0
+*/
+inline double measure_bandwidth(ul bytes = 1ul << 28, uint reps = 5);
+
+/**	Measures peak double precision flops with independent multiply-add chains.
+	@param iterations - chain steps per thread
+	@param reps - runs, the fastest of which is kept
+	@return flops per second
+	@throw invalid_argument if reps is 0
+*/
+inline double measure_flops(ul iterations = 1ul << 24, uint reps = 3);
+
+/**	Measures both peaks of the host.
+	@return the machine description
+*/
+inline Machine measure_machine();
+
+/**	Times `f` and reads its flops and bytes from the instrumentation counters.
+	Counting is enabled for the duration and restored afterwards.
+	@param name - label for the report
+	@param f - callable running the kernel once
+	@param reps - runs, the fastest of which is kept
+	@return the kernel's work and time
+	@throw invalid_argument if reps is 0
+*/
+template<typename F>
+Kernel measure(const std::string& name, F f, uint reps = 5);
+
+/**	Times `f` for a kernel whose work is known, such as one the instrumentation
+	does not cover.
+	@param name - label for the report
+	@param flops - flops per run
+	@param bytes - bytes moved per run
+	@param f - callable running the kernel once
+	@param reps - runs, the fastest of which is kept
+	@return the kernel's work and time
+	@throw invalid_argument if reps is 0
+*/
+template<typename F>
+Kernel measure(const std::string& name, double flops, double bytes, F f, uint reps = 5);
+
+/**	Formats a roofline report as CSV preceded by `#` comment lines describing the
+	host. Columns are name, flops, bytes, intensity (flop/byte), achieved and
+	attainable GFLOP/s, achieved GB/s, efficiency (see `Kernel::efficiency`), the
+	bound (memory or compute) and the seconds that would be saved by reaching the
+	roof. Rows are sorted by that saving, so the kernels most worth optimizing
+	come first.
+	@param m - host peaks
+	@param kernels - measured kernels
+	@return the report
+*/
+inline std::string report(const Machine& m, std::vector<Kernel> kernels);
+
+
+
+// implementation
+
+namespace detail {
+
+// fastest of reps calls of f, in seconds
+template<typename F>
+double best_time(F f, uint reps) {
+	if (reps == 0)
+		throw std::invalid_argument("reps must be positive");
+	double best = 0;
+	for (uint r = 0; r < reps; ++r) {
+		std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+		f();
+		double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+		if (r == 0 || t < best) best = t;
+	}
+	return best;
+}
+
+// stops the compiler from discarding a result
+inline void keep(double x) {
+#if defined(__GNUC__)
+	__asm__ __volatile__("" : : "g"(x) : "memory");
+#else
+	static volatile double sink;
+	sink = x;
+	(void) sink;
+#endif
+}
+
+}	// detail
+
+
+inline double measure_bandwidth(ul bytes, uint reps) {
+	ul n = bytes / (3 * sizeof(double));
+	std::vector<double> a (n), b (n, 1.0), c (n, 2.0);
+	double* pa = a.data();
+	const double* pb = b.data();
+	const double* pc = c.data();
+
+	// first touch a on the threads that will write it
+	parallel::parallel_for(0, n, [pa](ul lo, ul hi) { for (ul i = lo; i < hi; ++i) pa[i] = 0; });
+
+	double t = detail::best_time([=] {
+		parallel::parallel_for(0, n, [=](ul lo, ul hi) {
+			for (ul i = lo; i < hi; ++i) pa[i] = pb[i] + 3.0 * pc[i];
+		});
+	}, reps);
+	detail::keep(a[n / 2]);
+	return t > 0 ? 3.0 * sizeof(double) * n / t : 0;
+}
+
+inline double measure_flops(ul iterations, uint reps) {
+	const uint chains = 32;
+	ul threads = parallel::num_threads();
+
+	double t = detail::best_time([=] {
+		parallel::parallel_for(0, threads, [=](ul lo, ul hi) {
+			for (ul th = lo; th < hi; ++th) {
+				double x[chains];
+				for (uint u = 0; u < chains; ++u) x[u] = 1.0 + u * 1e-3;
+				for (ul i = 0; i < iterations; ++i)
+					for (uint u = 0; u < chains; ++u) x[u] = x[u] * 0.999999 + 1e-6;
+				double s = 0;
+				for (uint u = 0; u < chains; ++u) s += x[u];
+				detail::keep(s);
+			}
+		}, 1);
+	}, reps);
+	return t > 0 ? 2.0 * chains * iterations * threads / t : 0;
+}
+
+inline Machine measure_machine() {
+	Machine m;
+	m.bandwidth = measure_bandwidth();
+	m.flops = measure_flops();
+	return m;
+}
+
+template<typename F>
+Kernel measure(const std::string& name, double flops, double bytes, F f, uint reps) {
+	Kernel k;
+	k.name = name;
+	k.flops = flops;
+	k.bytes = bytes;
+	k.seconds = detail::best_time(f, reps);
+	return k;
+}
+
+template<typename F>
+Kernel measure(const std::string& name, F f, uint reps) {
+	if (reps == 0)
+		throw std::invalid_argument("reps must be positive");
+
+	// one counted run for the work, then timed runs without the counters
+	bool was = instrument::enabled();
+	instrument::enabled() = true;
+	instrument::reset();
+	try {
+		f();
+	} catch (...) {
+		instrument::enabled() = was;
+		throw;
+	}
+	instrument::Snapshot s = instrument::snapshot();
+	instrument::enabled() = was;
+
+	double flops = 0, bytes = 0;
+	for (uint o = 0; o < instrument::OPS; ++o) {
+		flops += s.ops[o].flops;
+		bytes += s.ops[o].bytes;
+	}
+	return measure(name, flops, bytes, f, reps);
+}
+
+namespace detail {
+
+// seconds saved if k ran at its roof
+inline double saving(const Kernel& k, const Machine& m) {
+	return k.seconds - k.roof_time(m);
+}
+
+}	// detail
+
+inline std::string report(const Machine& m, std::vector<Kernel> kernels) {
+	std::sort(kernels.begin(), kernels.end(), [&m](const Kernel& a, const Kernel& b) {
+		return detail::saving(a, m) > detail::saving(b, m);
+	});
+
+	std::ostringstream out;
+	out << "# peak bandwidth GB/s: " << m.bandwidth / 1e9 << "\n"
+		<< "# peak GFLOP/s: " << m.flops / 1e9 << "\n"
+		<< "# ridge flop/byte: " << m.ridge() << "\n"
+		<< "name,flops,bytes,intensity,gflops,attainable_gflops,gbytes_s,efficiency,bound,saving_s\n";
+	for (ul i = 0; i < kernels.size(); ++i) {
+		const Kernel& k = kernels[i];
+		out << k.name << "," << k.flops << "," << k.bytes << "," << k.intensity() << ","
+			<< k.rate() / 1e9 << "," << k.attainable(m) / 1e9 << "," << (k.seconds > 0 ? k.bytes / k.seconds / 1e9 : 0) << ","
+			<< k.efficiency(m) << "," << (k.intensity() < m.ridge() ? "memory" : "compute") << ","
+			<< detail::saving(k, m) << "\n";
+	}
+	return out.str();
+}
+
+}	// roofline
+}	// math
+
+#endif
@@ -0,0 +1,342 @@
+/** @file Shared.hpp
+	Contains a matrix stored in POSIX shared memory, so processes on one host can
+	map a single copy of a large matrix instead of each holding its own.
+
+	One process creates the object under a name such as "/weights" and fills
+	it; the others attach by name, usually read-only. The object holds a 64 byte
+	header with the shape, element size and element type name, followed by the
+	row-major elements. Attaching checks the header, so a process cannot map a
+	matrix of another type by mistake, and it fails while the creator is still
+	writing the elements. Memory is returned once the name is removed and every
+	process has unmapped it.
+
+	Matrix owns its heap buffer, so a SharedMatrix is its own type: pass
+	`data()` or `mutable_data()` to the pointer kernels such as `gemm` to
+	compute on it in place, or copy it into a Matrix with `dense()`. Huge pages
+	are requested with `madvise(MADV_HUGEPAGE)`. This only takes effect when the
+	kernel allows transparent huge pages for shared memory
+	(`/sys/kernel/mm/transparent_hugepage/shmem_enabled`). With glibc older than
+	2.34, link with `-lrt`.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _SHARED_H_
+#define _SHARED_H_
+
+#include <string>			// string
+#include <algorithm>		// copy, fill
+#include <cstring>			// memcpy, memcmp, memset, strncpy, strncmp
+#include <stdexcept>		// invalid_argument, runtime_error
+#include <stdint.h>			// uint64_t
+#include <fcntl.h>			// O_* constants
+#include <unistd.h>			// ftruncate, close
+#include <sys/mman.h>		// shm_open, shm_unlink, mmap, munmap, madvise
+#include <sys/stat.h>		// fstat
+#include "Matrix.hpp"		// Matrix
+#include "typedefs.h"		// uint, ul
+
+
+namespace math {
+
+/** @brief Name of an element type as recorded in a SharedMatrix header. Types
+	without a specialization are only checked by size. */
+template<typename N> struct shm_type { static const char* get() { return ""; } };
+template<> struct shm_type<float> { static const char* get() { return "float"; } };
+template<> struct shm_type<double> { static const char* get() { return "double"; } };
+template<> struct shm_type<int> { static const char* get() { return "int"; } };
+template<> struct shm_type<long> { static const char* get() { return "long"; } };
+
+
+/** @brief rows x cols row-major matrix in a named POSIX shared memory object.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class SharedMatrix {
+	public:
+		/** Creates a new shared memory object with every element set to fill.
+			@param name - object name, a '/' followed by up to 254 characters without '/'
+			@param rows - number of rows
+			@param cols - number of columns
+			@param fill - value of every element
+			@param huge_pages - whether to ask for transparent huge pages
+			@throw runtime_error if the object already exists or cannot be created
+		*/
+		SharedMatrix(const std::string& name, uint rows, uint cols, const N& fill, bool huge_pages = false);
+
+		/** Creates a new shared memory object holding a copy of m.
+			@param name - object name
+			@param m - matrix to copy
+			@param huge_pages - whether to ask for transparent huge pages
+			@throw runtime_error if the object already exists or cannot be created
+		*/
+		SharedMatrix(const std::string& name, const Matrix<N>& m, bool huge_pages = false);
+
+		/** Attaches to an object created by another SharedMatrix.
+			@param name - object name
+			@param read_only - map the elements read-only
+			@throw runtime_error if the object does not exist, is still being
+				written, or holds another element type
+		*/
+		explicit SharedMatrix(const std::string& name, bool read_only = true);
+
+		/** Destructor. Unmaps the object; it stays available to others until `remove`. */
+		~SharedMatrix();
+
+		/** Removes a name, so it can be created again. Processes that have the
+			object mapped keep using it.
+			@param name - object name
+			@return true if the name existed
+		*/
+		static bool remove(const std::string& name);
+
+		/** Get element r, c.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Set element r, c.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+			@throw runtime_error if the matrix is mapped read-only
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Unchecked access to element r, c. */
+		const N& operator()(uint r, uint c) const { return _data[static_cast<ul>(r) * _cols + c]; }
+
+		/** Get the elements, rows() * cols() row-major. */
+		const N* data() const { return _data; }
+
+		/** Get the elements for writing, rows() * cols() row-major.
+			@throw runtime_error if the matrix is mapped read-only
+		*/
+		N* mutable_data();
+
+		/** Copies the matrix into private memory.
+			@return a new rows x cols Matrix
+		*/
+		Matrix<N> dense() const;
+
+		/** Get the number of rows. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _cols; }
+
+		/** Get the number of elements. */
+		ul size() const { return static_cast<ul>(_rows) * _cols; }
+
+		/** Get the object name. */
+		const std::string& name() const { return _name; }
+
+		/** Get whether the elements are mapped read-only. */
+		bool read_only() const { return _read_only; }
+
+		/** Get whether huge pages were requested and the kernel accepted the hint. */
+		bool huge_pages() const { return _huge; }
+
+	private:
+		SharedMatrix(const SharedMatrix&);
+		SharedMatrix& operator=(const SharedMatrix&);
+
+		void create(uint rows, uint cols, bool huge_pages);
+		void publish();
+
+		std::string _name;	/**<object name*/
+		void* _map;			/**<start of the mapping, the header*/
+		ul _bytes;			/**<length of the mapping*/
+		N* _data;			/**<first element*/
+		uint _rows;			/**<number of rows*/
+		uint _cols;			/**<number of columns*/
+		bool _read_only;	/**<true if mapped without write access*/
+		bool _huge;			/**<true if the huge page hint was accepted*/
+};
+
+
+/** double precision shared matrix */
+typedef SharedMatrix<double> dSharedMatrix;
+/** single precision shared matrix */
+typedef SharedMatrix<float> fSharedMatrix;
+
+
+
+// implementation
+
+namespace detail {
+
+struct SharedHeader {
+	char magic[8];			/**<"GPMLSHM1"*/
+	uint64_t rows;			/**<number of rows*/
+	uint64_t cols;			/**<number of columns*/
+	uint64_t elem_size;		/**<sizeof(N)*/
+	char type[16];			/**<shm_type<N>::get(), zero padded*/
+	uint64_t huge;			/**<1 if the creator asked for huge pages*/
+	uint64_t ready;			/**<set to 1 once the elements are written*/
+};
+
+const ul shared_header_size = 64;
+const ul huge_page_size = 1ul << 21;
+
+// maps len bytes of fd, advising huge pages if asked. NULL on failure
+inline void* map_shared(int fd, ul len, bool writable, bool huge, bool& huge_ok) {
+	void* p = ::mmap(NULL, len, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+	if (p == MAP_FAILED) return NULL;
+	huge_ok = false;
+#ifdef MADV_HUGEPAGE
+	if (huge) huge_ok = ::madvise(p, len, MADV_HUGEPAGE) == 0;
+#endif
+	return p;
+}
+
+}	// detail
+
+
+template<typename N>
+void SharedMatrix<N>::create(uint rows, uint cols, bool huge_pages) {
+	_rows = rows;
+	_cols = cols;
+	_bytes = detail::shared_header_size + static_cast<ul>(rows) * cols * sizeof(N);
+	if (huge_pages) _bytes = (_bytes + detail::huge_page_size - 1) / detail::huge_page_size * detail::huge_page_size;
+
+	int fd = ::shm_open(_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0)
+		throw std::runtime_error("cannot create shared memory " + _name);
+	if (::ftruncate(fd, static_cast<off_t>(_bytes)) != 0) {
+		::close(fd);
+		::shm_unlink(_name.c_str());
+		throw std::runtime_error("cannot size shared memory " + _name);
+	}
+	_map = detail::map_shared(fd, _bytes, true, huge_pages, _huge);
+	::close(fd);
+	if (!_map) {
+		::shm_unlink(_name.c_str());
+		throw std::runtime_error("cannot map shared memory " + _name);
+	}
+
+	// the header is complete except for `ready`, which publish() sets last
+	detail::SharedHeader* h = static_cast<detail::SharedHeader*>(_map);
+	std::memset(h, 0, sizeof(*h));
+	std::memcpy(h->magic, "GPMLSHM1", 8);
+	h->rows = rows;
+	h->cols = cols;
+	h->elem_size = sizeof(N);
+	std::strncpy(h->type, shm_type<N>::get(), sizeof(h->type) - 1);
+	h->huge = huge_pages;
+	_data = reinterpret_cast<N*>(static_cast<char*>(_map) + detail::shared_header_size);
+}
+
+template<typename N>
+void SharedMatrix<N>::publish() {
+	__atomic_store_n(&static_cast<detail::SharedHeader*>(_map)->ready, 1, __ATOMIC_RELEASE);
+}
+
+template<typename N>
+SharedMatrix<N>::SharedMatrix(const std::string& name, uint rows, uint cols, const N& fill, bool huge_pages)
+	: _name(name), _map(NULL), _bytes(0), _data(NULL), _rows(0), _cols(0), _read_only(false), _huge(false) {
+	create(rows, cols, huge_pages);
+	std::fill(_data, _data + size(), fill);
+	publish();
+}
+
+template<typename N>
+SharedMatrix<N>::SharedMatrix(const std::string& name, const Matrix<N>& m, bool huge_pages)
+	: _name(name), _map(NULL), _bytes(0), _data(NULL), _rows(0), _cols(0), _read_only(false), _huge(false) {
+	create(m.rows(), m.cols(), huge_pages);
+	std::copy(m.data(), m.data() + size(), _data);
+	publish();
+}
+
+template<typename N>
+SharedMatrix<N>::SharedMatrix(const std::string& name, bool read_only)
+	: _name(name), _map(NULL), _bytes(0), _data(NULL), _rows(0), _cols(0), _read_only(read_only), _huge(false) {
+	int fd = ::shm_open(name.c_str(), read_only ? O_RDONLY : O_RDWR, 0);
+	if (fd < 0)
+		throw std::runtime_error("cannot open shared memory " + name);
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || static_cast<ul>(st.st_size) < detail::shared_header_size) {
+		::close(fd);
+		throw std::runtime_error(name + " is not a shared matrix");
+	}
+	_bytes = static_cast<ul>(st.st_size);
+
+	// map first, so the header and elements are read from one consistent mapping
+	bool huge = false;
+	_map = detail::map_shared(fd, _bytes, !read_only, false, huge);
+	::close(fd);
+	if (!_map)
+		throw std::runtime_error("cannot map shared memory " + name);
+
+	const detail::SharedHeader* h = static_cast<const detail::SharedHeader*>(_map);
+	const char* type = shm_type<N>::get();
+	bool ready = __atomic_load_n(&h->ready, __ATOMIC_ACQUIRE) == 1;
+	bool ok = ready && std::memcmp(h->magic, "GPMLSHM1", 8) == 0 && h->elem_size == sizeof(N)
+		&& (type[0] == '\0' || std::strncmp(h->type, type, sizeof(h->type)) == 0)
+		&& detail::shared_header_size + h->rows * h->cols * sizeof(N) <= _bytes;
+	if (!ok) {
+		::munmap(_map, _bytes);
+		throw std::runtime_error(ready ? name + " is not a shared matrix of this element type" : name + " is not a finished shared matrix");
+	}
+
+	_rows = static_cast<uint>(h->rows);
+	_cols = static_cast<uint>(h->cols);
+	_data = reinterpret_cast<N*>(static_cast<char*>(_map) + detail::shared_header_size);
+#ifdef MADV_HUGEPAGE
+	if (h->huge) _huge = ::madvise(_map, _bytes, MADV_HUGEPAGE) == 0;
+#endif
+}
+
+template<typename N>
+SharedMatrix<N>::~SharedMatrix() {
+	if (_map) ::munmap(_map, _bytes);
+}
+
+template<typename N>
+bool SharedMatrix<N>::remove(const std::string& name) {
+	return ::shm_unlink(name.c_str()) == 0;
+}
+
+template<typename N>
+N SharedMatrix<N>::at(uint r, uint c) const {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	return (*this)(r, c);
+}
+
+template<typename N>
+void SharedMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	mutable_data()[static_cast<ul>(r) * _cols + c] = val;
+}
+
+template<typename N>
+N* SharedMatrix<N>::mutable_data() {
+	if (_read_only)
+		throw std::runtime_error("shared matrix " + _name + " is mapped read-only");
+	return _data;
+}
+
+template<typename N>
+Matrix<N> SharedMatrix<N>::dense() const {
+	Matrix<N> m (_rows, _cols, N());
+	std::copy(_data, _data + size(), m.data());
+	return m;
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,282 @@
+/** @file Solve.hpp
+	Contains LU factorization with partial pivoting, the matching triangular
+	solves and a mixed-precision solver that factorizes in float and refines the
+	solution in double.
+
+	`solve_refined` follows LAPACK's dsgesv: the O(n^3) factorization runs in the
+	low precision type through `gemm`, and each refinement step costs one double
+	residual (O(n^2)) plus one low precision solve. Iteration stops once
+	`max|r| <= max|x| * max|A| * eps * sqrt(n)`. If that has not happened after
+	`max_iter` steps, if a correction fails to shrink, or if A does not fit the
+	low precision type, the system is factorized again in double.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _SOLVE_H_
+#define _SOLVE_H_
+
+#include <vector>		// vector
+#include <cmath>		// fabs, sqrt
+#include <limits>		// numeric_limits
+#include <algorithm>	// swap_ranges
+#include <stdexcept>	// invalid_argument
+#include "Matrix.hpp"	// Matrix, matrix_cast
+#include "Vector.hpp"	// Vector
+#include "Gemv.hpp"		// gemv
+#include "Gemm.hpp"		// gemm
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief Outcome of `solve_refined`.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct RefineInfo {
+	uint iterations;	/**<refinement steps taken in the low precision factorization*/
+	bool converged;		/**<true if the low precision factorization reached double accuracy*/
+	bool fell_back;		/**<true if the system was factorized again in double*/
+	double residual;	/**<max|b - A x| of the returned solution*/
+};
+
+
+/**	Factorizes square `A` in place as `P A = L U` with partial pivoting. L is unit
+	lower triangular and stored below the diagonal, U on and above it. The
+	factorization is blocked and the trailing updates go through `gemm`.
+	@param A - n x n matrix overwritten by L and U
+	@param piv - set to n entries; row i was swapped with row piv[i] at step i
+	@return false if a zero pivot was found, in which case A is singular
+	@throw invalid_argument if A is not square
+*/
+template<typename N>
+bool lu_factor(Matrix<N>& A, std::vector<uint>& piv);
+
+/**	Solves `A x = b` in place given the output of `lu_factor`.
+	@param LU - factorization from `lu_factor`
+	@param piv - pivots from `lu_factor`
+	@param b - right hand side, overwritten by x
+	@throw invalid_argument if the sizes do not agree
+*/
+template<typename N>
+void lu_solve(const Matrix<N>& LU, const std::vector<uint>& piv, Vector<N>& b);
+
+/**	Solves `A x = b` with an LU factorization in the precision of `N`.
+	@param A - n x n matrix
+	@param b - right hand side of size n
+	@return x
+	@throw invalid_argument if A is not square, the sizes do not agree or A is singular
+*/
+template<typename N>
+Vector<N> solve(const Matrix<N>& A, const Vector<N>& b);
+
+/**	Solves `A x = b` to double accuracy by factorizing in `F` (float by default;
+	bfloat16 is accepted for very well conditioned systems) and refining in
+	double. Falls back to a double factorization when refinement does not converge.
+	@param A - n x n matrix
+	@param b - right hand side of size n
+	@param info - if not NULL, receives iterations, convergence and fallback status
+	@param max_iter - refinement steps allowed before falling back
+	@return x
+	@throw invalid_argument if A is not square, the sizes do not agree or A is singular
+*/
+template<typename F>
+Vector<double> solve_refined(const Matrix<double>& A, const Vector<double>& b, RefineInfo* info = NULL, uint max_iter = 30);
+
+/**	`solve_refined` with a float factorization.
+	@param A - n x n matrix
+	@param b - right hand side of size n
+	@param info - if not NULL, receives iterations, convergence and fallback status
+	@param max_iter - refinement steps allowed before falling back
+	@return x
+	@throw invalid_argument if A is not square, the sizes do not agree or A is singular
+*/
+inline Vector<double> solve_refined(const Matrix<double>& A, const Vector<double>& b, RefineInfo* info = NULL, uint max_iter = 30) {
+	return solve_refined<float>(A, b, info, max_iter);
+}
+
+
+
+// implementation
+
+namespace detail {
+
+template<typename N>
+inline double abs_value(const N& x) {
+	return std::fabs(static_cast<double>(x));
+}
+
+template<typename N>
+inline double max_abs(const N* x, ul n) {
+	double m = 0.0;
+	for (ul i = 0; i < n; ++i) m = (abs_value(x[i]) > m) ? abs_value(x[i]) : m;
+	return m;
+}
+
+// unblocked LU of the panel A[k0:n, k0:k1], swapping whole rows of the n x ld matrix
+template<typename N>
+bool lu_panel(N* A, uint n, ul lda, uint k0, uint k1, std::vector<uint>& piv) {
+	for (uint j = k0; j < k1; ++j) {
+		uint p = j;
+		double best = abs_value(A[j * lda + j]);
+		for (uint i = j + 1; i < n; ++i) {
+			double v = abs_value(A[i * lda + j]);
+			if (v > best) { best = v; p = i; }
+		}
+		piv[j] = p;
+		if (best == 0.0) return false;
+		if (p != j) std::swap_ranges(A + j * lda, A + j * lda + n, A + p * lda);
+
+		N d = A[j * lda + j];
+		for (uint i = j + 1; i < n; ++i) {
+			N* row = A + i * lda;
+			N l = row[j] / d;
+			row[j] = l;
+			const N* urow = A + j * lda;
+			for (uint c = j + 1; c < k1; ++c) row[c] -= l * urow[c];
+		}
+	}
+	return true;
+}
+
+}	// detail
+
+
+template<typename N>
+bool lu_factor(Matrix<N>& A, std::vector<uint>& piv) {
+	if (A.rows() != A.cols())
+		throw std::invalid_argument("LU factorization needs a square matrix");
+
+	uint n = A.rows();
+	ul lda = n;
+	N* a = A.data();
+	piv.assign(n, 0);
+
+	const uint nb = 64;
+	for (uint k0 = 0; k0 < n; k0 += nb) {
+		uint k1 = (k0 + nb < n) ? k0 + nb : n;
+		if (!detail::lu_panel(a, n, lda, k0, k1, piv)) return false;
+		if (k1 == n) break;
+
+		// U12 = L11^-1 A12
+		for (uint i = k0 + 1; i < k1; ++i) {
+			N* row = a + i * lda;
+			for (uint p = k0; p < i; ++p) {
+				N l = row[p];
+				const N* urow = a + p * lda;
+				for (uint c = k1; c < n; ++c) row[c] -= l * urow[c];
+			}
+		}
+
+		// A22 -= L21 U12
+		gemm(n - k1, n - k1, k1 - k0, N(-1), a + k1 * lda + k0, lda, a + k0 * lda + k1, lda,
+			N(1), a + k1 * lda + k1, lda);
+	}
+	return true;
+}
+
+template<typename N>
+void lu_solve(const Matrix<N>& LU, const std::vector<uint>& piv, Vector<N>& b) {
+	uint n = LU.rows();
+	if (LU.cols() != n || b.size() != n || piv.size() != n)
+		throw std::invalid_argument("vector size does not match factorization");
+
+	const N* a = LU.data();
+	N* x = b.data();
+	for (uint i = 0; i < n; ++i)
+		if (piv[i] != i) std::swap(x[i], x[piv[i]]);
+
+	// forward substitution with unit diagonal, then backward substitution
+	for (uint i = 1; i < n; ++i)
+		x[i] -= detail::dot_kernel(a + static_cast<ul>(i) * n, x, i);
+	for (uint i = n; i-- > 0; ) {
+		const N* row = a + static_cast<ul>(i) * n;
+		x[i] = (x[i] - detail::dot_kernel(row + i + 1, x + i + 1, n - i - 1)) / row[i];
+	}
+}
+
+template<typename N>
+Vector<N> solve(const Matrix<N>& A, const Vector<N>& b) {
+	if (A.rows() != A.cols() || b.size() != A.rows())
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	Matrix<N> LU (A);
+	std::vector<uint> piv;
+	if (!lu_factor(LU, piv))
+		throw std::invalid_argument("matrix is singular");
+
+	Vector<N> x (b);
+	lu_solve(LU, piv, x);
+	return x;
+}
+
+template<typename F>
+Vector<double> solve_refined(const Matrix<double>& A, const Vector<double>& b, RefineInfo* info, uint max_iter) {
+	if (A.rows() != A.cols() || b.size() != A.rows())
+		throw std::invalid_argument("vector size does not match matrix shape");
+
+	uint n = A.rows();
+	RefineInfo result = { 0, false, false, 0.0 };
+	Vector<double> x (n, 0.0), r (b);
+
+	double anrm = detail::max_abs(A.data(), A.size());
+	double cte = anrm * std::numeric_limits<double>::epsilon() * std::sqrt(static_cast<double>(n));
+	bool fits = anrm <= static_cast<double>(std::numeric_limits<float>::max());
+
+	Matrix<F> LU = matrix_cast<F>(A);
+	std::vector<uint> piv;
+	Vector<F> d (n, F());
+
+	if (fits && lu_factor(LU, piv)) {
+		double prev = std::numeric_limits<double>::infinity();
+		for (uint it = 0; it <= max_iter; ++it) {
+			// r = b - A x in double
+			if (it > 0) {
+				r = b;
+				gemv(-1.0, A, x, 1.0, r);
+			}
+			double rnrm = detail::max_abs(r.data(), n);
+			double xnrm = detail::max_abs(x.data(), n);
+			result.residual = rnrm;
+			if (it > 0 && rnrm <= xnrm * cte) {
+				result.converged = true;
+				break;
+			}
+			if (it == max_iter || rnrm * 0.0 != 0.0) break;
+
+			// correction from the low precision factorization
+			for (uint i = 0; i < n; ++i) d[i] = static_cast<F>(r[i]);
+			lu_solve(LU, piv, d);
+
+			double dnrm = 0.0;
+			for (uint i = 0; i < n; ++i) {
+				double di = static_cast<double>(d[i]);
+				x[i] += di;
+				dnrm = (std::fabs(di) > dnrm) ? std::fabs(di) : dnrm;
+			}
+			result.iterations = it + 1;
+
+			// corrections must contract; otherwise refinement has stalled
+			if (dnrm >= prev) break;
+			prev = dnrm;
+		}
+	}
+
+	if (!result.converged) {
+		result.fell_back = true;
+		x = solve(A, b);
+		r = b;
+		gemv(-1.0, A, x, 1.0, r);
+		result.residual = detail::max_abs(r.data(), n);
+	}
+
+	if (info) *info = result;
+	return x;
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,324 @@
+/** @file Strassen.hpp
+	Contains the Strassen-Winograd multiply used by `gemm` for very large floating
+	point products, and the settings that control when it is selected.
+
+	Each level replaces 8 half-size products with 7 and 15 block additions. The
+	recursion drops to the blocked kernel once any dimension reaches `cutoff()`.
+	Below the top level all temporaries come from one workspace allocated up front
+	and reused at every level; the top level runs its 7 products in parallel on the
+	thread pool. Odd dimensions are handled by peeling the last row, column or
+	inner index and fixing it up with the blocked kernel.
+
+	Strassen-type algorithms only satisfy normwise, not componentwise, error bounds
+	and the constant grows with recursion depth. Set `strassen::enabled() = false`
+	or call `gemm_classical` where that matters.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _STRASSEN_H_
+#define _STRASSEN_H_
+
+#include <vector>		// vector
+#include <type_traits>	// is_floating_point
+#include "Gemm.hpp"		// gemm_blocked
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+namespace strassen {
+
+/** Whether `gemm` may pick Strassen-Winograd automatically.
+	@return reference to the flag so it can be changed at runtime
+*/
+inline bool& enabled() {
+	static bool e = true;
+	return e;
+}
+
+/** Smallest of m, n and k at which `gemm` switches to Strassen-Winograd.
+	@return reference to the threshold so it can be changed at runtime
+*/
+inline uint& threshold() {
+	static uint t = 4096;
+	return t;
+}
+
+/** Recursion stops and the blocked kernel is used once any dimension is at or
+	below this size.
+	@return reference to the cutoff so it can be changed at runtime
+*/
+inline uint& cutoff() {
+	static uint c = 1024;
+	return c;
+}
+
+}	// strassen
+
+
+/**	Computes `C = alpha * A * B + beta * C` with Strassen-Winograd regardless of
+	`strassen::threshold()`. Arguments are the same as `gemm`.
+	@param m - rows of A and C
+	@param n - columns of B and C
+	@param k - columns of A and rows of B
+	@param alpha - scale applied to `A * B`
+	@param A - m x k matrix with row stride lda
+	@param lda - distance between rows of A
+	@param B - k x n matrix with row stride ldb
+	@param ldb - distance between rows of B
+	@param beta - scale applied to C before accumulation. When zero C is not read.
+	@param C - m x n matrix with row stride ldc. Must not overlap A or B.
+	@param ldc - distance between rows of C
+*/
+template<typename N>
+void gemm_strassen(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc);
+
+
+
+// implementation
+
+namespace detail {
+
+inline uint min3(uint a, uint b, uint c) {
+	uint m = a < b ? a : b;
+	return m < c ? m : c;
+}
+
+// Z = X + Y or Z = X - Y on rows x cols strided blocks. Z may alias X or Y.
+template<typename N>
+void block_add(uint rows, uint cols, const N* X, ul ldx, const N* Y, ul ldy, N* Z, ul ldz) {
+	for (uint r = 0; r < rows; ++r) {
+		const N* x = X + r * ldx;
+		const N* y = Y + r * ldy;
+		N* z = Z + r * ldz;
+		for (uint c = 0; c < cols; ++c) z[c] = x[c] + y[c];
+	}
+}
+
+template<typename N>
+void block_sub(uint rows, uint cols, const N* X, ul ldx, const N* Y, ul ldy, N* Z, ul ldz) {
+	for (uint r = 0; r < rows; ++r) {
+		const N* x = X + r * ldx;
+		const N* y = Y + r * ldy;
+		N* z = Z + r * ldz;
+		for (uint c = 0; c < cols; ++c) z[c] = x[c] - y[c];
+	}
+}
+
+// elements of workspace needed by winograd() below for an m x k by k x n product
+inline ul winograd_workspace(uint m, uint n, uint k, uint cutoff) {
+	ul total = 0;
+	while (min3(m, n, k) > cutoff && min3(m, n, k) >= 2) {
+		m /= 2; n /= 2; k /= 2;
+		total += static_cast<ul>(m) * k + static_cast<ul>(k) * n + static_cast<ul>(m) * n;
+	}
+	return total;
+}
+
+// fixes up the last row, column and inner index left over when a dimension is odd
+template<typename N>
+void winograd_peel(uint m, uint n, uint k, const N* A, ul lda, const N* B, ul ldb, N* C, ul ldc) {
+	uint me = m & ~1u, ne = n & ~1u, ke = k & ~1u;
+
+	if (ke != k)
+		gemm_blocked(me, ne, 1, N(1), A + ke, lda, B + ke * ldb, ldb, N(1), C, ldc);
+	if (ne != n)
+		gemm_blocked(me, 1, k, N(1), A, lda, B + ne, ldb, N(), C + ne, ldc);
+	if (me != m)
+		gemm_blocked(1, n, k, N(1), A + me * lda, lda, B, ldb, N(), C + me * ldc, ldc);
+}
+
+/*
+	C = A * B. one level uses three temporaries from `work`: X (m/2 x k/2),
+	Y (k/2 x n/2) and Z (m/2 x n/2); the rest of `work` is passed down. the
+	schedule keeps every other intermediate in the quadrants of C.
+*/
+template<typename N>
+void winograd(uint m, uint n, uint k, const N* A, ul lda, const N* B, ul ldb, N* C, ul ldc, N* work, uint cutoff) {
+	if (min3(m, n, k) <= cutoff || min3(m, n, k) < 2) {
+		gemm_blocked(m, n, k, N(1), A, lda, B, ldb, N(), C, ldc);
+		return;
+	}
+
+	uint m2 = m / 2, n2 = n / 2, k2 = k / 2;
+	const N *A11 = A, *A12 = A + k2, *A21 = A + m2 * lda, *A22 = A21 + k2;
+	const N *B11 = B, *B12 = B + n2, *B21 = B + k2 * ldb, *B22 = B21 + n2;
+	N *C11 = C, *C12 = C + n2, *C21 = C + m2 * ldc, *C22 = C21 + n2;
+
+	N* X = work;
+	N* Y = X + static_cast<ul>(m2) * k2;
+	N* Z = Y + static_cast<ul>(k2) * n2;
+	N* next = Z + static_cast<ul>(m2) * n2;
+	ul ldx = k2, ldy = n2, ldz = n2;
+
+	block_sub(m2, k2, A11, lda, A21, lda, X, ldx);						// S3 = A11 - A21
+	block_sub(k2, n2, B22, ldb, B12, ldb, Y, ldy);						// T3 = B22 - B12
+	winograd(m2, n2, k2, X, ldx, Y, ldy, C21, ldc, next, cutoff);		// P7 = S3 T3
+
+	block_add(m2, k2, A21, lda, A22, lda, X, ldx);						// S1 = A21 + A22
+	block_sub(k2, n2, B12, ldb, B11, ldb, Y, ldy);						// T1 = B12 - B11
+	winograd(m2, n2, k2, X, ldx, Y, ldy, C22, ldc, next, cutoff);		// P5 = S1 T1
+
+	block_sub(m2, k2, X, ldx, A11, lda, X, ldx);						// S2 = S1 - A11
+	block_sub(k2, n2, B22, ldb, Y, ldy, Y, ldy);						// T2 = B22 - T1
+	winograd(m2, n2, k2, X, ldx, Y, ldy, C12, ldc, next, cutoff);		// P6 = S2 T2
+
+	block_sub(m2, k2, A12, lda, X, ldx, X, ldx);						// S4 = A12 - S2
+	winograd(m2, n2, k2, X, ldx, B22, ldb, C11, ldc, next, cutoff);		// P3 = S4 B22
+
+	winograd(m2, n2, k2, A11, lda, B11, ldb, Z, ldz, next, cutoff);		// P1 = A11 B11
+
+	block_add(m2, n2, Z, ldz, C12, ldc, C12, ldc);						// U2 = P1 + P6
+	block_add(m2, n2, C12, ldc, C21, ldc, C21, ldc);					// U3 = U2 + P7
+	block_add(m2, n2, C12, ldc, C22, ldc, C12, ldc);					// U4 = U2 + P5
+	block_add(m2, n2, C21, ldc, C22, ldc, C22, ldc);					// C22 = U3 + P5
+	block_add(m2, n2, C12, ldc, C11, ldc, C12, ldc);					// C12 = U4 + P3
+
+	block_sub(k2, n2, Y, ldy, B21, ldb, Y, ldy);						// T4 = T2 - B21
+	winograd(m2, n2, k2, A22, lda, Y, ldy, C11, ldc, next, cutoff);		// P4 = A22 T4
+	block_sub(m2, n2, C21, ldc, C11, ldc, C21, ldc);					// C21 = U3 - P4
+
+	winograd(m2, n2, k2, A12, lda, B21, ldb, C11, ldc, next, cutoff);	// P2 = A12 B21
+	block_add(m2, n2, Z, ldz, C11, ldc, C11, ldc);						// C11 = P1 + P2
+
+	winograd_peel(m, n, k, A, lda, B, ldb, C, ldc);
+}
+
+/*
+	top level with the 7 products run as independent pool tasks. each task builds
+	its own operands and workspace; the products are then combined in one pass.
+*/
+template<typename N>
+void winograd_parallel(uint m, uint n, uint k, const N* A, ul lda, const N* B, ul ldb, N* C, ul ldc, uint cutoff) {
+	uint m2 = m / 2, n2 = n / 2, k2 = k / 2;
+	const N *A11 = A, *A12 = A + k2, *A21 = A + m2 * lda, *A22 = A21 + k2;
+	const N *B11 = B, *B12 = B + n2, *B21 = B + k2 * ldb, *B22 = B21 + n2;
+
+	ul pc = static_cast<ul>(m2) * n2;
+	std::vector<N> products (7 * pc);
+	N* P = products.data();
+
+	parallel::parallel_for(0, 7, [=](ul lo, ul hi) {
+		for (ul t = lo; t < hi; ++t) {
+			std::vector<N> S (static_cast<ul>(m2) * k2), T (static_cast<ul>(k2) * n2);
+			std::vector<N> work (winograd_workspace(m2, n2, k2, cutoff) + 1);
+			N* s = S.data();
+			N* tt = T.data();
+			N* w = work.data();
+			N* out = P + t * pc;
+
+			switch (t) {
+				case 0:		// P1 = A11 B11
+					winograd(m2, n2, k2, A11, lda, B11, ldb, out, n2, w, cutoff);
+					break;
+				case 1:		// P2 = A12 B21
+					winograd(m2, n2, k2, A12, lda, B21, ldb, out, n2, w, cutoff);
+					break;
+				case 2:		// P3 = S4 B22, S4 = A12 - (A21 + A22 - A11)
+					block_add(m2, k2, A21, lda, A22, lda, s, k2);
+					block_sub(m2, k2, s, k2, A11, lda, s, k2);
+					block_sub(m2, k2, A12, lda, s, k2, s, k2);
+					winograd(m2, n2, k2, s, k2, B22, ldb, out, n2, w, cutoff);
+					break;
+				case 3:		// P4 = A22 T4, T4 = (B22 - (B12 - B11)) - B21
+					block_sub(k2, n2, B12, ldb, B11, ldb, tt, n2);
+					block_sub(k2, n2, B22, ldb, tt, n2, tt, n2);
+					block_sub(k2, n2, tt, n2, B21, ldb, tt, n2);
+					winograd(m2, n2, k2, A22, lda, tt, n2, out, n2, w, cutoff);
+					break;
+				case 4:		// P5 = S1 T1
+					block_add(m2, k2, A21, lda, A22, lda, s, k2);
+					block_sub(k2, n2, B12, ldb, B11, ldb, tt, n2);
+					winograd(m2, n2, k2, s, k2, tt, n2, out, n2, w, cutoff);
+					break;
+				case 5:		// P6 = S2 T2
+					block_add(m2, k2, A21, lda, A22, lda, s, k2);
+					block_sub(m2, k2, s, k2, A11, lda, s, k2);
+					block_sub(k2, n2, B12, ldb, B11, ldb, tt, n2);
+					block_sub(k2, n2, B22, ldb, tt, n2, tt, n2);
+					winograd(m2, n2, k2, s, k2, tt, n2, out, n2, w, cutoff);
+					break;
+				default:	// P7 = S3 T3
+					block_sub(m2, k2, A11, lda, A21, lda, s, k2);
+					block_sub(k2, n2, B22, ldb, B12, ldb, tt, n2);
+					winograd(m2, n2, k2, s, k2, tt, n2, out, n2, w, cutoff);
+					break;
+			}
+		}
+	}, 1);
+
+	N *C11 = C, *C12 = C + n2, *C21 = C + m2 * ldc, *C22 = C21 + n2;
+	parallel::parallel_for(0, m2, [=](ul lo, ul hi) {
+		for (ul r = lo; r < hi; ++r) {
+			const N* p1 = P + r * n2;
+			const N* p2 = p1 + pc;
+			const N* p3 = p2 + pc;
+			const N* p4 = p3 + pc;
+			const N* p5 = p4 + pc;
+			const N* p6 = p5 + pc;
+			const N* p7 = p6 + pc;
+			N *c11 = C11 + r * ldc, *c12 = C12 + r * ldc, *c21 = C21 + r * ldc, *c22 = C22 + r * ldc;
+
+			for (uint c = 0; c < n2; ++c) {
+				N u2 = p1[c] + p6[c];
+				N u3 = u2 + p7[c];
+				c11[c] = p1[c] + p2[c];
+				c12[c] = (u2 + p5[c]) + p3[c];
+				c21[c] = u3 - p4[c];
+				c22[c] = u3 + p5[c];
+			}
+		}
+	}, n2 ? (parallel::threshold() / n2 ? parallel::threshold() / n2 : 1) : 1);
+
+	winograd_peel(m, n, k, A, lda, B, ldb, C, ldc);
+}
+
+template<typename N>
+bool use_strassen(uint m, uint n, uint k) {
+	return std::is_floating_point<N>::value && strassen::enabled()
+		&& min3(m, n, k) >= strassen::threshold() && min3(m, n, k) > strassen::cutoff();
+}
+
+template<typename N>
+void strassen_gemm(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc) {
+	uint cutoff = strassen::cutoff() ? strassen::cutoff() : 1;
+	if (m == 0 || n == 0 || min3(m, n, k) <= cutoff || min3(m, n, k) < 2) {
+		gemm_blocked(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+		return;
+	}
+
+	// the recursion computes a plain product; scale into C afterwards when needed
+	bool direct = (alpha == N(1) && beta == N());
+	std::vector<N> tmp (direct ? 0 : static_cast<ul>(m) * n);
+	N* out = direct ? C : tmp.data();
+	ul ldo = direct ? ldc : n;
+
+	if (parallel::num_threads() > 1) {
+		winograd_parallel(m, n, k, A, lda, B, ldb, out, ldo, cutoff);
+	} else {
+		std::vector<N> work (winograd_workspace(m, n, k, cutoff) + 1);
+		winograd(m, n, k, A, lda, B, ldb, out, ldo, work.data(), cutoff);
+	}
+
+	if (!direct) {
+		for (uint r = 0; r < m; ++r) {
+			N* c = C + r * ldc;
+			const N* t = out + r * ldo;
+			if (beta == N()) for (uint j = 0; j < n; ++j) c[j] = alpha * t[j];
+			else for (uint j = 0; j < n; ++j) c[j] = alpha * t[j] + beta * c[j];
+		}
+	}
+}
+
+}	// detail
+
+
+template<typename N>
+void gemm_strassen(uint m, uint n, uint k, N alpha, const N* A, ul lda, const N* B, ul ldb, N beta, N* C, ul ldc) {
+	detail::strassen_gemm(m, n, k, alpha, A, lda, B, ldb, beta, C, ldc);
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,263 @@
+/** @file TaskGraph.hpp
+	Contains a task graph whose dependencies are inferred from the data each task
+	reads and writes, and the dynamic scheduler that runs it on the thread pool.
+
+	Tasks are added in program order, each with the keys of the data it reads
+	and writes, typically tile pointers. A task runs after the last earlier
+	writer of everything it reads, and after the last writer and every later
+	reader of everything it writes, so running the graph gives the same result
+	as running the tasks in order. When the graph runs, each task's priority is
+	its bottom level: its own cost plus the costliest path through the tasks
+	that depend on it. Ready tasks run highest priority first, which keeps the
+	critical path moving and lets later steps overlap earlier ones instead of
+	waiting at a barrier after each one. Parallel loops inside tasks run on the
+	task's own thread (see `parallel::serial()`).
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _TASKGRAPH_H_
+#define _TASKGRAPH_H_
+
+#include <vector>				// vector
+#include <queue>				// priority_queue
+#include <unordered_map>		// unordered_map
+#include <functional>			// function
+#include <mutex>				// mutex, unique_lock
+#include <condition_variable>	// condition_variable
+#include <memory>				// shared_ptr, make_shared
+#include <exception>			// exception_ptr
+#include <utility>				// pair
+#include "Parallel.hpp"			// pool, num_threads, serial
+#include "Trace.hpp"			// GPML_TRACE_SPAN
+#include "typedefs.h"			// uint, ul
+
+
+namespace math {
+
+
+/** @brief Tasks with data dependencies, run by a critical-path-first scheduler.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class TaskGraph {
+	public:
+		/** Creates an empty graph. */
+		TaskGraph() : _edges(0) {}
+
+		/** Adds a task after every task added so far.
+			@param name - static string naming the task in traces
+			@param f - callable to run
+			@param cost - relative cost used for priorities, such as its flops
+			@param reads - keys of the data the task reads
+			@param writes - keys of the data the task writes
+			@return index of the task
+		*/
+		uint add(const char* name, std::function<void()> f, double cost,
+				const std::vector<const void*>& reads, const std::vector<const void*>& writes);
+
+		/** Runs every task on up to `parallel::num_threads()` threads, including
+			the caller, and returns once all have finished. After a task throws,
+			tasks that have not started are skipped. The graph can only be run once.
+			@throw rethrows the first exception thrown by a task
+		*/
+		void run();
+
+		/** Get the number of tasks. */
+		uint size() const { return static_cast<uint>(_tasks.size()); }
+
+		/** Get the number of dependency edges. */
+		ul edges() const { return _edges; }
+
+		/** Get the cost of the costliest chain of dependent tasks, a lower bound on
+			the run time in cost units however many threads are used.
+			@return sum of the costs along the critical path
+		*/
+		double critical_path() const;
+
+	private:
+		struct Task {
+			const char* name;
+			std::function<void()> f;
+			double cost;
+			double priority;
+			uint pending;
+			std::vector<uint> next;
+		};
+
+		// last writer and the readers since, of one key
+		struct Access {
+			uint writer;
+			bool written;
+			std::vector<uint> readers;
+			Access() : writer(0), written(false) {}
+		};
+
+		void depend(uint from, uint to);
+		void prioritize();
+
+		std::vector<Task> _tasks;							/**<tasks in program order*/
+		std::unordered_map<const void*, Access> _access;	/**<dependency state of every key*/
+		ul _edges;											/**<number of edges*/
+};
+
+
+
+// implementation
+
+inline void TaskGraph::depend(uint from, uint to) {
+	std::vector<uint>& next = _tasks[from].next;
+	if (from == to || (!next.empty() && next.back() == to)) return;
+	next.push_back(to);
+	++_tasks[to].pending;
+	++_edges;
+}
+
+inline uint TaskGraph::add(const char* name, std::function<void()> f, double cost,
+						const std::vector<const void*>& reads, const std::vector<const void*>& writes) {
+	uint t = static_cast<uint>(_tasks.size());
+	Task task;
+	task.name = name;
+	task.f = f;
+	task.cost = cost;
+	task.priority = 0;
+	task.pending = 0;
+	_tasks.push_back(task);
+
+	// read after write
+	for (ul i = 0; i < reads.size(); ++i) {
+		Access& a = _access[reads[i]];
+		if (a.written) depend(a.writer, t);
+	}
+	// write after write and write after read
+	for (ul i = 0; i < writes.size(); ++i) {
+		Access& a = _access[writes[i]];
+		if (a.written) depend(a.writer, t);
+		for (ul r = 0; r < a.readers.size(); ++r) depend(a.readers[r], t);
+		a.readers.clear();
+		a.writer = t;
+		a.written = true;
+	}
+	for (ul i = 0; i < reads.size(); ++i) {
+		Access& a = _access[reads[i]];
+		if (!a.written || a.writer != t) a.readers.push_back(t);
+	}
+	return t;
+}
+
+// edges only point forward, so a reverse sweep sees every successor first
+inline void TaskGraph::prioritize() {
+	for (ul i = _tasks.size(); i-- > 0; ) {
+		Task& t = _tasks[i];
+		double longest = 0;
+		for (ul s = 0; s < t.next.size(); ++s)
+			if (_tasks[t.next[s]].priority > longest) longest = _tasks[t.next[s]].priority;
+		t.priority = t.cost + longest;
+	}
+}
+
+inline double TaskGraph::critical_path() const {
+	std::vector<double> level (_tasks.size(), 0.0);
+	double best = 0;
+	for (ul i = _tasks.size(); i-- > 0; ) {
+		double longest = 0;
+		for (ul s = 0; s < _tasks[i].next.size(); ++s)
+			if (level[_tasks[i].next[s]] > longest) longest = level[_tasks[i].next[s]];
+		level[i] = _tasks[i].cost + longest;
+		if (level[i] > best) best = level[i];
+	}
+	return best;
+}
+
+namespace detail {
+
+// ready queue and completion state shared by the scheduler's workers
+struct GraphRun {
+	typedef std::pair<double, uint> Entry;	// priority, then ~index so earlier tasks win ties
+
+	std::priority_queue<Entry> ready;
+	std::vector<uint> pending;
+	ul finished;
+	ul total;
+	std::exception_ptr error;
+	std::mutex mutex;
+	std::condition_variable cv;
+
+	GraphRun() : finished(0), total(0) {}
+};
+
+}	// detail
+
+inline void TaskGraph::run() {
+	if (_tasks.empty()) return;
+	prioritize();
+
+	std::shared_ptr<detail::GraphRun> state = std::make_shared<detail::GraphRun>();
+	state->total = _tasks.size();
+	state->pending.resize(_tasks.size());
+	for (ul i = 0; i < _tasks.size(); ++i) {
+		state->pending[i] = _tasks[i].pending;
+		if (_tasks[i].pending == 0) state->ready.push(detail::GraphRun::Entry(_tasks[i].priority, ~static_cast<uint>(i)));
+	}
+
+	std::vector<Task>* tasks = &_tasks;
+	std::function<void()> worker = [state, tasks] {
+		bool& serial = parallel::serial();
+		bool was = serial;
+		serial = true;
+
+		std::unique_lock<std::mutex> lock (state->mutex);
+		for (;;) {
+			state->cv.wait(lock, [&state] { return !state->ready.empty() || state->finished == state->total; });
+			if (state->ready.empty()) break;
+
+			uint t = ~state->ready.top().second;
+			state->ready.pop();
+			bool skip = static_cast<bool>(state->error);
+			lock.unlock();
+
+			Task& task = (*tasks)[t];
+			if (!skip) {
+				try {
+					GPML_TRACE_SPAN(task.name);
+					task.f();
+				} catch (...) {
+					std::unique_lock<std::mutex> elock (state->mutex);
+					if (!state->error) state->error = std::current_exception();
+				}
+			}
+
+			lock.lock();
+			++state->finished;
+			uint woken = 0;
+			for (ul s = 0; s < task.next.size(); ++s) {
+				uint n = task.next[s];
+				if (--state->pending[n] == 0) {
+					state->ready.push(detail::GraphRun::Entry((*tasks)[n].priority, ~n));
+					++woken;
+				}
+			}
+			if (state->finished == state->total) state->cv.notify_all();
+			else if (woken > 1) state->cv.notify_all();
+			else if (woken == 1) state->cv.notify_one();
+		}
+		lock.unlock();
+		serial = was;
+	};
+
+	// helpers that start after the graph has finished find nothing to do and return
+	ul threads = parallel::num_threads();
+	if (threads > _tasks.size()) threads = _tasks.size();
+	for (ul t = 1; t < threads; ++t)
+		parallel::pool().submit(worker);
+	worker();
+
+	// the graph is finished, but helpers may still hold the lock on their way out
+	std::unique_lock<std::mutex> lock (state->mutex);
+	if (state->error) std::rethrow_exception(state->error);
+}
+
+}	// math
+
+#endif
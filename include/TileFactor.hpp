@@ -0,0 +1,461 @@
+/** @file TileFactor.hpp
+	Contains Cholesky, LU and QR factorizations of TiledMatrix operands expressed
+	as graphs of tile tasks and run by the TaskGraph scheduler.
+
+	Each factorization adds its tile kernels in the order of the sequential
+	right-looking algorithm and lets the graph infer the dependencies from the
+	tiles they touch. There is no barrier between steps: as soon as the panel of
+	step k+1 has received its updates it can start, while the trailing updates of
+	step k are still running elsewhere, and the critical-path priorities make
+	sure it does. Every kernel works on whole tiles with a leading dimension of
+	the tile size, and the updates use the gemm micro-kernel.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _TILEFACTOR_H_
+#define _TILEFACTOR_H_
+
+#include <vector>		// vector
+#include <cmath>		// sqrt
+#include <atomic>		// atomic
+#include <algorithm>	// min, swap_ranges
+#include <stdexcept>	// invalid_argument
+#include "Tiled.hpp"	// TiledMatrix
+#include "TaskGraph.hpp"	// TaskGraph
+#include "Gemm.hpp"		// detail::gemm_rows
+#include "Solve.hpp"	// detail::abs_value
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/**	Cholesky factorization `A = L L^T` of a symmetric positive definite tiled
+	matrix. Only the lower triangle is read and it is overwritten by L; tiles
+	above the diagonal are not touched.
+	@param A - n x n tiled matrix
+	@return false if A is not positive definite, in which case A is partly overwritten
+	@throw invalid_argument if A is not square
+*/
+template<typename N>
+bool tile_cholesky(TiledMatrix<N>& A);
+
+/**	LU factorization `P A = L U` with partial pivoting of a tiled matrix, stored
+	like `lu_factor`: unit lower triangular L below the diagonal, U on and above
+	it. Pivots are searched in the whole column, so each panel is one task that
+	owns its tile column; the row swaps, triangular solves and updates to the
+	rest of the matrix are separate tasks.
+	@param A - n x n tiled matrix overwritten by L and U
+	@param piv - set to n entries; row i was swapped with row piv[i] at step i
+	@return false if a zero pivot was found, in which case A is singular
+	@throw invalid_argument if A is not square
+*/
+template<typename N>
+bool tile_lu(TiledMatrix<N>& A, std::vector<uint>& piv);
+
+/**	Householder QR factorization `A = Q R` of a tiled matrix with at least as
+	many rows as columns. R overwrites the upper triangle of the top tiles. Q is
+	kept as reflectors: those of the diagonal tiles below their diagonal and
+	those that zero the tiles below the diagonal in place of those tiles, each
+	`H = I - tau v v^T` with an implicit leading 1.
+	@param A - m x n tiled matrix, m >= n
+	@param tau - set to the reflector scales, tile_size() per tile with tile (i, k)
+		at offset (i * tile_cols() + k) * tile_size()
+	@throw invalid_argument if A has fewer rows than columns
+*/
+template<typename N>
+void tile_qr(TiledMatrix<N>& A, std::vector<N>& tau);
+
+
+
+// implementation
+
+namespace detail {
+
+// rows or columns of tile t that lie inside a dimension of n
+inline uint tile_extent(uint n, uint ts, uint t) {
+	return std::min(ts, n - t * ts);
+}
+
+// dependency key of a tile, or of its upper triangle when upper is set
+inline const void* tile_key(const void* tile, bool upper = false) {
+	return static_cast<const char*>(tile) + (upper ? 1 : 0);
+}
+
+// tile sized scratch space owned by the calling thread
+template<typename N>
+inline N* tile_scratch(uint ts) {
+	thread_local std::vector<N> s;
+	if (s.size() < static_cast<ul>(ts) * ts) s.resize(static_cast<ul>(ts) * ts);
+	return s.data();
+}
+
+// Cholesky of the nb x nb lower triangle of a. false if a is not positive definite
+template<typename N>
+bool tile_potrf(N* a, uint nb, uint ts) {
+	for (uint j = 0; j < nb; ++j) {
+		N* rj = a + static_cast<ul>(j) * ts;
+		N d = rj[j];
+		for (uint p = 0; p < j; ++p) d -= rj[p] * rj[p];
+		if (!(d > N())) return false;
+		d = std::sqrt(d);
+		rj[j] = d;
+		for (uint i = j + 1; i < nb; ++i) {
+			N* ri = a + static_cast<ul>(i) * ts;
+			N s = ri[j];
+			for (uint p = 0; p < j; ++p) s -= ri[p] * rj[p];
+			ri[j] = s / d;
+		}
+	}
+	return true;
+}
+
+// b = b * L^-T for the mb x nb tile b and nb x nb lower triangular l
+template<typename N>
+void tile_trsm_lower_t(const N* l, N* b, uint mb, uint nb, uint ts) {
+	for (uint r = 0; r < mb; ++r) {
+		N* br = b + static_cast<ul>(r) * ts;
+		for (uint j = 0; j < nb; ++j) {
+			const N* lj = l + static_cast<ul>(j) * ts;
+			N s = br[j];
+			for (uint p = 0; p < j; ++p) s -= br[p] * lj[p];
+			br[j] = s / lj[j];
+		}
+	}
+}
+
+// lower triangle of the nb x nb tile c -= a a^T, a is nb x kb
+template<typename N>
+void tile_syrk(const N* a, N* c, uint nb, uint kb, uint ts) {
+	for (uint r = 0; r < nb; ++r) {
+		const N* ar = a + static_cast<ul>(r) * ts;
+		N* cr = c + static_cast<ul>(r) * ts;
+		for (uint q = 0; q <= r; ++q) {
+			const N* aq = a + static_cast<ul>(q) * ts;
+			N s = N();
+			for (uint p = 0; p < kb; ++p) s += ar[p] * aq[p];
+			cr[q] -= s;
+		}
+	}
+}
+
+// c -= a b^T with a mb x kb and b nb x kb. b is transposed into scratch so the micro-kernel reads it by rows
+template<typename N>
+void tile_gemm_nt(const N* a, const N* b, N* c, uint mb, uint nb, uint kb, uint ts) {
+	N* bt = tile_scratch<N>(ts);
+	for (uint q = 0; q < nb; ++q)
+		for (uint p = 0; p < kb; ++p) bt[static_cast<ul>(p) * ts + q] = b[static_cast<ul>(q) * ts + p];
+	gemm_rows<N, 4>(0, mb, nb, kb, N(-1), a, ts, bt, ts, c, ts);
+}
+
+// row r of the matrix within tile column tc
+template<typename N>
+inline N* tile_row(TiledMatrix<N>& A, uint r, uint tc) {
+	uint ts = A.tile_size();
+	return A.tile(r / ts, tc) + static_cast<ul>(r % ts) * ts;
+}
+
+// unblocked LU with partial pivoting of tile column k below the diagonal. swaps stay inside the column
+template<typename N>
+bool tile_getrf_panel(TiledMatrix<N>& A, uint k, std::vector<uint>& piv) {
+	uint n = A.rows(), ts = A.tile_size(), c0 = k * ts, w = tile_extent(A.cols(), ts, k);
+	for (uint j = 0; j < w; ++j) {
+		uint c = c0 + j, p = c;
+		double best = abs_value(tile_row(A, c, k)[j]);
+		for (uint r = c + 1; r < n; ++r) {
+			double v = abs_value(tile_row(A, r, k)[j]);
+			if (v > best) { best = v; p = r; }
+		}
+		piv[c] = p;
+		if (best == 0.0) return false;
+
+		N* u = tile_row(A, c, k);
+		if (p != c) std::swap_ranges(u, u + w, tile_row(A, p, k));
+		N d = u[j];
+		for (uint r = c + 1; r < n; ++r) {
+			N* row = tile_row(A, r, k);
+			N l = row[j] / d;
+			row[j] = l;
+			for (uint q = j + 1; q < w; ++q) row[q] -= l * u[q];
+		}
+	}
+	return true;
+}
+
+// applies the row swaps of step k to tile column j
+template<typename N>
+void tile_laswp(TiledMatrix<N>& A, uint k, uint j, const std::vector<uint>& piv) {
+	uint ts = A.tile_size(), c0 = k * ts, w = tile_extent(A.cols(), ts, k), nj = tile_extent(A.cols(), ts, j);
+	for (uint c = c0; c < c0 + w; ++c)
+		if (piv[c] != c) {
+			N* a = tile_row(A, c, j);
+			std::swap_ranges(a, a + nj, tile_row(A, piv[c], j));
+		}
+}
+
+// b = L^-1 b for the w x nb tile b and unit lower triangular l
+template<typename N>
+void tile_trsm_unit_lower(const N* l, N* b, uint w, uint nb, uint ts) {
+	for (uint r = 1; r < w; ++r) {
+		N* br = b + static_cast<ul>(r) * ts;
+		const N* lr = l + static_cast<ul>(r) * ts;
+		for (uint p = 0; p < r; ++p) {
+			N f = lr[p];
+			const N* bp = b + static_cast<ul>(p) * ts;
+			for (uint q = 0; q < nb; ++q) br[q] -= f * bp[q];
+		}
+	}
+}
+
+// turns (alpha, u) into (beta, 0) with a reflector: alpha becomes beta, u becomes v. returns tau
+template<typename N>
+N householder(N& alpha, N* u, ul us, uint mb) {
+	N sq = N();
+	for (uint r = 0; r < mb; ++r) sq += u[r * us] * u[r * us];
+	if (sq == N()) return N();
+
+	N norm = std::sqrt(alpha * alpha + sq);
+	N beta = (alpha > N()) ? -norm : norm;
+	N tau = (beta - alpha) / beta;
+	N scale = N(1) / (alpha - beta);
+	for (uint r = 0; r < mb; ++r) u[r * us] *= scale;
+	alpha = beta;
+	return tau;
+}
+
+/*
+	applies I - tau [1; v] [1; v]^T to the nb columns of the row x stacked on the
+	mb x nb block y, where v[r] = v[r * vs]. w is nb elements of scratch.
+*/
+template<typename N>
+void apply_reflector(N tau, const N* v, ul vs, uint mb, N* x, N* y, uint nb, uint ts, N* w) {
+	if (tau == N() || nb == 0) return;
+	for (uint c = 0; c < nb; ++c) w[c] = x[c];
+	for (uint r = 0; r < mb; ++r) {
+		N vr = v[r * vs];
+		const N* yr = y + static_cast<ul>(r) * ts;
+		for (uint c = 0; c < nb; ++c) w[c] += vr * yr[c];
+	}
+	for (uint c = 0; c < nb; ++c) {
+		w[c] *= tau;
+		x[c] -= w[c];
+	}
+	for (uint r = 0; r < mb; ++r) {
+		N vr = v[r * vs];
+		N* yr = y + static_cast<ul>(r) * ts;
+		for (uint c = 0; c < nb; ++c) yr[c] -= vr * w[c];
+	}
+}
+
+// QR of the mb x nb tile a: R on and above the diagonal, reflectors below it
+template<typename N>
+void tile_geqrt(N* a, N* tau, uint mb, uint nb, uint ts) {
+	N* w = tile_scratch<N>(ts);
+	for (uint j = 0; j < std::min(mb, nb); ++j) {
+		N* aj = a + static_cast<ul>(j) * ts;
+		N* below = aj + ts + j;
+		tau[j] = householder(aj[j], below, ts, mb - j - 1);
+		apply_reflector(tau[j], below, ts, mb - j - 1, aj + j + 1, below + 1, nb - j - 1, ts, w);
+	}
+}
+
+// b = Q^T b for the reflectors of the diagonal tile v and the mb x nb tile b
+template<typename N>
+void tile_unmqr(const N* v, const N* tau, N* b, uint mb, uint vb, uint nb, uint ts) {
+	N* w = tile_scratch<N>(ts);
+	for (uint j = 0; j < std::min(mb, vb); ++j) {
+		N* bj = b + static_cast<ul>(j) * ts;
+		apply_reflector(tau[j], v + static_cast<ul>(j + 1) * ts + j, ts, mb - j - 1, bj, bj + ts, nb, ts, w);
+	}
+}
+
+// QR of the nb x nb upper triangle r stacked on the mb x nb tile a. a is replaced by the reflectors
+template<typename N>
+void tile_tsqrt(N* r, N* a, N* tau, uint mb, uint nb, uint ts) {
+	N* w = tile_scratch<N>(ts);
+	for (uint j = 0; j < nb; ++j) {
+		N* rj = r + static_cast<ul>(j) * ts;
+		tau[j] = householder(rj[j], a + j, ts, mb);
+		apply_reflector(tau[j], a + j, ts, mb, rj + j + 1, a + j + 1, nb - j - 1, ts, w);
+	}
+}
+
+// applies the reflectors of tile_tsqrt, held in the mb x vb tile v, to b (vb rows used) stacked on the mb x nb tile c
+template<typename N>
+void tile_tsmqr(const N* v, const N* tau, N* b, N* c, uint mb, uint vb, uint nb, uint ts) {
+	N* w = tile_scratch<N>(ts);
+	for (uint j = 0; j < vb; ++j)
+		apply_reflector(tau[j], v + j, ts, mb, b + static_cast<ul>(j) * ts, c, nb, ts, w);
+}
+
+}	// detail
+
+
+template<typename N>
+bool tile_cholesky(TiledMatrix<N>& A) {
+	if (A.rows() != A.cols())
+		throw std::invalid_argument("Cholesky factorization needs a square matrix");
+
+	uint n = A.rows(), ts = A.tile_size(), nt = A.tile_rows();
+	double t3 = static_cast<double>(ts) * ts * ts;
+	TiledMatrix<N>* a = &A;
+	std::atomic<bool> failed (false);
+	std::atomic<bool>* fail = &failed;
+
+	TaskGraph g;
+	for (uint k = 0; k < nt; ++k) {
+		uint nk = detail::tile_extent(n, ts, k);
+		const void* kk = A.tile(k, k);
+		g.add("potrf", [=] {
+			if (!fail->load() && !detail::tile_potrf(a->tile(k, k), nk, ts)) fail->store(true);
+		}, t3 / 3, {}, {kk});
+
+		for (uint i = k + 1; i < nt; ++i) {
+			uint ni = detail::tile_extent(n, ts, i);
+			g.add("trsm", [=] {
+				if (!fail->load()) detail::tile_trsm_lower_t(a->tile(k, k), a->tile(i, k), ni, nk, ts);
+			}, t3, {kk}, {A.tile(i, k)});
+		}
+
+		for (uint i = k + 1; i < nt; ++i) {
+			uint ni = detail::tile_extent(n, ts, i);
+			g.add("syrk", [=] {
+				if (!fail->load()) detail::tile_syrk(a->tile(i, k), a->tile(i, i), ni, nk, ts);
+			}, t3, {A.tile(i, k)}, {A.tile(i, i)});
+			for (uint j = k + 1; j < i; ++j) {
+				uint nj = detail::tile_extent(n, ts, j);
+				g.add("gemm", [=] {
+					if (!fail->load()) detail::tile_gemm_nt(a->tile(i, k), a->tile(j, k), a->tile(i, j), ni, nj, nk, ts);
+				}, 2 * t3, {A.tile(i, k), A.tile(j, k)}, {A.tile(i, j)});
+			}
+		}
+	}
+	g.run();
+	return !failed.load();
+}
+
+template<typename N>
+bool tile_lu(TiledMatrix<N>& A, std::vector<uint>& piv) {
+	if (A.rows() != A.cols())
+		throw std::invalid_argument("LU factorization needs a square matrix");
+
+	uint n = A.rows(), ts = A.tile_size(), nt = A.tile_rows();
+	double t3 = static_cast<double>(ts) * ts * ts;
+	TiledMatrix<N>* a = &A;
+	std::vector<uint>* p = &piv;
+	std::atomic<bool> failed (false);
+	std::atomic<bool>* fail = &failed;
+	piv.assign(n, 0);
+
+	// every tile of a column from row tile k down, as the swaps of step k may touch any of them
+	auto column = [&A, nt](uint k, uint j) {
+		std::vector<const void*> keys;
+		for (uint i = k; i < nt; ++i) keys.push_back(A.tile(i, j));
+		return keys;
+	};
+
+	TaskGraph g;
+	for (uint k = 0; k < nt; ++k) {
+		uint nk = detail::tile_extent(n, ts, k);
+		g.add("getrf_panel", [=] {
+			if (!fail->load() && !detail::tile_getrf_panel(*a, k, *p)) fail->store(true);
+		}, t3 * (nt - k), {}, column(k, k));
+
+		for (uint j = 0; j < nt; ++j) {
+			if (j == k) continue;
+			if (j < k) {
+				g.add("laswp", [=] {
+					if (!fail->load()) detail::tile_laswp(*a, k, j, *p);
+				}, t3 / ts, {A.tile(k, k)}, column(k, j));
+				continue;
+			}
+			uint nj = detail::tile_extent(n, ts, j);
+			g.add("trsm", [=] {
+				if (fail->load()) return;
+				detail::tile_laswp(*a, k, j, *p);
+				detail::tile_trsm_unit_lower(a->tile(k, k), a->tile(k, j), nk, nj, ts);
+			}, t3, {A.tile(k, k)}, column(k, j));
+		}
+
+		for (uint i = k + 1; i < nt; ++i) {
+			uint ni = detail::tile_extent(n, ts, i);
+			for (uint j = k + 1; j < nt; ++j) {
+				uint nj = detail::tile_extent(n, ts, j);
+				g.add("gemm", [=] {
+					if (!fail->load()) detail::gemm_rows<N, 4>(0, ni, nj, nk, N(-1), a->tile(i, k), ts, a->tile(k, j), ts, a->tile(i, j), ts);
+				}, 2 * t3, {A.tile(i, k), A.tile(k, j)}, {A.tile(i, j)});
+			}
+		}
+	}
+	g.run();
+	return !failed.load();
+}
+
+template<typename N>
+void tile_qr(TiledMatrix<N>& A, std::vector<N>& tau) {
+	if (A.rows() < A.cols())
+		throw std::invalid_argument("QR factorization needs at least as many rows as columns");
+
+	uint m = A.rows(), n = A.cols(), ts = A.tile_size(), mt = A.tile_rows(), nt = A.tile_cols();
+	double t3 = static_cast<double>(ts) * ts * ts;
+	TiledMatrix<N>* a = &A;
+	tau.assign(static_cast<ul>(mt) * nt * ts, N());
+	N* t = tau.data();
+
+	/*
+		the reflectors below the diagonal of tile (k, k) and R above it are used by
+		different tasks, so the two triangles are tracked separately. a full write of
+		a diagonal tile writes both.
+	*/
+	auto writes = [&A](uint i, uint j) {
+		std::vector<const void*> keys (1, detail::tile_key(A.tile(i, j)));
+		if (i == j) keys.push_back(detail::tile_key(A.tile(i, j), true));
+		return keys;
+	};
+	auto tau_of = [=](uint i, uint k) { return t + (static_cast<ul>(i) * nt + k) * ts; };
+
+	TaskGraph g;
+	for (uint k = 0; k < nt; ++k) {
+		uint mk = detail::tile_extent(m, ts, k), nk = detail::tile_extent(n, ts, k);
+		const void* lower = detail::tile_key(A.tile(k, k));
+		const void* upper = detail::tile_key(A.tile(k, k), true);
+		N* tk = tau_of(k, k);
+
+		g.add("geqrt", [=] {
+			detail::tile_geqrt(a->tile(k, k), tk, mk, nk, ts);
+		}, 4 * t3 / 3, {}, {lower, upper, tk});
+
+		for (uint j = k + 1; j < nt; ++j) {
+			uint nj = detail::tile_extent(n, ts, j);
+			g.add("unmqr", [=] {
+				detail::tile_unmqr(a->tile(k, k), tk, a->tile(k, j), mk, nk, nj, ts);
+			}, 2 * t3, {lower, tk}, writes(k, j));
+		}
+
+		for (uint i = k + 1; i < mt; ++i) {
+			uint mi = detail::tile_extent(m, ts, i);
+			N* ti = tau_of(i, k);
+			std::vector<const void*> tw = writes(i, k);
+			tw.push_back(upper);
+			tw.push_back(ti);
+			g.add("tsqrt", [=] {
+				detail::tile_tsqrt(a->tile(k, k), a->tile(i, k), ti, mi, nk, ts);
+			}, 2 * t3, {}, tw);
+
+			for (uint j = k + 1; j < nt; ++j) {
+				uint nj = detail::tile_extent(n, ts, j);
+				std::vector<const void*> uw = writes(k, j), ci = writes(i, j);
+				uw.insert(uw.end(), ci.begin(), ci.end());
+				g.add("tsmqr", [=] {
+					detail::tile_tsmqr(a->tile(i, k), ti, a->tile(k, j), a->tile(i, j), mi, nk, nj, ts);
+				}, 4 * t3, {A.tile(i, k), ti}, uw);
+			}
+		}
+	}
+	g.run();
+}
+
+}	// math
+
+#endif
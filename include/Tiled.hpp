@@ -0,0 +1,457 @@
+/** @file Tiled.hpp
+	Contains a matrix stored as contiguous square tiles, laid out either in
+	row-major tile order or in Morton (Z) order, with conversions to and from
+	Matrix and tile-native gemm, transpose and element-wise operators.
+
+	Every tile is tile x tile elements, row-major inside the tile, and edge tiles
+	are padded with zeros. A tile is therefore one unit-stride block that spans a
+	few pages, so the blocked kernels never gather across the full row stride.
+	Morton order also keeps neighbouring tiles in both directions close in memory.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _TILED_H_
+#define _TILED_H_
+
+#include <vector>		// vector
+#include <algorithm>	// sort, copy, fill, min
+#include <utility>		// pair
+#include <stdexcept>	// invalid_argument
+#include <stdint.h>		// uint64_t
+#include "Matrix.hpp"	// Matrix
+#include "Gemm.hpp"		// detail::gemm_rows
+#include "Parallel.hpp"	// parallel_for
+#include "typedefs.h"	// uint, ul
+
+
+namespace math {
+
+
+/** @brief Order in which the tiles of a TiledMatrix are stored. */
+enum TileOrder {
+	TILE_ROW_MAJOR,		/**<tile rows one after another*/
+	TILE_MORTON			/**<Z-order: the bits of the tile row and column interleaved*/
+};
+
+
+/** @brief rows x cols matrix stored as contiguous tile x tile tiles.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class TiledMatrix {
+	public:
+		/** Creates a rows x cols tiled matrix with every element set to fill.
+			@param rows - number of rows
+			@param cols - number of columns
+			@param tile - tile edge length
+			@param order - order of the tiles in memory
+			@param fill - default value for every element
+			@throw invalid_argument if tile is 0
+		*/
+		TiledMatrix(uint rows, uint cols, uint tile, TileOrder order, const N& fill);
+
+		/** Converts a row-major matrix to tiled layout.
+			@param m - matrix to convert
+			@param tile - tile edge length
+			@param order - order of the tiles in memory
+			@throw invalid_argument if tile is 0
+		*/
+		TiledMatrix(const Matrix<N>& m, uint tile, TileOrder order);
+
+		/** Get element r, c.
+			@param r - row of return element
+			@param c - column of return element
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		N at(uint r, uint c) const;
+
+		/** Set element r, c.
+			@param r - row of element set
+			@param c - column of element set
+			@param val - value to set
+			@throw invalid_argument thrown if r>=rows() or c>=cols()
+		*/
+		void set(uint r, uint c, N val);
+
+		/** Unchecked access to element r, c. */
+		N& operator()(uint r, uint c) { return tile(r / _tile, c / _tile)[(r % _tile) * _tile + c % _tile]; }
+
+		/** Unchecked access to element r, c. */
+		const N& operator()(uint r, uint c) const { return tile(r / _tile, c / _tile)[(r % _tile) * _tile + c % _tile]; }
+
+		/** Get tile tr, tc: tile x tile elements, row-major. */
+		N* tile(uint tr, uint tc) { return _data.data() + _offset[static_cast<ul>(tr) * tile_cols() + tc]; }
+
+		/** Get tile tr, tc: tile x tile elements, row-major. */
+		const N* tile(uint tr, uint tc) const { return _data.data() + _offset[static_cast<ul>(tr) * tile_cols() + tc]; }
+
+		/** Get the number of rows. */
+		uint rows() const { return _rows; }
+
+		/** Get the number of columns. */
+		uint cols() const { return _cols; }
+
+		/** Get the tile edge length. */
+		uint tile_size() const { return _tile; }
+
+		/** Get the number of tile rows. */
+		uint tile_rows() const { return (_rows + _tile - 1) / _tile; }
+
+		/** Get the number of tile columns. */
+		uint tile_cols() const { return (_cols + _tile - 1) / _tile; }
+
+		/** Get the order of the tiles in memory. */
+		TileOrder order() const { return _order; }
+
+		/** Get the tiled buffer, tile_rows() * tile_cols() * tile^2 elements. */
+		N* data() { return _data.data(); }
+
+		/** Get the tiled buffer, tile_rows() * tile_cols() * tile^2 elements. */
+		const N* data() const { return _data.data(); }
+
+		/** Converts back to a row-major matrix.
+			@return a new rows x cols Matrix
+		*/
+		Matrix<N> dense() const;
+
+		/** Element-wise add in place. Both operands must share shape, tile size and order.
+			@param m - matrix to add
+			@throw invalid_argument if the layouts differ
+		*/
+		TiledMatrix& operator+=(const TiledMatrix& m);
+
+		/** Element-wise subtract in place. Both operands must share shape, tile size and order.
+			@param m - matrix to subtract
+			@throw invalid_argument if the layouts differ
+		*/
+		TiledMatrix& operator-=(const TiledMatrix& m);
+
+		/** Scales every element in place. The padding stays zero for any scale.
+			@param scal - scale
+		*/
+		TiledMatrix& operator*=(const N& scal);
+
+	private:
+		void layout();
+		bool same_layout(const TiledMatrix& m) const;
+
+		uint _rows;					/**<number of rows*/
+		uint _cols;					/**<number of columns*/
+		uint _tile;					/**<tile edge length*/
+		TileOrder _order;			/**<order of the tiles*/
+		std::vector<ul> _offset;	/**<start of every tile, indexed tr * tile_cols() + tc*/
+		std::vector<N> _data;		/**<tiles, zero padded at the edges*/
+};
+
+
+/**	Computes `C = alpha * A * B + beta * C` on tiled operands with the same tile
+	size. Output tiles are split across threads and every tile product runs the
+	gemm micro-kernel with a leading dimension of tile.
+	@param alpha - scale applied to `A * B`
+	@param A - m x k tiled matrix
+	@param B - k x n tiled matrix
+	@param beta - scale applied to C first. When zero C is not read.
+	@param C - m x n tiled matrix updated in place
+	@throw invalid_argument if the shapes or tile sizes do not agree
+*/
+template<typename N>
+void tiled_gemm(const N& alpha, const TiledMatrix<N>& A, const TiledMatrix<N>& B, const N& beta, TiledMatrix<N>& C);
+
+/**	Transposes a tiled matrix: tile (i, j) is transposed in cache into tile (j, i).
+	@param m - tiled matrix
+	@return a new cols x rows tiled matrix with the same tile size and order
+*/
+template<typename N>
+TiledMatrix<N> transpose(const TiledMatrix<N>& m);
+
+/**	Tiled matrix product. The result uses the tile order of lhs.
+	@param lhs - m x k tiled matrix
+	@param rhs - k x n tiled matrix
+	@return a new m x n tiled matrix
+	@throw invalid_argument if the shapes or tile sizes do not agree
+*/
+template<typename N>
+TiledMatrix<N> operator*(const TiledMatrix<N>& lhs, const TiledMatrix<N>& rhs);
+
+/** Element-wise sum of two tiled matrices with the same layout. */
+template<typename N>
+TiledMatrix<N> operator+(TiledMatrix<N> lhs, const TiledMatrix<N>& rhs);
+
+/** Element-wise difference of two tiled matrices with the same layout. */
+template<typename N>
+TiledMatrix<N> operator-(TiledMatrix<N> lhs, const TiledMatrix<N>& rhs);
+
+
+/** double precision tiled matrix */
+typedef TiledMatrix<double> dTiledMatrix;
+/** single precision tiled matrix */
+typedef TiledMatrix<float> fTiledMatrix;
+
+
+
+// implementation
+
+namespace detail {
+
+// interleaves the bits of r and c, r taking the odd positions
+inline uint64_t morton_key(uint r, uint c) {
+	uint64_t key = 0;
+	for (uint b = 0; b < 32; ++b) {
+		key |= static_cast<uint64_t>((c >> b) & 1u) << (2 * b);
+		key |= static_cast<uint64_t>((r >> b) & 1u) << (2 * b + 1);
+	}
+	return key;
+}
+
+// zeros the part of a tile outside the matrix, where the first r1 x c1 elements are inside
+template<typename N>
+void zero_padding(N* t, uint r1, uint c1, uint tile) {
+	if (r1 == tile && c1 == tile) return;
+	for (uint r = 0; r < tile; ++r) {
+		N* row = t + static_cast<ul>(r) * tile;
+		std::fill(row + (r < r1 ? c1 : 0), row + tile, N());
+	}
+}
+
+// grain in tiles so one task covers about threshold() elements
+inline ul tile_grain(uint tile) {
+	ul g = parallel::threshold() / (static_cast<ul>(tile) * tile);
+	return g ? g : 1;
+}
+
+// grain in rows of tiles, each tile x cols elements, for dense conversions
+inline ul tile_row_grain(uint tile, uint cols) {
+	ul g = cols ? parallel::threshold() / (static_cast<ul>(tile) * cols) : 1;
+	return g ? g : 1;
+}
+
+}	// detail
+
+
+template<typename N>
+void TiledMatrix<N>::layout() {
+	uint tr = tile_rows(), tc = tile_cols();
+	ul tiles = static_cast<ul>(tr) * tc, tt = static_cast<ul>(_tile) * _tile;
+	_offset.resize(tiles);
+
+	std::vector<std::pair<uint64_t, ul> > rank (tiles);
+	for (uint i = 0; i < tr; ++i)
+		for (uint j = 0; j < tc; ++j) {
+			ul t = static_cast<ul>(i) * tc + j;
+			rank[t] = std::make_pair(_order == TILE_MORTON ? detail::morton_key(i, j) : t, t);
+		}
+	std::sort(rank.begin(), rank.end());
+	for (ul k = 0; k < tiles; ++k) _offset[rank[k].second] = k * tt;
+}
+
+template<typename N>
+TiledMatrix<N>::TiledMatrix(uint rows, uint cols, uint tile, TileOrder order, const N& fill)
+	: _rows(rows), _cols(cols), _tile(tile), _order(order) {
+	if (tile == 0)
+		throw std::invalid_argument("tile size must be positive");
+
+	layout();
+	_data.assign(_offset.size() * tile * tile, N());
+	for (uint i = 0; i < tile_rows(); ++i)
+		for (uint j = 0; j < tile_cols(); ++j) {
+			N* t = this->tile(i, j);
+			uint r1 = std::min(tile, rows - i * tile), c1 = std::min(tile, cols - j * tile);
+			for (uint r = 0; r < r1; ++r) std::fill(t + static_cast<ul>(r) * tile, t + static_cast<ul>(r) * tile + c1, fill);
+		}
+}
+
+template<typename N>
+TiledMatrix<N>::TiledMatrix(const Matrix<N>& m, uint tile, TileOrder order)
+	: _rows(m.rows()), _cols(m.cols()), _tile(tile), _order(order) {
+	if (tile == 0)
+		throw std::invalid_argument("tile size must be positive");
+
+	layout();
+	_data.assign(_offset.size() * tile * tile, N());
+
+	uint rows = _rows, cols = _cols, tc = tile_cols();
+	const N* src = m.data();
+	TiledMatrix* self = this;
+	parallel::parallel_for(0, tile_rows(), [=](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) {
+			uint r1 = std::min(static_cast<ul>(tile), rows - i * tile);
+			for (uint j = 0; j < tc; ++j) {
+				N* t = self->tile(static_cast<uint>(i), j);
+				uint c1 = std::min(tile, cols - j * tile);
+				for (uint r = 0; r < r1; ++r) {
+					const N* row = src + (i * tile + r) * cols + static_cast<ul>(j) * tile;
+					std::copy(row, row + c1, t + static_cast<ul>(r) * tile);
+				}
+			}
+		}
+	}, detail::tile_row_grain(tile, cols));
+}
+
+template<typename N>
+N TiledMatrix<N>::at(uint r, uint c) const {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	return (*this)(r, c);
+}
+
+template<typename N>
+void TiledMatrix<N>::set(uint r, uint c, N val) {
+	if (r >= _rows)
+		throw std::invalid_argument("row out of range");
+	if (c >= _cols)
+		throw std::invalid_argument("column out of range");
+
+	(*this)(r, c) = val;
+}
+
+template<typename N>
+Matrix<N> TiledMatrix<N>::dense() const {
+	Matrix<N> m (_rows, _cols, N());
+	uint rows = _rows, cols = _cols, tile = _tile, tc = tile_cols();
+	N* dst = m.data();
+	const TiledMatrix* self = this;
+	parallel::parallel_for(0, tile_rows(), [=](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) {
+			uint r1 = std::min(static_cast<ul>(tile), rows - i * tile);
+			for (uint j = 0; j < tc; ++j) {
+				const N* t = self->tile(static_cast<uint>(i), j);
+				uint c1 = std::min(tile, cols - j * tile);
+				for (uint r = 0; r < r1; ++r)
+					std::copy(t + static_cast<ul>(r) * tile, t + static_cast<ul>(r) * tile + c1,
+						dst + (i * tile + r) * cols + static_cast<ul>(j) * tile);
+			}
+		}
+	}, detail::tile_row_grain(tile, cols));
+	return m;
+}
+
+template<typename N>
+bool TiledMatrix<N>::same_layout(const TiledMatrix& m) const {
+	return _rows == m._rows && _cols == m._cols && _tile == m._tile && _order == m._order;
+}
+
+template<typename N>
+TiledMatrix<N>& TiledMatrix<N>::operator+=(const TiledMatrix& m) {
+	if (!same_layout(m))
+		throw std::invalid_argument("tiled matrices must share shape, tile size and order");
+
+	// the padding is zero in both, so the whole buffer can be added at once
+	N* a = _data.data();
+	const N* b = m._data.data();
+	parallel::parallel_for(0, _data.size(), [=](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) a[i] += b[i];
+	}, parallel::threshold());
+	return *this;
+}
+
+template<typename N>
+TiledMatrix<N>& TiledMatrix<N>::operator-=(const TiledMatrix& m) {
+	if (!same_layout(m))
+		throw std::invalid_argument("tiled matrices must share shape, tile size and order");
+
+	N* a = _data.data();
+	const N* b = m._data.data();
+	parallel::parallel_for(0, _data.size(), [=](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) a[i] -= b[i];
+	}, parallel::threshold());
+	return *this;
+}
+
+template<typename N>
+TiledMatrix<N>& TiledMatrix<N>::operator*=(const N& scal) {
+	// tiled_gemm relies on zero padding, which a non-finite scale would turn into NaN
+	uint rows = _rows, cols = _cols, tile = _tile, tc = tile_cols();
+	ul tt = static_cast<ul>(tile) * tile;
+	N s = scal;
+	TiledMatrix* self = this;
+	parallel::parallel_for(0, static_cast<ul>(tile_rows()) * tc, [=](ul lo, ul hi) {
+		for (ul k = lo; k < hi; ++k) {
+			uint i = static_cast<uint>(k / tc), j = static_cast<uint>(k % tc);
+			N* t = self->tile(i, j);
+			for (ul e = 0; e < tt; ++e) t[e] *= s;
+			detail::zero_padding(t, std::min(tile, rows - i * tile), std::min(tile, cols - j * tile), tile);
+		}
+	}, detail::tile_grain(tile));
+	return *this;
+}
+
+
+template<typename N>
+void tiled_gemm(const N& alpha, const TiledMatrix<N>& A, const TiledMatrix<N>& B, const N& beta, TiledMatrix<N>& C) {
+	if (A.cols() != B.rows() || C.rows() != A.rows() || C.cols() != B.cols())
+		throw std::invalid_argument("Matrix Multiplication is undefined if m.rows() must equal cols().");
+	if (A.tile_size() != B.tile_size() || A.tile_size() != C.tile_size())
+		throw std::invalid_argument("tiled matrices must share a tile size");
+
+	uint ts = A.tile_size(), tn = C.tile_cols(), tk = A.tile_cols();
+	uint rows = C.rows(), cols = C.cols();
+	ul tt = static_cast<ul>(ts) * ts;
+	const TiledMatrix<N>* ap = &A;
+	const TiledMatrix<N>* bp = &B;
+	TiledMatrix<N>* cp = &C;
+	N al = alpha, be = beta;
+
+	// one task per output tile; every operand tile is read with unit stride
+	ul work = static_cast<ul>(tk) * tt * ts;
+	ul grain = work ? parallel::threshold() * 8 / work : 1;
+	parallel::parallel_for(0, static_cast<ul>(C.tile_rows()) * tn, [=](ul lo, ul hi) {
+		for (ul t = lo; t < hi; ++t) {
+			uint i = static_cast<uint>(t / tn), j = static_cast<uint>(t % tn);
+			N* c = cp->tile(i, j);
+			if (be == N()) std::fill(c, c + tt, N());
+			else if (be != N(1)) for (ul e = 0; e < tt; ++e) c[e] *= be;
+
+			for (uint p = 0; p < tk; ++p)
+				detail::gemm_rows<N, 4>(0, ts, ts, ts, al, ap->tile(i, p), ts, bp->tile(p, j), ts, c, ts);
+			// non-finite entries of A or B, or beta, leave NaN in the padding of edge tiles
+			detail::zero_padding(c, std::min(ts, rows - i * ts), std::min(ts, cols - j * ts), ts);
+		}
+	}, grain ? grain : 1);
+}
+
+template<typename N>
+TiledMatrix<N> transpose(const TiledMatrix<N>& m) {
+	TiledMatrix<N> t (m.cols(), m.rows(), m.tile_size(), m.order(), N());
+	uint ts = m.tile_size(), tn = m.tile_cols();
+	const TiledMatrix<N>* src = &m;
+	TiledMatrix<N>* dst = &t;
+	parallel::parallel_for(0, static_cast<ul>(m.tile_rows()) * tn, [=](ul lo, ul hi) {
+		for (ul k = lo; k < hi; ++k) {
+			uint i = static_cast<uint>(k / tn), j = static_cast<uint>(k % tn);
+			const N* a = src->tile(i, j);
+			N* b = dst->tile(j, i);
+			for (uint r = 0; r < ts; ++r)
+				for (uint c = 0; c < ts; ++c) b[static_cast<ul>(c) * ts + r] = a[static_cast<ul>(r) * ts + c];
+		}
+	}, detail::tile_grain(ts));
+	return t;
+}
+
+template<typename N>
+TiledMatrix<N> operator*(const TiledMatrix<N>& lhs, const TiledMatrix<N>& rhs) {
+	TiledMatrix<N> result (lhs.rows(), rhs.cols(), lhs.tile_size(), lhs.order(), N());
+	tiled_gemm(N(1), lhs, rhs, N(), result);
+	return result;
+}
+
+template<typename N>
+TiledMatrix<N> operator+(TiledMatrix<N> lhs, const TiledMatrix<N>& rhs) {
+	lhs += rhs;
+	return lhs;
+}
+
+template<typename N>
+TiledMatrix<N> operator-(TiledMatrix<N> lhs, const TiledMatrix<N>& rhs) {
+	lhs -= rhs;
+	return lhs;
+}
+
+}	// math
+
+#endif
@@ -0,0 +1,211 @@
+/** @file Trace.hpp
+	Contains the tracing spans recorded around Matrix operations and thread pool
+	work, and their export to Chrome trace-event JSON (chrome://tracing, Perfetto).
+
+	Spans are only placed in library code when `GPML_TRACE` is defined before the
+	first GPML header is included; otherwise `GPML_TRACE_SPAN` expands to nothing.
+	Each thread records finished spans into its own ring of `GPML_TRACE_EVENTS`
+	entries (4096 unless defined) without taking a lock, so only the most recent
+	spans of each thread are kept. `dump` writes every ring, and if the
+	`GPML_TRACE_FILE` environment variable is set the trace is written there at
+	exit. A dump taken while other threads are still recording may show torn
+	copies of their oldest spans.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _TRACE_H_
+#define _TRACE_H_
+
+#include <atomic>		// atomic
+#include <mutex>		// mutex, lock_guard
+#include <vector>		// vector
+#include <memory>		// shared_ptr, make_shared
+#include <string>		// string
+#include <fstream>		// ofstream
+#include <ostream>		// ostream
+#include <chrono>		// steady_clock
+#include <cstdio>		// snprintf
+#include <cstdlib>		// getenv
+#include "typedefs.h"	// uint, ul, ull
+
+#ifndef GPML_TRACE_EVENTS
+#define GPML_TRACE_EVENTS 4096
+#endif
+
+#ifdef GPML_TRACE
+#define GPML_TRACE_JOIN2(a, b) a##b
+#define GPML_TRACE_JOIN(a, b) GPML_TRACE_JOIN2(a, b)
+/** Records a span named by the first argument, with up to three sizes, from here to the end of the scope. */
+#define GPML_TRACE_SPAN(...) ::math::trace::Span GPML_TRACE_JOIN(_gpml_span_, __LINE__) (__VA_ARGS__)
+#else
+#define GPML_TRACE_SPAN(...)
+#endif
+
+
+namespace math {
+namespace trace {
+
+/** @brief One finished span.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+struct Event {
+	const char* name;	/**<static string naming the operation*/
+	ull start;			/**<nanoseconds since tracing started*/
+	ull duration;		/**<nanoseconds the span lasted*/
+	ul m;				/**<first size, usually rows*/
+	ul n;				/**<second size, usually columns*/
+	ul k;				/**<third size, usually the inner dimension of a product*/
+};
+
+
+/** @brief Times the enclosing scope and records it to the calling thread's ring
+	when destroyed. Usually created through `GPML_TRACE_SPAN`.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+class Span {
+	public:
+		/** Starts a span.
+			@param name - static string naming the operation
+			@param m - first size to record, 0 if unused
+			@param n - second size to record, 0 if unused
+			@param k - third size to record, 0 if unused
+		*/
+		explicit Span(const char* name, ul m = 0, ul n = 0, ul k = 0);
+
+		/** Destructor. Records the span. */
+		~Span();
+
+	private:
+		Span(const Span&);
+		Span& operator=(const Span&);
+
+		Event _event;	/**<span being timed*/
+};
+
+/** Writes every thread's recorded spans as a Chrome trace-event JSON object.
+	@param out - stream to write to
+*/
+inline void dump(std::ostream& out);
+
+/** Writes every thread's recorded spans to a Chrome trace-event JSON file.
+	@param path - file to write, replaced if it exists
+	@return false if the file cannot be written
+*/
+inline bool dump(const std::string& path);
+
+
+
+// implementation
+
+namespace detail {
+
+// one thread's ring. only the owning thread writes; head counts every span ever recorded.
+struct Ring {
+	Event events[GPML_TRACE_EVENTS];
+	std::atomic<ull> head;
+	uint tid;
+
+	explicit Ring(uint id) : head(0), tid(id) {}
+};
+
+// every ring ever created, kept until exit so spans of finished threads can still be dumped
+struct Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Ring> > rings;
+	std::chrono::steady_clock::time_point epoch;
+
+	Registry() : epoch(std::chrono::steady_clock::now()) {}
+
+	std::shared_ptr<Ring> add() {
+		std::lock_guard<std::mutex> lock (mutex);
+		rings.push_back(std::make_shared<Ring>(static_cast<uint>(rings.size())));
+		return rings.back();
+	}
+
+	~Registry() {
+		const char* path = std::getenv("GPML_TRACE_FILE");
+		if (!path) return;
+		std::ofstream out (path);
+		if (out) write(out);
+	}
+
+	void write(std::ostream& out) {
+		std::vector<std::shared_ptr<Ring> > all;
+		{
+			std::lock_guard<std::mutex> lock (mutex);
+			all = rings;
+		}
+
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		char buf[128];
+		for (ul r = 0; r < all.size(); ++r) {
+			const Ring& ring = *all[r];
+			ull head = ring.head.load(std::memory_order_acquire);
+			ull begin = (head > GPML_TRACE_EVENTS) ? head - GPML_TRACE_EVENTS : 0;
+			for (ull i = begin; i < head; ++i) {
+				const Event& e = ring.events[i % GPML_TRACE_EVENTS];
+				std::snprintf(buf, sizeof(buf), "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u",
+							e.start / 1e3, e.duration / 1e3, ring.tid);
+				out << (first ? "\n" : ",\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\"," << buf
+					<< ",\"args\":{\"m\":" << e.m << ",\"n\":" << e.n << ",\"k\":" << e.k << "}}";
+				first = false;
+			}
+		}
+		out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+	}
+};
+
+inline Registry& registry() {
+	static Registry r;
+	return r;
+}
+
+inline Ring& local() {
+	thread_local std::shared_ptr<Ring> ring = registry().add();
+	return *ring;
+}
+
+inline ull now() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+}	// detail
+
+
+inline Span::Span(const char* name, ul m, ul n, ul k) {
+	_event.name = name;
+	_event.m = m;
+	_event.n = n;
+	_event.k = k;
+	_event.start = detail::now();
+}
+
+inline Span::~Span() {
+	_event.duration = detail::now() - _event.start;
+	detail::Ring& ring = detail::local();
+	ull h = ring.head.load(std::memory_order_relaxed);
+	ring.events[h % GPML_TRACE_EVENTS] = _event;
+	ring.head.store(h + 1, std::memory_order_release);
+}
+
+inline void dump(std::ostream& out) {
+	detail::registry().write(out);
+}
+
+inline bool dump(const std::string& path) {
+	std::ofstream out (path.c_str());
+	if (!out) return false;
+	dump(out);
+	return static_cast<bool>(out);
+}
+
+}	// trace
+}	// math
+
+#endif
@@ -0,0 +1,422 @@
+/** @file Vector.hpp
+	Contains Vector class definition and implementation along with the
+	level-1 kernels dot, axpy, scal and nrm2.
+	@author Daniel Nichols
+	@date October 2026
+*/
+
+#ifndef _VECTOR_H_
+#define _VECTOR_H_
+
+#include <stdexcept>	// invalid_argument
+#include <vector>		// vector
+#include <algorithm>	// fill, copy
+#include <cmath>		// sqrt, fabs
+#include <limits>		// numeric_limits
+#include "typedefs.h"	// uint, ul
+#include "Parallel.hpp"	// parallel_for, parallel_reduce
+
+
+namespace math {
+
+
+/** @brief Dense vector stored in one contiguous buffer.
+
+	@author Daniel Nichols
+	@date October 2026
+*/
+template<typename N>
+class Vector {
+	public:
+		// constructors
+		/** Creates a vector of `size` elements all set to `fill`.
+			@param size - number of elements
+			@param fill - default value for every entry
+		*/
+		Vector(uint size, const N& fill);
+
+		/** Creates a vector holding a copy of `data`.
+			@param data - values to copy
+		*/
+		Vector(const std::vector<N>& data);
+
+		/** Copy constructor. Copies vector v into new vector.
+			@param v - vector to be copied
+		*/
+		Vector(const Vector& v);
+
+
+		// member functions
+		/** Get element i of the vector 0-indexed.
+			@param i - index of return element
+			@throw invalid_argument thrown if i>=size()
+		*/
+		N at(uint i) const;
+
+		/** Set element i of the vector 0-indexed.
+			@param i - index of element set
+			@param val - value to set element i
+			@throw invalid_argument thrown if i>=size()
+		*/
+		void set(uint i, N val);
+
+		/** Unchecked access to element i.
+			@param i - index of element
+			@return reference to element i
+		*/
+		N& operator[](uint i) { return _data[i]; }
+
+		/** Unchecked access to element i.
+			@param i - index of element
+			@return const reference to element i
+		*/
+		const N& operator[](uint i) const { return _data[i]; }
+
+		/** Get the number of elements in the vector.
+			@return the number of elements
+		*/
+		uint size() const { return _size; }
+
+		/** Get the contiguous buffer backing the vector.
+			@return pointer to the first element
+		*/
+		N* data() { return _data; }
+
+		/** Get the contiguous buffer backing the vector.
+			@return const pointer to the first element
+		*/
+		const N* data() const { return _data; }
+
+
+		// overloaded operators
+
+		/** Copies `v` into `this`. Ignores self-copy.
+			@param v - vector to copy into `this`
+			@return reference to `this` after copy
+		*/
+		Vector& operator=(const Vector& v);
+
+		/**	Adds vector `v` to `this` element-wise
+			@param v - vector to add to `this`
+			@return reference to `this` after addition
+			@throw invalid_argument thrown if `size()!=v.size()`
+		*/
+		Vector& operator+=(const Vector& v);
+
+		/**	Subtracts vector `v` from `this` element-wise
+			@param v - vector to subtract from `this`
+			@return reference to `this` after subtraction
+			@throw invalid_argument thrown if `size()!=v.size()`
+		*/
+		Vector& operator-=(const Vector& v);
+
+		/**	Multiplies `this` by scalar `scal`
+			@param scal - scalar to multiply `this` by
+			@return reference to `this` after multiplication
+		*/
+		Vector& operator*=(const N& scal);
+
+		/**	Divides `this` by scalar `scal` element-wise.
+			@param scal - scalar to divide `this` by
+			@return reference to `this` after division
+		*/
+		Vector& operator/=(const N& scal);
+
+
+		// destructor
+		/** Destructor. Deletes the vector internally */
+		~Vector();
+
+	private:
+		uint _size;		/**<number of elements*/
+		N* _data;		/**<contiguous array storing the elements*/
+};
+
+
+// free standing operator declarations
+/**	Adds lhs and rhs vectors element-wise.
+	@param lhs - left hand side vector of addition
+	@param rhs - right hand side vector of addition
+	@return a new vector `lhs + rhs`
+	@throw invalid_argument if `lhs` and `rhs` do not have the same size
+*/
+template<typename N>
+Vector<N> operator+(Vector<N> lhs, const Vector<N>& rhs);
+
+/**	Subtracts rhs from lhs element-wise.
+	@param lhs - left hand side vector of subtraction
+	@param rhs - right hand side vector of subtraction
+	@return a new vector `lhs - rhs`
+	@throw invalid_argument if `lhs` and `rhs` do not have the same size
+*/
+template<typename N>
+Vector<N> operator-(Vector<N> lhs, const Vector<N>& rhs);
+
+/**	Multiplies vector lhs by scalar rhs.
+	@param lhs - left hand side vector
+	@param rhs - right hand side scalar
+	@return a new vector `lhs * rhs`
+*/
+template<typename N>
+Vector<N> operator*(Vector<N> lhs, const N& rhs);
+
+/**	Multiplies scalar lhs by vector rhs.
+	@param lhs - left hand side scalar
+	@param rhs - right hand side vector
+	@return a new vector `lhs * rhs`
+*/
+template<typename N>
+Vector<N> operator*(const N& lhs, Vector<N> rhs);
+
+
+// level-1 kernels
+/**	Inner product of `x` and `y`.
+	@param x - first vector
+	@param y - second vector
+	@return sum of `x[i] * y[i]`
+	@throw invalid_argument if `x` and `y` do not have the same size
+*/
+template<typename N>
+N dot(const Vector<N>& x, const Vector<N>& y);
+
+/**	Computes `y = alpha * x + y` in place.
+	@param alpha - scale applied to `x`
+	@param x - vector to add
+	@param y - vector updated in place
+	@throw invalid_argument if `x` and `y` do not have the same size
+*/
+template<typename N>
+void axpy(const N& alpha, const Vector<N>& x, Vector<N>& y);
+
+/**	Computes `x = alpha * x` in place.
+	@param alpha - scale
+	@param x - vector updated in place
+*/
+template<typename N>
+void scal(const N& alpha, Vector<N>& x);
+
+/**	Euclidean norm of `x`. The sum of squares is rescaled by the largest
+	magnitude if it overflows or underflows, as in the reference BLAS.
+	@param x - vector
+	@return sqrt of the sum of `x[i]^2`
+*/
+template<typename N>
+N nrm2(const Vector<N>& x);
+
+
+// define standard Vector classes for easier use
+/** integer vector */
+typedef Vector<int> iVector;
+/** float precision vector */
+typedef Vector<float> fVector;
+/** double precision vector */
+typedef Vector<double> dVector;
+
+
+
+// implementation
+
+
+namespace detail {
+
+/*
+	dot product of two contiguous arrays. eight independent accumulators let the
+	compiler vectorize the loop without reassociating a single running sum.
+*/
+template<typename N>
+inline N dot_kernel(const N* x, const N* y, ul n) {
+	N acc[8] = { N(), N(), N(), N(), N(), N(), N(), N() };
+	ul i = 0;
+	for (; i + 8 <= n; i += 8)
+		for (uint j = 0; j < 8; ++j) acc[j] += x[i + j] * y[i + j];
+
+	N sum = ((acc[0] + acc[1]) + (acc[2] + acc[3])) + ((acc[4] + acc[5]) + (acc[6] + acc[7]));
+	for (; i < n; ++i) sum += x[i] * y[i];
+	return sum;
+}
+
+/*
+	y += alpha * x over contiguous arrays
+*/
+template<typename N>
+inline void axpy_kernel(N alpha, const N* x, N* y, ul n) {
+	for (ul i = 0; i < n; ++i) y[i] += alpha * x[i];
+}
+
+}	// detail
+
+
+template<typename N>
+Vector<N>::Vector(uint size, const N& fill) : _size(size) {
+	_data = new N[_size];
+	std::fill(_data, _data + _size, fill);
+}
+
+template<typename N>
+Vector<N>::Vector(const std::vector<N>& data) : _size(static_cast<uint>(data.size())) {
+	_data = new N[_size];
+	std::copy(data.begin(), data.end(), _data);
+}
+
+template<typename N>
+Vector<N>::Vector(const Vector& v) : _size(v._size) {
+	_data = new N[_size];
+	std::copy(v._data, v._data + _size, _data);
+}
+
+template<typename N>
+N Vector<N>::at(uint i) const {
+	if (i >= _size)
+		throw std::invalid_argument("index out of range");
+	return _data[i];
+}
+
+template<typename N>
+void Vector<N>::set(uint i, N val) {
+	if (i >= _size)
+		throw std::invalid_argument("index out of range");
+	_data[i] = val;
+}
+
+template<typename N>
+Vector<N>& Vector<N>::operator=(const Vector& v) {
+	if (this != &v) {	// ignore self-assignment
+		if (_size != v._size) {
+			delete[] _data;
+			_data = new N[v._size];
+			_size = v._size;
+		}
+		std::copy(v._data, v._data + _size, _data);
+	}
+	return *this;
+}
+
+template<typename N>
+Vector<N>& Vector<N>::operator+=(const Vector& v) {
+	if (v._size != _size)
+		throw std::invalid_argument("vectors must have same size");
+
+	axpy(N(1), v, *this);
+	return *this;
+}
+
+template<typename N>
+Vector<N>& Vector<N>::operator-=(const Vector& v) {
+	if (v._size != _size)
+		throw std::invalid_argument("vectors must have same size");
+
+	axpy(N(-1), v, *this);
+	return *this;
+}
+
+template<typename N>
+Vector<N>& Vector<N>::operator*=(const N& scal) {
+	math::scal(scal, *this);
+	return *this;
+}
+
+template<typename N>
+Vector<N>& Vector<N>::operator/=(const N& scal) {
+	N* a = _data;
+	N s = scal;
+	parallel::parallel_for(0, _size, [a, s](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) a[i] /= s;
+	});
+	return *this;
+}
+
+template<typename N>
+Vector<N> operator+(Vector<N> lhs, const Vector<N>& rhs) {
+	lhs += rhs;
+	return lhs;
+}
+
+template<typename N>
+Vector<N> operator-(Vector<N> lhs, const Vector<N>& rhs) {
+	lhs -= rhs;
+	return lhs;
+}
+
+template<typename N>
+Vector<N> operator*(Vector<N> lhs, const N& rhs) {
+	lhs *= rhs;
+	return lhs;
+}
+
+template<typename N>
+Vector<N> operator*(const N& lhs, Vector<N> rhs) {
+	rhs *= lhs;
+	return rhs;
+}
+
+template<typename N>
+Vector<N>::~Vector() {
+	delete[] _data;
+}
+
+
+template<typename N>
+N dot(const Vector<N>& x, const Vector<N>& y) {
+	if (x.size() != y.size())
+		throw std::invalid_argument("vectors must have same size");
+
+	const N* a = x.data();
+	const N* b = y.data();
+	return parallel::parallel_reduce(0, x.size(), N(),
+		[a, b](ul lo, ul hi) { return detail::dot_kernel(a + lo, b + lo, hi - lo); },
+		[](N s, N t) { return s + t; });
+}
+
+template<typename N>
+void axpy(const N& alpha, const Vector<N>& x, Vector<N>& y) {
+	if (x.size() != y.size())
+		throw std::invalid_argument("vectors must have same size");
+
+	const N* a = x.data();
+	N* b = y.data();
+	N s = alpha;
+	parallel::parallel_for(0, x.size(), [a, b, s](ul lo, ul hi) {
+		detail::axpy_kernel(s, a + lo, b + lo, hi - lo);
+	});
+}
+
+template<typename N>
+void scal(const N& alpha, Vector<N>& x) {
+	N* a = x.data();
+	N s = alpha;
+	parallel::parallel_for(0, x.size(), [a, s](ul lo, ul hi) {
+		for (ul i = lo; i < hi; ++i) a[i] *= s;
+	});
+}
+
+template<typename N>
+N nrm2(const Vector<N>& x) {
+	const N* a = x.data();
+	N sum = dot(x, x);
+	if (sum != N() && sum * N(0) == N(0) && sum >= std::numeric_limits<N>::min())
+		return static_cast<N>(std::sqrt(sum));
+
+	// overflowed, underflowed or hit a non-finite value: rescale by the largest magnitude
+	N mx = parallel::parallel_reduce(0, x.size(), N(),
+		[a](ul lo, ul hi) {
+			N m = N();
+			for (ul i = lo; i < hi; ++i) m = std::fabs(a[i]) > m ? static_cast<N>(std::fabs(a[i])) : m;
+			return m;
+		},
+		[](N s, N t) { return s > t ? s : t; });
+	if (mx == N() || mx * N(0) != N(0)) return mx;
+
+	N scale = N(1) / mx;
+	N scaled = parallel::parallel_reduce(0, x.size(), N(),
+		[a, scale](ul lo, ul hi) {
+			N s = N();
+			for (ul i = lo; i < hi; ++i) s += (a[i] * scale) * (a[i] * scale);
+			return s;
+		},
+		[](N s, N t) { return s + t; });
+	return static_cast<N>(mx * std::sqrt(scaled));
+}
+
+}	// math
+
+#endif
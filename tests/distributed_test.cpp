@@ -0,0 +1,159 @@
+#include <iostream>
+#include <cmath>
+#include "Matrix.hpp"
+#include "Distributed.hpp"
+
+void check(bool, const char*);
+
+void test_layout();
+void test_summa();
+void test_remap();
+void test_reductions();
+
+int failures = 0;
+int rank = 0;
+
+int main(int argc, char** argv) {
+	MPI_Init(&argc, &argv);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	test_layout();
+	test_summa();
+	test_remap();
+	test_reductions();
+
+	int total = 0;
+	MPI_Allreduce(&failures, &total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+	if (rank == 0) std::cout << std::endl;
+	MPI_Finalize();
+	return total ? 1 : 0;
+}
+
+
+void check(bool cond, const char* what) {
+	if (!cond) {
+		std::cout << "FAILED (rank " << rank << "): " << what << "\n";
+		++failures;
+	}
+}
+
+void say(const char* what) {
+	if (rank == 0) std::cout << what;
+}
+
+void fill_pattern(math::dMatrix& m, math::uint seed) {
+	for (math::uint r = 0; r < m.rows(); ++r)
+		for (math::uint c = 0; c < m.cols(); ++c)
+			m(r, c) = static_cast<double>((r * 7 + c * 13 + seed) % 9) - 4.0;
+}
+
+bool same(const math::dMatrix& a, const math::dMatrix& b, double tol) {
+	if (a.rows() != b.rows() || a.cols() != b.cols()) return false;
+	for (math::uint i = 0; i < a.size(); ++i)
+		if (std::fabs(a.data()[i] - b.data()[i]) > tol) return false;
+	return true;
+}
+
+void test_layout() {
+	say("\ntesting distributed layout...\n");
+
+	math::dist::Grid g;
+	int size;
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+	check(g.size() == size && g.prows() * g.pcols() == size && g.prows() <= g.pcols(), "grid covers every rank");
+
+	// every global row and column is owned exactly once
+	math::uint total = 0;
+	for (int p = 0; p < g.prows(); ++p) total += math::dist::detail::local_count(23, 4, p, g.prows());
+	check(total == 23, "block-cyclic counts add up");
+
+	math::dMatrix m (23, 17, 0.0);
+	fill_pattern(m, 1);
+	math::dist::dDistMatrix d (g, m, 4);
+	bool owned = true;
+	for (math::uint i = 0; i < d.local().rows(); ++i)
+		for (math::uint j = 0; j < d.local().cols(); ++j)
+			owned = owned && d.owner(d.global_row(i), d.global_col(j)) == g.rank()
+				&& d.local()(i, j) == m(d.global_row(i), d.global_col(j));
+	check(owned, "local blocks hold their global elements");
+
+	math::dMatrix back = d.gather();
+	check(g.rank() != 0 || same(back, m, 0.0), "scatter then gather round trips");
+	check(g.rank() == 0 || back.size() == 0, "gather leaves other ranks empty");
+
+	say("distributed layout success\n");
+}
+
+void test_summa() {
+	say("\ntesting SUMMA...\n");
+
+	math::dist::Grid g;
+	math::dMatrix A (37, 29, 0.0), B (29, 41, 0.0), C (37, 41, 1.0);
+	fill_pattern(A, 2);
+	fill_pattern(B, 3);
+
+	math::dist::dDistMatrix dA (g, A, 5), dB (g, B, 5), dC (g, C, 5);
+	math::dMatrix prod = (dA * dB).gather();
+	check(g.rank() != 0 || same(prod, A * B, 1e-9), "distributed product matches gemm");
+
+	math::dist::summa(2.0, dA, dB, 0.5, dC);
+	math::dMatrix expect = A * B * 2.0 + C * 0.5;
+	math::dMatrix got = dC.gather();
+	check(g.rank() != 0 || same(got, expect, 1e-9), "summa scales and accumulates");
+
+	// a grid with one process row broadcasts along a single row
+	math::dist::Grid flat (MPI_COMM_WORLD, 1);
+	math::dist::dDistMatrix fA (flat, A, 8), fB (flat, B, 8);
+	check(flat.prows() == 1, "explicit process rows are kept");
+	math::dMatrix fprod = (fA * fB).gather();
+	check(flat.rank() != 0 || same(fprod, A * B, 1e-9), "product on a 1 x P grid");
+
+	try {
+		math::dist::dDistMatrix bad (g, A, 4);
+		dA * bad;
+		check(false, "mismatched shapes should throw");
+	} catch (const std::invalid_argument& e) {
+		if (rank == 0) std::cout << "properly caught bad product with exception:\n\t" << e.what() << "\n";
+	}
+
+	say("SUMMA success\n");
+}
+
+void test_remap() {
+	say("\ntesting transpose and redistribution...\n");
+
+	math::dist::Grid g;
+	math::dMatrix A (31, 19, 0.0);
+	fill_pattern(A, 4);
+	math::dist::dDistMatrix dA (g, A, 3);
+
+	math::dMatrix t = math::dist::transpose(dA).gather();
+	math::dMatrix expect (A);
+	expect.T();
+	check(g.rank() != 0 || same(t, expect, 0.0), "distributed transpose");
+
+	math::dist::dDistMatrix r = math::dist::redistribute(dA, 7);
+	check(r.block() == 7, "new block size");
+	math::dMatrix back = r.gather();
+	check(g.rank() != 0 || same(back, A, 0.0), "redistribution keeps the matrix");
+
+	say("transpose and redistribution success\n");
+}
+
+void test_reductions() {
+	say("\ntesting distributed reductions...\n");
+
+	math::dist::Grid g;
+	math::dMatrix A (26, 33, 0.0);
+	fill_pattern(A, 5);
+	A(25, 32) = 100.0;
+	A(3, 4) = -50.0;
+	math::dist::dDistMatrix dA (g, A, 6);
+
+	double s = 0.0;
+	for (math::uint i = 0; i < A.size(); ++i) s += A.data()[i];
+	check(std::fabs(math::dist::sum(dA) - s) < 1e-9, "sum on every rank");
+	check(math::dist::max(dA) == 100.0 && math::dist::min(dA) == -50.0, "max and min on every rank");
+
+	say("distributed reductions success\n");
+}
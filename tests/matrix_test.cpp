@@ -1,19 +1,102 @@
+#define GPML_TRACE
 #include <iostream>
 #include "Matrix.hpp"
+#include "Elementwise.hpp"
+#include "Transcendental.hpp"
+#include "Vector.hpp"
+#include "Gemv.hpp"
+#include "Gemm.hpp"
+#include "Quantize.hpp"
+#include "Half.hpp"
+#include "Solve.hpp"
+#include "Packed.hpp"
+#include "Banded.hpp"
+#include "Diagonal.hpp"
+#include "BlockSparse.hpp"
+#include "OutOfCore.hpp"
+#include "Tiled.hpp"
+#include "Autotune.hpp"
+#include "Instrument.hpp"
+#include "Trace.hpp"
+#include "Roofline.hpp"
+#include "Perf.hpp"
+#include "Async.hpp"
+#include "TaskGraph.hpp"
+#include "TileFactor.hpp"
+#include "NUMA.hpp"
+#include "Shared.hpp"
+#include <sstream>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
 
 template<typename T>
 void print(const math::Matrix<T>&);
+void check(bool, const char*);
 
 void test_construction();
 void test_addition();
+void test_elementwise();
+void test_transcendental();
+void test_broadcasting();
+void test_vector();
+void test_multiplication();
+void test_quantized();
+void test_half();
+void test_solve();
+void test_structured();
+void test_diagonal();
+void test_block_sparse();
+void test_out_of_core();
+void test_tiled();
+void test_copy_on_write();
+void test_small_buffer();
+void test_autotune();
+void test_instrument();
+void test_trace();
+void test_roofline();
+void test_perf();
+void test_async();
+void test_task_graph();
+void test_tile_factor();
+void test_numa();
+void test_shared();
+
+int failures = 0;
 
 int main(int argc, char** argv) {
 
 	test_construction();	
 	test_addition();
+	test_elementwise();
+	test_transcendental();
+	test_broadcasting();
+	test_vector();
+	test_multiplication();
+	test_quantized();
+	test_half();
+	test_solve();
+	test_structured();
+	test_diagonal();
+	test_block_sparse();
+	test_out_of_core();
+	test_tiled();
+	test_copy_on_write();
+	test_small_buffer();
+	test_autotune();
+	test_instrument();
+	test_trace();
+	test_roofline();
+	test_perf();
+	test_async();
+	test_task_graph();
+	test_tile_factor();
+	test_numa();
+	test_shared();
 
 	std::cout << std::endl;
-	return 0;
+	return failures ? 1 : 0;
 }
 
 
@@ -26,6 +109,13 @@ void print(const math::Matrix<T>& m) {
 	}
 }
 
+void check(bool cond, const char* what) {
+	if (!cond) {
+		std::cout << "FAILED: " << what << "\n";
+		++failures;
+	}
+}
+
 void test_construction() {
 	std::cout << "\ntesting construction...\n";
 	
@@ -53,7 +143,7 @@ void test_addition() {
 		
 	math::iMatrix* a = new math::iMatrix ( 2, 2, { {1,2}, {2,3} } );
 	math::iMatrix* b = new math::iMatrix ( 2, 2, { {4,3}, {3,2} } );
-	math::iMatrix* c = new math::iMatrix ( 1, 2, { {1,1} } );
+	math::iMatrix* c = new math::iMatrix ( 1, 3, { {1,1,1} } );
 
 	print(*a);
 	std::cout << "+\n";
@@ -64,6 +154,7 @@ void test_addition() {
 	std::cout << "\ntesting adding matrices with different shapes...\n";
 	try {
 		print((*a) + (*c));
+		check(false, "incompatible addition should throw");
 	} catch (const std::exception& e) {
 		std::cout << "properly caught bad matrix addition with exception:\n\t" 
 				<< e.what() << "\n";
@@ -75,3 +166,1422 @@ void test_addition() {
 	std::cout << "addition success\n";
 }
 
+
+void test_elementwise() {
+	std::cout << "\ntesting element-wise map/zip/apply...\n";
+
+	math::fMatrix a (2, 3, { {-2.f, -0.5f, 0.f}, {0.5f, 1.f, 3.f} });
+	math::fMatrix b (2, 3, 2.f);
+
+	math::fMatrix clamped = math::map(a, [](float x) { return x < -1.f ? -1.f : (x > 1.f ? 1.f : x); });
+	print(clamped);
+	check(clamped.at(0,0) == -1.f && clamped.at(1,2) == 1.f && clamped.at(0,1) == -0.5f, "map clamp");
+
+	math::fMatrix prod = math::zip(a, b, [](float x, float y) { return x * y; });
+	check(prod.at(1,2) == 6.f && prod.at(0,0) == -4.f, "zip multiply");
+
+	math::iMatrix rounded = math::map(a, [](float x) { return static_cast<int>(x * 2); });
+	check(rounded.at(1,2) == 6 && rounded.at(0,1) == -1, "map changes element type");
+
+	// several transforms fused into one pass
+	auto add1 = [](float x) { return x + 1.f; };
+	auto twice = [](float x) { return x * 2.f; };
+	auto square = [](float x) { return x * x; };
+	math::apply(a, math::compose(add1, twice, square));
+	check(a.at(1,2) == 64.f && a.at(0,0) == 4.f, "apply composed");
+
+	math::zip_apply(a, b, [](float x, float y) { return x - y; });
+	check(a.at(1,2) == 62.f, "zip_apply");
+
+	std::cout << "testing shape mismatch...\n";
+	try {
+		math::zip(a, math::fMatrix (3, 2, 0.f), [](float x, float y) { return x + y; });
+		check(false, "zip shape mismatch should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught bad zip with exception:\n\t" << e.what() << "\n";
+	}
+
+	// force the threaded path regardless of host size
+	math::ul old_threshold = math::parallel::threshold();
+	math::uint old_threads = math::parallel::num_threads();
+	math::parallel::threshold() = 1000;
+	math::parallel::num_threads() = 4;
+
+	math::dMatrix big (300, 400, 1.0);
+	math::apply(big, [](double x) { return x + 2.0; });
+	big += big;
+	double total = 0.0;
+	for (math::uint i = 0; i < big.size(); ++i) total += big.data()[i];
+	check(total == 6.0 * big.size(), "threaded apply and +=");
+
+	math::parallel::threshold() = old_threshold;
+	math::parallel::num_threads() = old_threads;
+
+	std::cout << "element-wise success\n";
+}
+
+void test_transcendental() {
+	std::cout << "\ntesting exp/log/tanh/sigmoid/softmax...\n";
+
+	math::fMatrix a (2, 3, { {-1.f, 0.f, 1.f}, {2.f, 3.f, 4.f} });
+	math::dMatrix d (2, 3, { {-1.0, 0.0, 1.0}, {2.0, 3.0, 40.0} });
+
+	math::fMatrix e = math::exp(a);
+	math::dMatrix l = math::log(math::exp(d));
+	math::fMatrix t = math::tanh(a);
+	math::dMatrix s = math::sigmoid(d);
+	print(e);
+
+	bool ok = true;
+	for (math::uint r = 0; r < a.rows(); ++r) {
+		for (math::uint c = 0; c < a.cols(); ++c) {
+			ok = ok && std::fabs(e.at(r,c) - std::exp(a.at(r,c))) <= 2e-7f * std::exp(a.at(r,c));
+			ok = ok && std::fabs(t.at(r,c) - std::tanh(a.at(r,c))) <= 2e-7f;
+			ok = ok && std::fabs(l.at(r,c) - d.at(r,c)) <= 1e-14 * (1.0 + std::fabs(d.at(r,c)));
+			ok = ok && std::fabs(s.at(r,c) - 1.0 / (1.0 + std::exp(-d.at(r,c)))) <= 1e-15;
+		}
+	}
+	check(ok, "element-wise transcendental accuracy");
+	check(math::fast_exp(1000.f) == INFINITY && math::fast_exp(-1000.0) == 0.0, "exp overflow and underflow");
+	check(math::fast_log(0.0) == -INFINITY && math::fast_log(-1.f) != math::fast_log(-1.f), "log of zero and negatives");
+
+	// rows with large values must not overflow
+	math::dMatrix big (2, 3, { {1000.0, 1001.0, 1002.0}, {-5.0, 0.0, 5.0} });
+	math::dMatrix sm = math::softmax(big);
+	math::dMatrix lsm = math::log_softmax(big);
+	math::dMatrix lse = math::logsumexp(big);
+	print(sm);
+
+	double z = std::exp(-2.0) + std::exp(-1.0) + 1.0;
+	check(std::fabs(sm.at(0,2) - 1.0 / z) < 1e-15, "softmax value");
+	check(std::fabs(sm.at(1,0) + sm.at(1,1) + sm.at(1,2) - 1.0) < 1e-15, "softmax row sums to 1");
+	check(std::fabs(lse.at(0,0) - (1002.0 + std::log(z))) < 1e-12, "logsumexp value");
+	check(std::fabs(lsm.at(0,1) - (-1.0 - std::log(z))) < 1e-14, "log_softmax value");
+	check(lse.rows() == 2 && lse.cols() == 1, "logsumexp shape");
+
+	// a row of all -inf would otherwise shift by -inf - (-inf)
+	math::dMatrix ninf (2, 2, { {-INFINITY, -INFINITY}, {0.0, 0.0} });
+	math::dMatrix nlse = math::logsumexp(ninf), nsm = math::softmax(ninf), nlsm = math::log_softmax(ninf);
+	check(nlse.at(0,0) == -INFINITY && std::fabs(nlse.at(1,0) - std::log(2.0)) < 1e-15, "logsumexp of all -inf row");
+	check(std::isnan(nsm.at(0,0)) && std::isnan(nsm.at(0,1)) && nsm.at(1,0) == 0.5, "softmax of all -inf row is NaN");
+	check(std::isnan(nlsm.at(0,1)) && std::fabs(nlsm.at(1,1) + std::log(2.0)) < 1e-15, "log_softmax of all -inf row is NaN");
+
+	std::cout << "transcendental success\n";
+}
+
+void test_broadcasting() {
+	std::cout << "\ntesting broadcasting...\n";
+
+	math::iMatrix a (2, 3, { {1,2,3}, {4,5,6} });
+	math::iMatrix row (1, 3, { {10,20,30} });
+	math::iMatrix col (2, 1, { {100}, {200} });
+
+	math::iMatrix b = a + row;
+	print(b);
+	check(b.at(0,0) == 11 && b.at(1,2) == 36, "matrix + row vector");
+
+	b = a - col;
+	check(b.at(0,2) == -97 && b.at(1,0) == -196, "matrix - column vector");
+
+	b = row - a;
+	check(b.rows() == 2 && b.at(1,0) == 6 && b.at(0,2) == 27, "row vector - matrix");
+
+	math::iMatrix sq (2, 2, { {1,2}, {2,3} });
+	math::iMatrix pair = sq + math::iMatrix (1, 2, { {1,1} });
+	check(pair.rows() == 2 && pair.at(0,0) == 2 && pair.at(0,1) == 3 && pair.at(1,0) == 3 && pair.at(1,1) == 4,
+		"square matrix + row vector");
+
+	b = col + row;
+	print(b);
+	check(b.rows() == 2 && b.cols() == 3 && b.at(1,2) == 230, "column + row outer broadcast");
+
+	a += row;
+	a -= math::iMatrix (1, 1, 1);
+	check(a.at(0,0) == 10 && a.at(1,2) == 35, "in-place broadcast");
+
+	b = 100 - (a + 1);
+	check(b.at(0,0) == 89 && b.at(1,2) == 64, "scalar operators");
+
+	std::cout << "testing broadcasting into a smaller matrix...\n";
+	try {
+		row += a;
+		check(false, "in-place broadcast that grows should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught bad broadcast with exception:\n\t" << e.what() << "\n";
+	}
+
+	math::fMatrix bias (1, 2, { {0.5f, -0.5f} });
+	math::fMatrix scaled = math::zip(math::fMatrix (3, 2, 2.f), bias, [](float x, float y) { return x * y; });
+	check(scaled.at(2,0) == 1.f && scaled.at(2,1) == -1.f, "zip with broadcast");
+
+	std::cout << "broadcasting success\n";
+}
+
+void test_vector() {
+	std::cout << "\ntesting Vector and gemv...\n";
+
+	math::dVector x (std::vector<double> { 1.0, 2.0, 3.0 });
+	math::dVector y (3, 1.0);
+
+	check(math::dot(x, y) == 6.0, "dot");
+	math::axpy(2.0, x, y);
+	check(y[0] == 3.0 && y[2] == 7.0, "axpy");
+	math::scal(0.5, y);
+	check(y.at(2) == 3.5, "scal");
+	check(std::fabs(math::nrm2(x) - std::sqrt(14.0)) < 1e-15, "nrm2");
+
+	math::dVector huge (std::vector<double> { 3e200, 4e200 });
+	math::dVector tiny (std::vector<double> { 3e-200, 4e-200 });
+	check(std::fabs(math::nrm2(huge) / 5e200 - 1.0) < 1e-15, "nrm2 without overflow");
+	check(std::fabs(math::nrm2(tiny) / 5e-200 - 1.0) < 1e-15, "nrm2 without underflow");
+
+	math::dMatrix A (2, 3, { {1.0, 2.0, 3.0}, {4.0, 5.0, 6.0} });
+	math::dVector Ax = A * x;
+	check(Ax.size() == 2 && Ax[0] == 14.0 && Ax[1] == 32.0, "matrix * vector");
+
+	math::dVector z (2, 1.0);
+	math::gemv(2.0, A, x, 3.0, z);
+	check(z[0] == 31.0 && z[1] == 67.0, "gemv with alpha and beta");
+
+	math::dVector w (3, 1.0);
+	math::gemv_t(1.0, A, math::dVector (std::vector<double> { 1.0, -1.0 }), -1.0, w);
+	check(w[0] == -4.0 && w[1] == -4.0 && w[2] == -4.0, "gemv transposed");
+
+	std::cout << "testing mismatched gemv...\n";
+	try {
+		A * z;
+		check(false, "gemv size mismatch should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught bad gemv with exception:\n\t" << e.what() << "\n";
+	}
+
+	// threaded paths against a serial reference
+	math::ul old_threshold = math::parallel::threshold();
+	math::uint old_threads = math::parallel::num_threads();
+	math::parallel::threshold() = 500;
+	math::parallel::num_threads() = 4;
+
+	math::uint n = 300;
+	math::dMatrix B (n, n, 0.0);
+	math::dVector v (n, 0.0);
+	for (math::uint i = 0; i < n; ++i) {
+		v[i] = (i % 7) - 3.0;
+		for (math::uint j = 0; j < n; ++j) B(i, j) = ((i * 31 + j * 17) % 11) - 5.0;
+	}
+	math::dVector Bv = B * v;
+	math::dVector Btv (n, 0.0);
+	math::gemv_t(1.0, B, v, 0.0, Btv);
+
+	bool ok = true;
+	for (math::uint i = 0; i < n; ++i) {
+		double s = 0.0, t = 0.0;
+		for (math::uint j = 0; j < n; ++j) {
+			s += B(i, j) * v[j];
+			t += B(j, i) * v[j];
+		}
+		ok = ok && Bv[i] == s && Btv[i] == t;
+	}
+	check(ok, "threaded gemv and gemv_t");
+	double vv = 0.0;
+	for (math::uint i = 0; i < n; ++i) vv += v[i] * v[i];
+	check(math::dot(v, v) == vv && math::dot(v, v) == math::dot(v, v), "threaded dot");
+
+	math::parallel::threshold() = old_threshold;
+	math::parallel::num_threads() = old_threads;
+
+	std::cout << "vector success\n";
+}
+
+// fills m with small integers so products are exact in double
+void fill_pattern(math::dMatrix& m, math::uint seed) {
+	for (math::uint r = 0; r < m.rows(); ++r)
+		for (math::uint c = 0; c < m.cols(); ++c)
+			m(r, c) = static_cast<double>((r * 7 + c * 13 + seed) % 9) - 4.0;
+}
+
+bool same_product(const math::dMatrix& A, const math::dMatrix& B, const math::dMatrix& C) {
+	for (math::uint r = 0; r < A.rows(); ++r) {
+		for (math::uint c = 0; c < B.cols(); ++c) {
+			double s = 0.0;
+			for (math::uint i = 0; i < A.cols(); ++i) s += A(r, i) * B(i, c);
+			if (C(r, c) != s) return false;
+		}
+	}
+	return true;
+}
+
+void test_multiplication() {
+	std::cout << "\ntesting matrix multiplication...\n";
+
+	math::iMatrix a (2, 3, { {1,2,3}, {4,5,6} });
+	math::iMatrix b (3, 2, { {7,8}, {9,10}, {11,12} });
+	math::iMatrix c = a * b;
+	print(c);
+	check(c.rows() == 2 && c.cols() == 2 && c.at(0,0) == 58 && c.at(1,1) == 154, "non-square product");
+
+	math::dMatrix A (37, 53, 0.0), B (53, 29, 0.0), C (37, 29, 1.0);
+	fill_pattern(A, 1);
+	fill_pattern(B, 2);
+	check(same_product(A, B, A * B), "blocked product");
+
+	math::dMatrix D (C);
+	math::gemm(2.0, A, B, -1.0, D);
+	math::dMatrix AB = A * B;
+	bool ok = true;
+	for (math::uint i = 0; i < D.size(); ++i) ok = ok && D.data()[i] == 2.0 * AB.data()[i] - 1.0;
+	check(ok, "gemm with alpha and beta");
+
+	// strassen on odd shapes, sequential and with parallel top level
+	math::uint old_threshold = math::strassen::threshold(), old_cutoff = math::strassen::cutoff();
+	math::uint old_threads = math::parallel::num_threads();
+	math::strassen::threshold() = 40;
+	math::strassen::cutoff() = 12;
+
+	math::dMatrix E (71, 65, 0.0), F (65, 83, 0.0);
+	fill_pattern(E, 3);
+	fill_pattern(F, 4);
+	math::parallel::num_threads() = 1;
+	check(same_product(E, F, E * F), "strassen-winograd sequential");
+	math::parallel::num_threads() = 4;
+	check(same_product(E, F, E * F), "strassen-winograd parallel top level");
+
+	math::dMatrix G (71, 83, 1.0);
+	math::gemm(0.5, E, F, 2.0, G);
+	math::dMatrix EF = E * F;
+	ok = true;
+	for (math::uint i = 0; i < G.size(); ++i) ok = ok && G.data()[i] == 0.5 * EF.data()[i] + 2.0;
+	check(ok, "strassen-winograd with alpha and beta");
+
+	math::strassen::enabled() = false;
+	check(same_product(E, F, E * F), "strassen opt-out");
+	math::strassen::enabled() = true;
+
+	math::strassen::threshold() = old_threshold;
+	math::strassen::cutoff() = old_cutoff;
+	math::parallel::num_threads() = old_threads;
+
+	std::cout << "testing bad multiplication...\n";
+	try {
+		a * a;
+		check(false, "bad multiplication should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught bad multiplication with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "multiplication success\n";
+}
+
+void test_quantized() {
+	std::cout << "\ntesting quantized multiplication...\n";
+
+	math::fMatrix X (9, 70, 0.f), W (70, 13, 0.f);
+	for (math::uint i = 0; i < X.size(); ++i) X.data()[i] = static_cast<float>((i * 37) % 101) / 25.f - 1.5f;
+	for (math::uint i = 0; i < W.size(); ++i) W.data()[i] = static_cast<float>((i * 53) % 97) / 40.f - 1.2f;
+
+	math::u8Matrix qx = math::quantize<uint8_t>(X, math::PER_ROW);
+	math::i8Matrix qw = math::quantize<int8_t>(W, math::PER_COLUMN);
+
+	bool ok = true;
+	math::fMatrix Xd = math::dequantize(qx);
+	for (math::uint r = 0; r < X.rows(); ++r)
+		for (math::uint c = 0; c < X.cols(); ++c)
+			ok = ok && std::fabs(Xd(r, c) - X(r, c)) <= 0.5f * qx.scale(r, c) + 1e-6f;
+	check(ok, "quantize/dequantize round trip");
+	check(qw.zero_point(0, 5) == 0, "signed quantization is symmetric");
+
+	// NaN and infinite inputs must not reach a float to integer cast
+	math::fMatrix Xn (X);
+	Xn(2, 3) = std::numeric_limits<float>::quiet_NaN();
+	Xn(4, 0) = -std::numeric_limits<float>::infinity();
+	math::u8Matrix qn = math::quantize<uint8_t>(Xn, math::PER_ROW);
+	math::i8Matrix qs = math::quantize<int8_t>(Xn, math::PER_TENSOR);
+	check(qn.at(2, 3) == qn.zero_point(2, 3) && qs.at(2, 3) == qs.zero_point(2, 3) && qn.zero_point(4, 0) == 0,
+		"NaN quantizes to the zero point");
+
+	// the integer product must match a naive zero point corrected sum exactly
+	math::Matrix<int32_t> acc = math::qgemm_s32(qx, qw);
+	ok = true;
+	for (math::uint r = 0; r < acc.rows(); ++r)
+		for (math::uint c = 0; c < acc.cols(); ++c) {
+			int32_t s = 0;
+			for (math::uint i = 0; i < X.cols(); ++i)
+				s += (qx.at(r, i) - qx.zero_point(r, i)) * (qw.at(i, c) - qw.zero_point(i, c));
+			ok = ok && acc(r, c) == s;
+		}
+	check(ok, "uint8 x int8 accumulation");
+
+	math::fMatrix Y = math::qgemm(qx, qw), Yf = X * W;
+	float err = 0.f, mx = 0.f;
+	for (math::uint i = 0; i < Y.size(); ++i) {
+		err = std::fmax(err, std::fabs(Y.data()[i] - Yf.data()[i]));
+		mx = std::fmax(mx, std::fabs(Yf.data()[i]));
+	}
+	check(err < 0.02f * mx, "quantized product close to fp32");
+
+	// one large entry keeps the other int16 products small enough not to overflow
+	math::fMatrix X16 (X), W16 (W);
+	X16(0, 0) = 100.f;
+	W16(0, 0) = 100.f;
+	math::i16Matrix qa = math::quantize<int16_t>(X16, math::PER_TENSOR);
+	math::i16Matrix qb = math::quantize<int16_t>(W16, math::PER_TENSOR);
+	math::Matrix<int32_t> acc16 = math::qgemm_s32(qa, qb);
+	int32_t s = 0;
+	for (math::uint i = 0; i < X.cols(); ++i) s += qa.at(3, i) * qb.at(i, 7);
+	check(acc16(3, 7) == s, "int16 accumulation");
+
+	std::cout << "testing bad quantized multiplication...\n";
+	try {
+		math::qgemm_s32(qw, qx);
+		check(false, "bad quantized multiplication should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught bad quantized multiplication with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "quantized multiplication success\n";
+}
+
+void test_half() {
+	std::cout << "\ntesting half and bfloat16...\n";
+
+	check(math::half(1.f).bits() == 0x3c00 && math::half(65504.f).bits() == 0x7bff, "half normal values");
+	check(math::half(65520.f).bits() == 0x7c00 && math::half(-1e9f).bits() == 0xfc00, "half overflow");
+	check(math::half(5.9604645e-8f).bits() == 0x0001 && float(math::half::from_bits(0x0001)) == 5.9604645e-8f, "half denormals");
+	check(math::half(1.f + 1.f / 2048).bits() == 0x3c00 && math::half(1.f + 3.f / 2048).bits() == 0x3c02, "half ties to even");
+	check(float(math::half(std::nanf(""))) != float(math::half(std::nanf(""))), "half nan");
+	check(math::bfloat16(1.f).bits() == 0x3f80 && math::bfloat16(1.f + 1.f / 256).bits() == 0x3f80
+		&& math::bfloat16(1.f + 3.f / 256).bits() == 0x3f82, "bfloat16 ties to even");
+
+	bool ok = true;
+	for (uint32_t h = 0; h < 0x7c00; ++h) ok = ok && math::half(float(math::half::from_bits(h))).bits() == h;
+	check(ok, "half round trip");
+
+	// NaNs come back quiet with their payload, as F16C returns them
+	ok = true;
+	for (uint32_t h = 0x7c01; h < 0x10000; ++h) {
+		if ((h & 0x7c00) != 0x7c00 || (h & 0x3ff) == 0) continue;
+		uint32_t f = math::detail::float_bits(math::detail::soft_half_to_float(static_cast<uint16_t>(h)));
+		ok = ok && f == (((h & 0x8000u) << 16) | 0x7fc00000u | ((h & 0x3ffu) << 13));
+	}
+	check(ok, "half nan is quieted");
+
+#if defined(__F16C__)
+	// the software conversions against the hardware: every half, and a spread of floats
+	ok = true;
+	for (uint32_t h = 0; h < 0x10000; ++h)
+		ok = ok && math::detail::float_bits(math::detail::soft_half_to_float(static_cast<uint16_t>(h)))
+			== math::detail::float_bits(_cvtsh_ss(static_cast<uint16_t>(h)));
+	check(ok, "software half to float matches F16C");
+	ok = true;
+	for (uint64_t u = 0; u < 0x100000000ull; u += 4093) {
+		float f = math::detail::bits_float(static_cast<uint32_t>(u));
+		ok = ok && math::detail::soft_float_to_half(f) == static_cast<uint16_t>(_cvtss_sh(f, 0));
+	}
+	check(ok, "software float to half matches F16C");
+#endif
+
+	math::fMatrix A (33, 700, 0.f), B (700, 45, 0.f);
+	for (math::uint i = 0; i < A.size(); ++i) A.data()[i] = static_cast<float>((i * 37) % 101) / 25.f - 1.5f;
+	for (math::uint i = 0; i < B.size(); ++i) B.data()[i] = static_cast<float>((i * 53) % 97) / 40.f - 1.2f;
+	math::hMatrix Ah = math::matrix_cast<math::half>(A), Bh = math::matrix_cast<math::half>(B);
+	math::fMatrix C = A * B;
+	math::fMatrix Ch = math::matrix_cast<float>(Ah * Bh);
+
+	float err = 0.f, mx = 0.f;
+	for (math::uint i = 0; i < C.size(); ++i) {
+		err = std::fmax(err, std::fabs(Ch.data()[i] - C.data()[i]));
+		mx = std::fmax(mx, std::fabs(C.data()[i]));
+	}
+	check(err < 4e-3f * mx, "half gemm accumulates in float");
+
+	math::bf16Matrix Ab = math::matrix_cast<math::bfloat16>(A), Bb = math::matrix_cast<math::bfloat16>(B);
+	math::fMatrix Cb = math::matrix_cast<float>(Ab * Bb);
+	err = 0.f;
+	for (math::uint i = 0; i < C.size(); ++i) err = std::fmax(err, std::fabs(Cb.data()[i] - C.data()[i]));
+	check(err < 3e-2f * mx, "bfloat16 gemm accumulates in float");
+
+	math::hMatrix S = Ah + Ah;
+	ok = true;
+	for (math::uint i = 0; i < S.size(); ++i) ok = ok && float(S.data()[i]) == 2.f * float(Ah.data()[i]);
+	check(ok, "half element-wise addition");
+
+	std::cout << "half and bfloat16 success\n";
+}
+
+void test_solve() {
+	std::cout << "\ntesting linear solvers...\n";
+
+	// diagonally weighted so the system is well conditioned but still needs pivoting
+	math::uint n = 150;
+	math::dMatrix A (n, n, 0.0);
+	math::dVector xt (n, 0.0);
+	for (math::uint r = 0; r < n; ++r) {
+		xt[r] = std::sin(0.1 * r) + 1.0 / 3.0;
+		for (math::uint c = 0; c < n; ++c)
+			A(r, c) = std::cos(0.37 * r * c + r) + ((r == (c * 7) % n) ? 2.0 * n : 0.0);
+	}
+	math::dVector b = A * xt;
+
+	math::dVector x = math::solve(A, b);
+	double err = 0.0;
+	for (math::uint i = 0; i < n; ++i) err = std::fmax(err, std::fabs(x[i] - xt[i]));
+	check(err < 1e-12, "double LU solve");
+
+	math::RefineInfo info;
+	math::dVector xr = math::solve_refined(A, b, &info);
+	err = 0.0;
+	for (math::uint i = 0; i < n; ++i) err = std::fmax(err, std::fabs(xr[i] - xt[i]));
+	std::cout << "refined in " << info.iterations << " steps, residual " << info.residual << "\n";
+	check(info.converged && !info.fell_back && err < 1e-12, "float factorization refined to double accuracy");
+
+	// Hilbert matrices are far too ill conditioned for a float factorization
+	math::uint h = 12;
+	math::dMatrix H (h, h, 0.0);
+	for (math::uint r = 0; r < h; ++r)
+		for (math::uint c = 0; c < h; ++c) H(r, c) = 1.0 / (r + c + 1);
+	math::dVector hb (h, 1.0);
+	math::dVector hx = math::solve_refined(H, hb, &info);
+	math::dVector hd = math::solve(H, hb);
+	bool same = true;
+	for (math::uint i = 0; i < h; ++i) same = same && hx[i] == hd[i];
+	check(!info.converged && info.fell_back && same, "ill conditioned system falls back to double");
+
+	std::cout << "testing singular system...\n";
+	try {
+		math::dMatrix S (3, 3, 1.0);
+		math::solve_refined(S, math::dVector(3, 1.0));
+		check(false, "singular system should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught singular system with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "linear solvers success\n";
+}
+
+void test_structured() {
+	std::cout << "\ntesting packed and banded storage...\n";
+
+	// integer valued data keeps every product exact, so results must match dense
+	math::uint n = 97, m = 13;
+	math::dMatrix D (n, n, 0.0);
+	math::dMatrix B (n, m, 0.0);
+	math::dVector x (n, 0.0);
+	for (math::uint r = 0; r < n; ++r) {
+		x[r] = (r * 5) % 7 - 3.0;
+		for (math::uint c = 0; c < n; ++c) D(r, c) = ((r + c) * (r + c + 3)) % 11 - 5.0;
+		for (math::uint c = 0; c < m; ++c) B(r, c) = (r * 3 + c * 7) % 9 - 4.0;
+	}
+
+	math::dSymmetricMatrix S (D);
+	math::dMatrix Sd = S.dense();
+	check(S.size() == n * (n + 1) / 2 && S.at(3, 40) == D(40, 3), "symmetric packing");
+	math::dVector y = S * x, yd = Sd * x;
+	bool same = true;
+	for (math::uint i = 0; i < n; ++i) same = same && y[i] == yd[i];
+	check(same, "symv matches dense");
+	check(same_product(Sd, B, S * B), "symm matches dense");
+
+	for (int t = 0; t < 2; ++t) {
+		math::Triangle uplo = t ? math::UPPER : math::LOWER;
+		math::dTriangularMatrix T (D, uplo);
+		for (math::uint i = 0; i < n; ++i) T.set(i, i, 4.0 + i % 3);
+		math::dMatrix Td = T.dense();
+		math::dVector tx = T * x, txd = Td * x;
+		same = true;
+		for (math::uint i = 0; i < n; ++i) same = same && tx[i] == txd[i];
+		check(same, "trmv matches dense");
+		check(same_product(Td, B, T * B), "trmm matches dense");
+
+		math::dVector s (tx);
+		math::trsv(T, s);
+		double err = 0.0;
+		for (math::uint i = 0; i < n; ++i) err = std::fmax(err, std::fabs(s[i] - x[i]));
+		check(err < 1e-9, "trsv inverts trmv");
+
+		math::dMatrix X = T * B;
+		math::trsm(T, X);
+		err = 0.0;
+		for (math::uint r = 0; r < n; ++r)
+			for (math::uint c = 0; c < m; ++c) err = std::fmax(err, std::fabs(X(r, c) - B(r, c)));
+		check(err < 1e-9, "trsm inverts trmm");
+	}
+
+	// packed solvers: a shifted copy of S is positive definite, S itself is indefinite
+	math::dSymmetricMatrix P (S);
+	for (math::uint i = 0; i < n; ++i) P(i, i) += 6.0 * n;
+	math::dMatrix Pd = P.dense();
+	math::dVector pb = Pd * x;
+	math::dMatrix PB = Pd * B;
+	math::pptrf(P);
+	math::pptrs(P, pb);
+	math::pptrs(P, PB);
+	double perr = 0.0;
+	for (math::uint i = 0; i < n; ++i) perr = std::fmax(perr, std::fabs(pb[i] - x[i]));
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < m; ++c) perr = std::fmax(perr, std::fabs(PB(r, c) - B(r, c)));
+	check(perr < 1e-9, "packed cholesky solve");
+
+	// S has rank 11, so the indefinite system gets a diagonal of both signs and some zeros
+	math::dSymmetricMatrix LD (S);
+	for (math::uint i = 0; i < n; ++i) LD(i, i) = (i % 4 == 0) ? 0.0 : (i % 2 ? 2.0 * n : -2.0 * n);
+	math::dMatrix LDd = LD.dense();
+	math::dVector lb = LDd * x;
+	math::dMatrix LB = LDd * B;
+	std::vector<int> spiv;
+	math::sptrf(LD, spiv);
+	math::sptrs(LD, spiv, lb);
+	math::sptrs(LD, spiv, LB);
+	bool blocks = false;
+	for (math::uint i = 0; i < n; ++i) blocks = blocks || spiv[i] < 0;
+	perr = 0.0;
+	for (math::uint i = 0; i < n; ++i) perr = std::fmax(perr, std::fabs(lb[i] - x[i]));
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < m; ++c) perr = std::fmax(perr, std::fabs(LB(r, c) - B(r, c)));
+	check(blocks && perr < 1e-8, "packed LDL^T solve of an indefinite system");
+
+	// zero diagonal: only a 2 x 2 pivot works
+	math::dSymmetricMatrix J (2, 0.0);
+	J.set(1, 0, 1.0);
+	math::dVector jb (2, 0.0);
+	jb[0] = 3.0;
+	jb[1] = -2.0;
+	math::sptrf(J, spiv);
+	math::sptrs(J, spiv, jb);
+	check(spiv[0] < 0 && spiv[1] < 0 && jb[0] == -2.0 && jb[1] == 3.0, "2 x 2 pivot");
+
+	try {
+		math::dSymmetricMatrix Q (S);
+		math::pptrf(Q);
+		check(false, "indefinite cholesky should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught indefinite matrix with exception:\n\t" << e.what() << "\n";
+	}
+
+	// band with a tiny diagonal so elimination has to pivot
+	math::uint kl = 3, ku = 2;
+	math::dBandMatrix G (D, kl, ku);
+	for (math::uint i = 0; i < n; i += 5) G.set(i, i, 0.0);
+	math::dMatrix Gd = G.dense();
+	math::dVector gx = G * x, gxd = Gd * x;
+	same = true;
+	for (math::uint i = 0; i < n; ++i) same = same && gx[i] == gxd[i];
+	check(same, "gbmv matches dense");
+	check(G.at(0, 50) == 0.0 && Gd(10, 7) == D(10, 7) && Gd(10, 13) == 0.0, "band layout");
+
+	math::dVector gs = math::band_solve(G, gx);
+	double err = 0.0;
+	for (math::uint i = 0; i < n; ++i) err = std::fmax(err, std::fabs(gs[i] - x[i]));
+	check(err < 1e-9, "band solve");
+
+	math::dTridiagonalMatrix T3 (n, -1.0);
+	for (math::uint i = 0; i < n; ++i) T3.set(i, i, 4.0);
+	math::dVector t3 = T3 * x, t3d = T3.dense() * x;
+	same = true;
+	for (math::uint i = 0; i < n; ++i) same = same && t3[i] == t3d[i];
+	check(same, "tridiagonal product matches dense");
+	math::dVector ts = math::tridiagonal_solve(T3, t3);
+	err = 0.0;
+	for (math::uint i = 0; i < n; ++i) err = std::fmax(err, std::fabs(ts[i] - x[i]));
+	check(err < 1e-12, "tridiagonal solve");
+
+	std::cout << "testing singular triangular system...\n";
+	try {
+		math::dTriangularMatrix Z (4, math::LOWER, 1.0);
+		Z.set(2, 2, 0.0);
+		math::dVector v (4, 1.0);
+		math::trsv(Z, v);
+		check(false, "singular triangular system should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught singular system with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "packed and banded storage success\n";
+}
+
+void test_diagonal() {
+	std::cout << "\ntesting diagonal and permutation matrices...\n";
+
+	math::uint n = 37, m = 23;
+	math::dMatrix A (n, m, 0.0);
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < m; ++c) A(r, c) = (r * 7 + c * 3) % 13 - 6.0;
+
+	std::vector<double> dl (n), dr (m);
+	for (math::uint i = 0; i < n; ++i) dl[i] = i % 5 - 2.0;
+	for (math::uint i = 0; i < m; ++i) dr[i] = i % 3 + 0.5;
+	math::dDiagonalMatrix Dl (dl), Dr (dr);
+	check(same_product(Dl.dense(), A, Dl * A), "row scaling matches dense");
+	check(same_product(A, Dr.dense(), A * Dr), "column scaling matches dense");
+	math::dMatrix S (A);
+	S *= Dr;
+	check(same_product(A, Dr.dense(), S), "in place column scaling");
+	check(same_product(Dr.dense(), Dr.dense(), (Dr * Dr).dense()), "diagonal product");
+
+	std::vector<math::uint> pl (n), pr (m);
+	for (math::uint i = 0; i < n; ++i) pl[i] = (i * 10 + 3) % n;
+	for (math::uint i = 0; i < m; ++i) pr[i] = (i * 5 + 1) % m;
+	math::PermutationMatrix Pl (pl), Pr (pr);
+	check(same_product(Pl.dense<double>(), A, Pl * A), "row permutation matches dense");
+	check(same_product(A, Pr.dense<double>(), A * Pr), "column permutation matches dense");
+	S = A;
+	math::permute_rows(Pl, S);
+	check(same_product(Pl.dense<double>(), A, S), "in place row permutation");
+	check(same_product(Pl.dense<double>(), Pl.dense<double>(), (Pl * Pl).dense<double>()), "permutation product");
+	check(same_product(Pl.dense<double>(), Pl.inverse().dense<double>(), math::PermutationMatrix(n).dense<double>()), "permutation inverse");
+
+	// the pivots of an LU factorization give P with P A = L U
+	math::dMatrix B (n, n, 0.0);
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < n; ++c) B(r, c) = std::cos(0.3 * r * c + r);
+	math::dMatrix LU (B);
+	std::vector<math::uint> piv;
+	math::lu_factor(LU, piv);
+	math::dMatrix L (n, n, 0.0), U (n, n, 0.0);
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < n; ++c) {
+			if (c < r) L(r, c) = LU(r, c);
+			else U(r, c) = LU(r, c);
+			if (c == r) L(r, c) = 1.0;
+		}
+	math::dMatrix PB = math::PermutationMatrix::from_pivots(piv) * B;
+	math::dMatrix LUp = L * U;
+	double err = 0.0;
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < n; ++c) err = std::fmax(err, std::fabs(PB(r, c) - LUp(r, c)));
+	check(err < 1e-12, "permutation from LU pivots");
+
+	std::cout << "testing invalid permutation...\n";
+	try {
+		std::vector<math::uint> bad (3, 1);
+		math::PermutationMatrix P (bad);
+		check(false, "invalid permutation should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught invalid permutation with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "diagonal and permutation matrices success\n";
+}
+
+void test_block_sparse() {
+	std::cout << "\ntesting block sparse matrices...\n";
+
+	// 8x8 blocks on a sparse pattern; integer values keep the products exact
+	math::uint bs = 8, m = 12 * bs, k = 9 * bs, n = 29;
+	math::dMatrix A (m, k, 0.0);
+	for (math::uint r = 0; r < m; ++r)
+		for (math::uint c = 0; c < k; ++c)
+			if ((r / bs * 5 + c / bs * 3) % 4 == 0) A(r, c) = (r * 3 + c) % 7 - 3.0;
+	math::dMatrix B (k, n, 0.0);
+	math::dVector x (k, 0.0);
+	for (math::uint r = 0; r < k; ++r) {
+		x[r] = r % 5 - 2.0;
+		for (math::uint c = 0; c < n; ++c) B(r, c) = (r + 2 * c) % 9 - 4.0;
+	}
+
+	math::dBSRMatrix S (A, bs);
+	math::uint expected = 0;
+	for (math::uint br = 0; br < m / bs; ++br)
+		for (math::uint bc = 0; bc < k / bs; ++bc) expected += (br * 5 + bc * 3) % 4 == 0;
+	check(S.blocks() == expected && S.dense().data()[5] == A(0, 5), "stored blocks");
+	check(S.at(0, 0) == A(0, 0) && S.at(8, 0) == 0.0, "block lookup");
+	check(same_product(A, B, S * B), "bsr times dense matches dense");
+	math::dVector y = S * x, yd = A * x;
+	bool same = true;
+	for (math::uint i = 0; i < m; ++i) same = same && y[i] == yd[i];
+	check(same, "bsr times vector matches dense");
+
+	std::vector<math::uint> rs, cs;
+	std::vector<double> vs;
+	for (math::uint r = 0; r < m; ++r)
+		for (math::uint c = 0; c < k; ++c)
+			if (A(r, c) != 0.0) {
+				rs.push_back(r); cs.push_back(c); vs.push_back(A(r, c) - 1.0);
+				rs.push_back(r); cs.push_back(c); vs.push_back(1.0);
+			}
+	math::dBSRMatrix T = math::dBSRMatrix::from_coo(m, k, bs, rs, cs, vs);
+	check(same_product(A, B, T * B), "bsr from coordinates");
+
+	std::cout << "testing block size that does not divide the shape...\n";
+	try {
+		math::dBSRMatrix bad (A, 7);
+		check(false, "bad block size should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught bad block size with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "block sparse matrices success\n";
+}
+
+void test_out_of_core() {
+	std::cout << "\ntesting out-of-core matrices...\n";
+
+	// shapes that are not multiples of the tile size and caches smaller than the data
+	math::uint m = 70, k = 45, n = 53, ts = 16;
+	math::dMatrix A (m, k, 0.0), B (k, n, 0.0);
+	for (math::uint r = 0; r < m; ++r)
+		for (math::uint c = 0; c < k; ++c) A(r, c) = (r * 3 + c * 5) % 11 - 5.0;
+	for (math::uint r = 0; r < k; ++r)
+		for (math::uint c = 0; c < n; ++c) B(r, c) = (r + c * 7) % 9 - 4.0;
+
+	{
+		math::dDiskMatrix DA ("ooc_a.bin", m, k, ts, 4), DB ("ooc_b.bin", k, n, ts, 3), DC ("ooc_c.bin", m, n, ts, 2);
+		DA.assign(A);
+		DB.assign(B);
+		math::disk_gemm(DA, DB, DC);
+		check(same_product(A, B, DC.dense()), "out-of-core gemm matches dense");
+		check(DA.hits() > 0, "prefetched tiles are used");
+
+		math::dDiskMatrix DT ("ooc_t.bin", k, m, ts, 2);
+		math::disk_transpose(DA, DT);
+		bool same = true;
+		for (math::uint r = 0; r < m; ++r)
+			for (math::uint c = 0; c < k; ++c) same = same && DT.at(c, r) == A(r, c);
+		check(same, "out-of-core transpose");
+
+		double sum = 0.0;
+		for (math::uint r = 0; r < m; ++r)
+			for (math::uint c = 0; c < k; ++c) sum += A(r, c);
+		check(math::disk_sum(DA) == sum, "out-of-core sum");
+
+		DA.set(69, 44, 100.0);
+	}
+
+	// dirty tiles reach the file when the matrix is destroyed
+	{
+		math::dDiskMatrix DA ("ooc_a.bin", 1);
+		check(DA.rows() == m && DA.cols() == k && DA.at(69, 44) == 100.0 && DA.at(3, 4) == A(3, 4), "reopened disk matrix");
+	}
+
+	std::cout << "testing wrong element type...\n";
+	try {
+		math::fDiskMatrix bad ("ooc_a.bin", 1);
+		check(false, "wrong element type should throw");
+	} catch (const std::runtime_error& e) {
+		std::cout << "properly caught wrong element type with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "testing truncated file...\n";
+	check(::truncate("ooc_a.bin", 64 + ts * ts * sizeof(double)) == 0, "truncate disk matrix file");
+	try {
+		math::dDiskMatrix bad ("ooc_a.bin", 1);
+		check(false, "truncated file should throw");
+	} catch (const std::runtime_error& e) {
+		std::cout << "properly caught truncated file with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::remove("ooc_a.bin");
+	std::remove("ooc_b.bin");
+	std::remove("ooc_c.bin");
+	std::remove("ooc_t.bin");
+	std::cout << "out-of-core matrices success\n";
+}
+
+void test_tiled() {
+	std::cout << "\ntesting tiled layouts...\n";
+
+	math::uint m = 75, k = 66, n = 41;
+	math::dMatrix A (m, k, 0.0), B (k, n, 0.0);
+	for (math::uint r = 0; r < m; ++r)
+		for (math::uint c = 0; c < k; ++c) A(r, c) = (r * 3 + c * 5) % 11 - 5.0;
+	for (math::uint r = 0; r < k; ++r)
+		for (math::uint c = 0; c < n; ++c) B(r, c) = (r + c * 7) % 9 - 4.0;
+
+	for (int o = 0; o < 2; ++o) {
+		math::TileOrder order = o ? math::TILE_MORTON : math::TILE_ROW_MAJOR;
+		math::dTiledMatrix TA (A, 16, order), TB (B, 16, order);
+		math::dMatrix back = TA.dense();
+		bool same = true;
+		for (math::uint r = 0; r < m; ++r)
+			for (math::uint c = 0; c < k; ++c) same = same && back(r, c) == A(r, c) && TA.at(r, c) == A(r, c);
+		check(same, "tiled round trip");
+
+		check(same_product(A, B, (TA * TB).dense()), "tiled gemm matches dense");
+
+		math::dTiledMatrix T = math::transpose(TA);
+		same = T.rows() == k && T.cols() == m;
+		for (math::uint r = 0; r < m && same; ++r)
+			for (math::uint c = 0; c < k; ++c) same = same && T(c, r) == A(r, c);
+		check(same, "tiled transpose");
+
+		math::dTiledMatrix S = TA + TA;
+		S *= 0.5;
+		S -= TA;
+		same = true;
+		for (math::uint r = 0; r < m; ++r)
+			for (math::uint c = 0; c < k; ++c) same = same && S(r, c) == 0.0;
+		check(same, "tiled element-wise operators");
+	}
+
+	// a non-finite scale or operand keeps the padding zero, so later products stay finite
+	const double inf = std::numeric_limits<double>::infinity();
+	math::dTiledMatrix P (5, 7, 4, math::TILE_ROW_MAJOR, 1.0), Q (7, 3, 4, math::TILE_ROW_MAJOR, 2.0);
+	P *= inf;
+	math::uint bad = 0;
+	for (math::uint i = 0; i < 64; ++i) bad += std::isfinite(P.data()[i]) ? 0 : 1;
+	check(bad == 35, "tiled scale keeps the padding zero");
+	for (math::uint r = 0; r < 5; ++r)
+		for (math::uint c = 0; c < 7; ++c) P.set(r, c, 1.0);
+	math::dTiledMatrix PQ = P * Q;
+	bool finite = true;
+	for (math::uint r = 0; r < 5; ++r)
+		for (math::uint c = 0; c < 3; ++c) finite = finite && PQ(r, c) == 14.0;
+	check(finite, "tiled gemm after a non-finite scale");
+	P.set(0, 6, inf);
+	PQ = P * Q;
+	bad = 0;
+	for (math::uint i = 0; i < 32; ++i) bad += std::isfinite(PQ.data()[i]) ? 0 : 1;
+	check(bad == 3, "tiled gemm keeps the padding zero");
+
+	// Morton order puts the four tiles of a 2 x 2 square next to each other
+	math::dTiledMatrix Z (64, 64, 16, math::TILE_MORTON, 0.0);
+	check(Z.tile(0, 1) - Z.data() == 256 && Z.tile(1, 0) - Z.data() == 512 && Z.tile(1, 1) - Z.data() == 768, "morton tile order");
+
+	std::cout << "testing mismatched layouts...\n";
+	try {
+		math::dTiledMatrix X (A, 16, math::TILE_MORTON), Y (A, 16, math::TILE_ROW_MAJOR);
+		X += Y;
+		check(false, "mismatched layouts should throw");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught mismatched layouts with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "tiled layouts success\n";
+}
+
+void test_copy_on_write() {
+	std::cout << "\ntesting copy-on-write...\n";
+
+	math::dMatrix a (6, 5, 1.0);
+	math::dMatrix plain (a);
+	check(plain.data() != a.data() && a.use_count() == 1, "copies are deep by default");
+
+	// reads go through const references; a non-const data() or operator() would detach
+	a.set_copy_on_write(true);
+	const math::dMatrix& ca = a;
+	const math::dMatrix b (a);
+	math::dMatrix c (3, 3, 0.0);
+	c = a;
+	const math::dMatrix& cc = c;
+	check(b.data() == ca.data() && cc.data() == ca.data() && a.use_count() == 3 && c.copy_on_write(), "copies share the buffer");
+
+	c.set(0, 0, 5.0);
+	check(cc.data() != b.data() && cc(0, 0) == 5.0 && ca(0, 0) == 1.0 && b.use_count() == 2, "set detaches");
+
+	math::dMatrix d (b);
+	d *= 2.0;
+	check(d.at(1, 1) == 2.0 && b(1, 1) == 1.0 && ca(1, 1) == 1.0, "compound operator detaches");
+
+	d = b;
+	d.T();
+	check(d.rows() == 5 && b.rows() == 6 && a.use_count() == 2, "transpose detaches");
+
+	math::dMatrix e = b * math::dMatrix(5, 2, 1.0);
+	check(e(2, 1) == 5.0 && b.use_count() == 2, "products read the shared buffer");
+
+	// broadcasting to a new shape takes lhs by value but only reads it, so nothing is deep copied
+	math::dMatrix row (1, 40, 1.0);
+	row.set_copy_on_write(true);
+	const math::dMatrix r (row), col (3, 1, 2.0);
+	math::instrument::enabled() = true;
+	math::instrument::reset();
+	math::dMatrix f = r + col, g = r - col;
+	math::instrument::enabled() = false;
+	// at most the returned results are copied; detaching r would add its 40 elements each time
+	check(f(2, 30) == 3.0 && g(1, 7) == -1.0
+		&& math::instrument::snapshot()[math::instrument::COPY].bytes <= 2 * 2 * f.size() * sizeof(double),
+		"broadcasting reads the shared buffer");
+
+	a.set_copy_on_write(false);
+	check(!a.copy_on_write() && a.use_count() == 1 && b.use_count() == 1 && ca.data() != b.data(), "turning copy-on-write off unshares");
+
+	std::cout << "copy-on-write success\n";
+}
+
+bool stored_inline(const math::dMatrix& m) {
+	const char* p = reinterpret_cast<const char*>(m.data());
+	const char* o = reinterpret_cast<const char*>(&m);
+	return p >= o && p < o + sizeof(m);
+}
+
+void test_small_buffer() {
+	std::cout << "\ntesting small buffer storage...\n";
+
+	math::dMatrix a (4, 4, 2.0), b (3, 7, 1.0);
+	check(stored_inline(a) && !stored_inline(b), "small matrices are stored inline");
+
+	math::dMatrix c (a);
+	c.set(0, 0, 1.0);
+	check(stored_inline(c) && a(0, 0) == 2.0, "small copies are independent");
+
+	math::dMatrix d (2, 8, 3.0);
+	d.T();
+	check(stored_inline(d) && d.rows() == 8 && d(7, 1) == 3.0, "small transpose stays inline");
+
+	// a large matrix shrinking to a small product moves back inline
+	math::dMatrix e = b * math::dMatrix(7, 2, 1.0);
+	check(stored_inline(e) && e(2, 1) == 7.0, "small product stored inline");
+	b = a;
+	check(stored_inline(b) && b(3, 3) == 2.0, "assignment of a small matrix");
+	a = math::dMatrix(5, 5, 4.0);
+	check(!stored_inline(a) && a(4, 4) == 4.0, "growing past the inline buffer");
+
+	a.set_copy_on_write(true);
+	c.set_copy_on_write(true);
+	const math::dMatrix& ca = a;
+	const math::dMatrix f (a), g (c);
+	check(f.use_count() == 2 && ca.data() == f.data() && stored_inline(g) && g.use_count() == 1, "small buffers are copied, not shared");
+
+	std::cout << "small buffer storage success\n";
+}
+
+void test_autotune() {
+	std::cout << "\ntesting gemm autotuning...\n";
+
+	check(math::gemm_shape(16, 4096, 4096) == math::GEMM_SMALL && math::gemm_shape(512, 600, 2000) == math::GEMM_MEDIUM
+		&& math::gemm_shape(2048, 2048, 1024) == math::GEMM_LARGE, "shape classes");
+
+	math::GemmParams p = math::autotune::tune_gemm<double>(math::GEMM_SMALL, 48, 1);
+	const math::GemmParams& small = math::gemm_params<double>(math::GEMM_SMALL);
+	check(p.unroll != 0 && small.unroll == p.unroll && small.kc == p.kc && small.threads == p.threads, "tuned parameters stored");
+
+	math::dMatrix A (37, 53, 0.0), B (53, 29, 0.0);
+	fill_pattern(A, 1);
+	fill_pattern(B, 2);
+	check(same_product(A, B, A * B), "product with tuned parameters");
+
+	math::gemm_params<float>(math::GEMM_LARGE) = math::GemmParams { 32, 128, 512, 8, 2 };
+	math::autotune::save("gpml_tuning_test.txt");
+	math::autotune::reset();
+	check(math::gemm_params<double>(math::GEMM_SMALL).unroll == 0, "reset clears tuned parameters");
+
+	check(math::autotune::load("gpml_tuning_test.txt"), "tuning file loads");
+	const math::GemmParams& f = math::gemm_params<float>(math::GEMM_LARGE);
+	check(f.mc == 32 && f.kc == 128 && f.nc == 512 && f.unroll == 8 && f.threads == 2
+		&& math::gemm_params<double>(math::GEMM_SMALL).nc == p.nc, "tuning file round trip");
+	check(!math::autotune::load("gpml_no_such_file.txt"), "missing tuning file");
+
+	// a short line and a negative size, around one good entry
+	math::autotune::reset();
+	{
+		std::ofstream bad ("gpml_tuning_test.txt");
+		bad << "double small 64 256\ndouble medium -1 128 256 4 0\nfloat small 16 64 64 2 0\nint large 8 8 8 3 0\n";
+	}
+	try {
+		math::autotune::load("gpml_tuning_test.txt");
+		check(false, "malformed tuning file should throw");
+	} catch (const std::runtime_error& e) {
+		std::cout << "properly caught malformed tuning file with exception:\n\t" << e.what() << "\n";
+	}
+	math::autotune::reset();
+	check(math::autotune::detail::read_file("gpml_tuning_test.txt", false), "startup load reads a malformed file");
+	check(math::gemm_params<float>(math::GEMM_SMALL).unroll == 2 && math::gemm_params<double>(math::GEMM_SMALL).unroll == 0
+		&& math::gemm_params<double>(math::GEMM_MEDIUM).unroll == 0 && math::gemm_params<int>(math::GEMM_LARGE).unroll == 0,
+		"startup load skips bad lines");
+
+	math::autotune::reset();
+	std::remove("gpml_tuning_test.txt");
+	std::cout << "gemm autotuning success\n";
+}
+
+void test_instrument() {
+	std::cout << "\ntesting instrumentation counters...\n";
+
+	namespace in = math::instrument;
+	math::dMatrix a (20, 30, 1.0), b (30, 10, 2.0);
+	check(in::snapshot()[in::GEMM].calls == 0, "counting is off by default");
+
+	in::enabled() = true;
+	in::reset();
+	math::dMatrix c = a * b;
+	c += c;
+	math::dMatrix d (c);
+	d.T();
+	in::Snapshot s = in::snapshot();
+	in::enabled() = false;
+
+	check(s[in::GEMM].calls == 1 && s[in::GEMM].flops == 2ull * 20 * 30 * 10
+		&& s[in::GEMM].bytes == (20 * 30 + 30 * 10 + 2 * 20 * 10) * sizeof(double), "gemm counters");
+	check(s[in::ELEMENTWISE].calls == 1 && s[in::ELEMENTWISE].flops == 200, "element-wise counters");
+	check(s[in::TRANSPOSE].calls == 1 && s[in::TRANSPOSE].allocations == 1, "transpose counters");
+	check(s[in::COPY].calls >= 1 && s[in::CONSTRUCTION].allocations >= 1, "copy and construction counters");
+
+	// counters of other threads are included, even after they exit
+	in::enabled() = true;
+	std::thread t ([] { math::dMatrix e (8, 8, 0.0); e.T(); });
+	t.join();
+	in::enabled() = false;
+	check(in::snapshot()[in::TRANSPOSE].calls == 2, "counters from exited threads");
+
+	std::string text = in::export_text(in::snapshot());
+	check(text.find("gpml_flops_total{op=\"gemm\"} 12000\n") != std::string::npos, "prometheus export");
+
+	in::reset();
+	s = in::snapshot();
+	check(s[in::GEMM].calls == 0 && s[in::TRANSPOSE].nanoseconds == 0, "reset");
+
+	std::cout << "instrumentation counters success\n";
+}
+
+void test_trace() {
+	std::cout << "\ntesting tracing spans...\n";
+
+	math::dMatrix a (40, 50, 1.0), b (50, 30, 2.0);
+	math::dMatrix c = a * b;
+	c.T();
+
+	std::thread t ([] { math::trace::Span s ("worker_span", 7); });
+	t.join();
+
+	std::ostringstream out;
+	math::trace::dump(out);
+	std::string json = out.str();
+	check(json.compare(0, 15, "{\"traceEvents\":") == 0 && json.find("\"displayTimeUnit\"") != std::string::npos, "chrome trace framing");
+	check(json.find("{\"name\":\"gemm\",\"ph\":\"X\"") != std::string::npos
+		&& json.find("\"args\":{\"m\":40,\"n\":30,\"k\":50}") != std::string::npos, "gemm span with shape");
+	check(json.find("\"name\":\"transpose\"") != std::string::npos, "transpose span");
+	check(json.find("\"name\":\"worker_span\"") != std::string::npos, "spans from exited threads");
+
+	std::cout << "tracing spans success\n";
+}
+
+void test_roofline() {
+	std::cout << "\ntesting roofline analysis...\n";
+
+	namespace rl = math::roofline;
+	rl::Machine m = { 10e9, 40e9 };
+	check(m.ridge() == 4.0, "ridge point");
+
+	rl::Kernel mem = { "mem", 1e6, 8e6, 2e-3 }, comp = { "comp", 4e8, 1e6, 2e-2 };
+	check(mem.attainable(m) == 1.25e9 && comp.attainable(m) == 40e9, "attainable rates");
+	check(std::fabs(mem.efficiency(m) - 0.4) < 1e-12 && std::fabs(comp.efficiency(m) - 0.5) < 1e-12, "efficiency");
+
+	std::vector<rl::Kernel> ks;
+	ks.push_back(mem);
+	ks.push_back(comp);
+	std::string r = rl::report(m, ks);
+	check(r.find("\ncomp,") != std::string::npos && r.find("\ncomp,") < r.find("\nmem,")
+		&& r.find(",compute,") != std::string::npos && r.find(",memory,") != std::string::npos, "report ordered by saving");
+
+	math::dMatrix a (30, 40, 1.0), b (40, 20, 1.0), c (30, 20, 0.0);
+	rl::Kernel g = rl::measure("gemm", [&] { math::gemm(1.0, a, b, 0.0, c); }, 2);
+	check(g.flops == 2.0 * 30 * 40 * 20 && g.bytes > 0 && g.seconds > 0 && !math::instrument::enabled(), "kernel work from counters");
+	check(rl::measure_bandwidth(1 << 20, 2) > 0 && rl::measure_flops(1 << 10, 2) > 0, "host peaks");
+
+	std::cout << "roofline analysis success\n";
+}
+
+void test_perf() {
+	std::cout << "\ntesting hardware counters...\n";
+
+	namespace pf = math::perf;
+	math::dMatrix a (64, 64, 1.0), b (64, 64, 2.0);
+	pf::Reading r = pf::measure([&] { a *= b; });
+
+	if (pf::local().available()) {
+		std::cout << "hardware counters available\n";
+		check(r.valid[pf::CYCLES] == pf::local().available(pf::CYCLES), "valid events match opened counters");
+		check(!r.valid[pf::INSTRUCTIONS] || r.value[pf::INSTRUCTIONS] > 0, "instructions counted");
+	} else {
+		std::cout << "hardware counters unavailable, checking fallback\n";
+		bool none = true;
+		for (math::uint e = 0; e < pf::EVENTS; ++e) none = none && !r.valid[e] && r.value[e] == 0;
+		check(none, "unavailable counters read as invalid zeros");
+	}
+
+	pf::Reading x = pf::Reading(), y = pf::Reading();
+	x.valid[pf::CYCLES] = y.valid[pf::CYCLES] = true;
+	x.value[pf::CYCLES] = 100;
+	y.value[pf::CYCLES] = 350;
+	pf::Reading d = y - x;
+	check(d.valid[pf::CYCLES] && d.value[pf::CYCLES] == 250 && !d.valid[pf::LLC_MISSES], "reading difference");
+
+	// hardware counting through the instrumentation degrades to zeros without counters
+	namespace in = math::instrument;
+	in::enabled() = in::hardware() = true;
+	in::reset();
+	a *= b;
+	in::Snapshot s = in::snapshot();
+	in::enabled() = in::hardware() = false;
+	check(s[in::GEMM].calls == 1 && (pf::local().available() || s[in::GEMM].hardware[pf::CYCLES] == 0), "instrumented hardware counters");
+	check(in::export_text(s).find("gpml_branch_misses_total{op=\"gemm\"}") != std::string::npos, "hardware counters exported");
+
+	std::cout << "hardware counters success\n";
+}
+
+void test_async() {
+	std::cout << "\ntesting asynchronous operations...\n";
+
+	namespace as = math::async;
+	math::dMatrix A (37, 53, 0.0), B (53, 29, 0.0), C (37, 29, 1.0);
+	fill_pattern(A, 1);
+	fill_pattern(B, 2);
+
+	// (A * B + C)^T as a chain of dependent tasks
+	as::Future<math::dMatrix> ab = as::gemm_async(A, B);
+	as::Future<math::dMatrix> sum = as::add_async(ab, C);
+	as::Future<math::dMatrix> t = as::transpose_async(sum);
+	A.set(0, 0, 1e9);	// operands were copied at the call
+
+	math::dMatrix expect = ab.get() + C;
+	expect.T();
+	const math::dMatrix& got = t.get();
+	bool ok = got.rows() == 29 && got.cols() == 37;
+	for (math::uint i = 0; ok && i < got.size(); ++i) ok = got.data()[i] == expect.data()[i];
+	check(ok && ab.ready() && sum.ready(), "chained gemm, add and transpose");
+
+	// independent products run concurrently, and both feed one sum
+	as::Future<math::dMatrix> p = as::gemm_async(B, as::transpose_async(B)), q = as::gemm_async(B, as::ready(math::dMatrix(29, 53, 1.0)));
+	as::Future<math::dMatrix> r = as::add_async(p, q);
+	check(r.get().rows() == 53 && r.get().cols() == 53, "diamond dependency");
+
+	// errors pass through to every dependent future
+	as::Future<math::dMatrix> bad = as::add_async(as::gemm_async(A, A), C);
+	try {
+		bad.get();
+		check(false, "failed input should throw from get");
+	} catch (const std::invalid_argument& e) {
+		std::cout << "properly caught failed dependency with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "asynchronous operations success\n";
+}
+
+void test_task_graph() {
+	std::cout << "\ntesting task graph...\n";
+
+	// x is written by 0, read by 1 and 2, then written by 3; y is written by 1 then read by 4
+	int x = 0, y = 0, seen1 = -1, seen2 = -1, seen3 = -1, seen4 = -1;
+	math::TaskGraph g;
+	g.add("w", [&] { x = 1; }, 1, {}, {&x});
+	g.add("r", [&] { seen1 = x; y = 2; }, 1, {&x}, {&y});
+	g.add("r", [&] { seen2 = x; }, 5, {&x}, {});
+	g.add("w", [&] { seen3 = x; x = 3; }, 1, {}, {&x});
+	g.add("r", [&] { seen4 = y; }, 1, {&y}, {});
+	check(g.size() == 5 && g.edges() == 6, "edges inferred from reads and writes");
+	check(g.critical_path() == 7, "critical path is the costliest chain");
+	g.run();
+	check(seen1 == 1 && seen2 == 1 && seen3 == 1 && seen4 == 2 && x == 3, "tasks ran in dependency order");
+
+	// many independent chains finish with every step in order
+	std::vector<int> chains (64, 0);
+	bool ordered = true;
+	math::TaskGraph h;
+	for (int step = 0; step < 8; ++step)
+		for (math::ul c = 0; c < chains.size(); ++c) {
+			int* v = &chains[c];
+			bool* ok = &ordered;
+			h.add("step", [=] { if (*v != step) *ok = false; *v = step + 1; }, 1, {}, {v});
+		}
+	h.run();
+	check(ordered && chains[0] == 8 && chains[63] == 8, "independent chains run in order");
+
+	// the first exception is rethrown and later tasks are skipped
+	bool after = false;
+	math::TaskGraph e;
+	e.add("throw", [] { throw std::invalid_argument("task failed"); }, 1, {}, {&x});
+	e.add("after", [&] { after = true; }, 1, {&x}, {});
+	try {
+		e.run();
+		check(false, "task exception should be rethrown");
+	} catch (const std::invalid_argument& ex) {
+		std::cout << "properly caught task failure with exception:\n\t" << ex.what() << "\n";
+	}
+	check(!after, "dependent task skipped after failure");
+
+	std::cout << "task graph success\n";
+}
+
+void test_tile_factor() {
+	std::cout << "\ntesting tiled factorizations...\n";
+
+	const math::uint n = 45, ts = 8;
+	math::dMatrix M (n, n, 0.0);
+	for (math::uint r = 0; r < n; ++r)
+		for (math::uint c = 0; c < n; ++c) M(r, c) = std::sin(0.37 * r * r + 1.1 * c + 0.3 * r * c);
+
+	// Cholesky of M M^T + n I, compared as L L^T
+	math::dMatrix Mt (M);
+	Mt.T();
+	math::dMatrix S = M * Mt;
+	for (math::uint i = 0; i < n; ++i) S.set(i, i, S.at(i, i) + n);
+	math::dTiledMatrix TS (S, ts, math::TILE_MORTON);
+	check(math::tile_cholesky(TS), "Cholesky of a positive definite matrix");
+	math::dMatrix L = TS.dense();
+	for (math::uint i = 0; i < n; ++i)
+		for (math::uint j = i + 1; j < n; ++j) L.set(i, j, 0.0);
+	math::dMatrix Lt (L);
+	Lt.T();
+	math::dMatrix LLt = L * Lt;
+	double err = 0;
+	for (math::uint i = 0; i < S.size(); ++i) err = std::max(err, std::fabs(LLt.data()[i] - S.data()[i]));
+	check(err < 1e-9 * n, "L L^T reproduces A");
+
+	math::dTiledMatrix notpd (math::dMatrix(n, n, 1.0), ts, math::TILE_ROW_MAJOR);
+	check(!math::tile_cholesky(notpd), "Cholesky rejects an indefinite matrix");
+
+	// LU solves the same system as lu_factor
+	math::dTiledMatrix TA (M, ts, math::TILE_ROW_MAJOR);
+	std::vector<math::uint> piv;
+	check(math::tile_lu(TA, piv), "LU of a nonsingular matrix");
+	math::dVector b (n, 0.0);
+	for (math::uint i = 0; i < n; ++i) b[i] = 1.0 + i % 7;
+	math::dVector x (b), ref = math::solve(M, b);
+	math::lu_solve(TA.dense(), piv, x);
+	err = 0;
+	for (math::uint i = 0; i < n; ++i) err = std::max(err, std::fabs(x[i] - ref[i]));
+	check(err < 1e-8, "tiled LU solution matches lu_factor");
+
+	math::dTiledMatrix sing (math::dMatrix(n, n, 2.0), ts, math::TILE_ROW_MAJOR);
+	check(!math::tile_lu(sing, piv), "LU reports a singular matrix");
+
+	// QR of a tall matrix, compared as R^T R = A^T A
+	const math::uint m = 61;
+	math::dMatrix T (m, n, 0.0);
+	fill_pattern(T, 4);
+	math::dTiledMatrix TQ (T, ts, math::TILE_MORTON);
+	std::vector<double> tau;
+	math::tile_qr(TQ, tau);
+	math::dMatrix R (n, n, 0.0);
+	for (math::uint i = 0; i < n; ++i)
+		for (math::uint j = i; j < n; ++j) R.set(i, j, TQ.at(i, j));
+	math::dMatrix Rt (R), Tt (T);
+	Rt.T();
+	Tt.T();
+	math::dMatrix RtR = Rt * R, TtT = Tt * T;
+	err = 0;
+	double scale = 0;
+	for (math::uint i = 0; i < RtR.size(); ++i) {
+		err = std::max(err, std::fabs(RtR.data()[i] - TtT.data()[i]));
+		scale = std::max(scale, std::fabs(TtT.data()[i]));
+	}
+	check(err < 1e-10 * scale, "R^T R reproduces A^T A");
+	check(tau.size() == static_cast<math::ul>(TQ.tile_rows()) * TQ.tile_cols() * ts, "reflector scales for every tile");
+
+	std::cout << "tiled factorizations success\n";
+}
+
+void test_numa() {
+	std::cout << "\ntesting NUMA placement...\n";
+
+	namespace nm = math::numa;
+	std::vector<math::uint> cpus = nm::detail::parse_list("0-3,8,10-11\n");
+	check(cpus.size() == 7 && cpus[3] == 3 && cpus[4] == 8 && cpus[6] == 11, "kernel cpu lists parse");
+
+	const nm::Topology& t = nm::topology();
+	check(nm::nodes() >= 1 && t.cpus.size() == nm::nodes(), "topology has a node");
+	check(nm::current_node() < nm::nodes(), "current node is in range");
+	check(!nm::bind_threads(), "pool threads are not pinned by default");
+
+	double small[4];
+	check(!nm::place(small, sizeof(small)), "small buffers are left alone");
+
+	// every policy gives the same contents, whether or not the host has several nodes
+	nm::Placement was = nm::placement();
+	math::ul min = nm::min_bytes();
+	nm::min_bytes() = 4096;
+	const nm::Placement policies[] = { nm::NUMA_DEFAULT, nm::NUMA_FIRST_TOUCH, nm::NUMA_INTERLEAVE, nm::NUMA_BLOCKED };
+	bool ok = true;
+	for (math::uint p = 0; p < 4; ++p) {
+		nm::placement() = policies[p];
+		math::dMatrix a (300, 200, 1.5);
+		a.set(299, 199, 2.0);
+		math::dMatrix b (a);
+		b.T();
+		for (math::uint i = 0; i + 1 < b.size(); ++i) ok = ok && b.data()[i] == 1.5;
+		ok = ok && b.at(199, 299) == 2.0 && (a + a).at(299, 199) == 4.0;
+	}
+	check(ok, "placement policies keep matrix contents");
+
+	// a policy must not outlive its buffer, so placed buffers are unmapped when freed
+	nm::placement() = nm::NUMA_INTERLEAVE;
+	void* mapped = nm::allocate(100000);
+	nm::placement() = nm::NUMA_FIRST_TOUCH;
+	void* heap = nm::allocate(100000);
+	// only hosts with several nodes place anything, so only they pay for a mapping
+#ifdef __linux__
+	if (nm::nodes() >= 2)
+		check(nm::detail::mapped_length(mapped) >= 100000 && reinterpret_cast<math::ul>(mapped) % 4096 == 0,
+			"placed buffers get their own mapping");
+#endif
+	check(nm::nodes() >= 2 || nm::detail::mapped_length(mapped) == 0, "single node hosts do not map buffers");
+	check(nm::detail::mapped_length(heap) == 0, "first touch buffers come from the heap");
+	nm::deallocate(mapped);
+	nm::deallocate(heap);
+	nm::deallocate(NULL);
+	nm::placement() = was;
+	nm::min_bytes() = min;
+
+	// chunks claimed node by node still cover the range exactly once
+	std::vector<int> hits (100000, 0);
+	int* h = hits.data();
+	math::parallel::parallel_for(0, hits.size(), [h](math::ul lo, math::ul hi) { for (math::ul i = lo; i < hi; ++i) ++h[i]; }, 1000);
+	bool once = true;
+	for (math::ul i = 0; i < hits.size(); ++i) once = once && hits[i] == 1;
+	check(once, "parallel_for covers every index once");
+
+	std::cout << "NUMA placement success\n";
+}
+
+void test_shared() {
+	std::cout << "\ntesting shared memory matrices...\n";
+
+	std::ostringstream name;
+	name << "/gpml_test_" << getpid();
+	math::dSharedMatrix::remove(name.str());
+
+	math::dMatrix m (40, 30, 0.0);
+	fill_pattern(m, 6);
+	{
+		math::dSharedMatrix owner (name.str(), m, true);
+		math::dSharedMatrix reader (name.str());
+		check(reader.rows() == 40 && reader.cols() == 30 && reader.read_only(), "attached shape from the header");
+		bool same = true;
+		for (math::uint i = 0; i < m.size(); ++i) same = same && reader.data()[i] == m.data()[i];
+		check(same && reader.data() != owner.data(), "a second mapping sees the elements");
+
+		owner.set(39, 29, 123.0);
+		check(reader.at(39, 29) == 123.0, "writes are visible through every mapping");
+
+		math::dMatrix copy = reader.dense();
+		check(copy.at(39, 29) == 123.0 && copy.at(0, 0) == m.at(0, 0), "dense copy");
+
+		// pointer kernels run on the mapping directly
+		math::dMatrix prod (40, 40, 0.0), mt (m);
+		mt.T();
+		mt.set(29, 39, 123.0);
+		math::gemm(40u, 40u, 30u, 1.0, reader.data(), 30, mt.data(), 40, 0.0, prod.data(), 40);
+		check(same_product(copy, mt, prod), "gemm on shared elements");
+
+		try {
+			reader.set(0, 0, 1.0);
+			check(false, "read-only mapping should refuse writes");
+		} catch (const std::runtime_error& e) {
+			std::cout << "properly caught read-only write with exception:\n\t" << e.what() << "\n";
+		}
+		try {
+			math::fSharedMatrix wrong (name.str());
+			check(false, "element type mismatch should throw");
+		} catch (const std::runtime_error& e) {
+			std::cout << "properly caught wrong element type with exception:\n\t" << e.what() << "\n";
+		}
+		try {
+			math::dSharedMatrix again (name.str(), 2, 2, 0.0);
+			check(false, "creating an existing name should throw");
+		} catch (const std::runtime_error& e) {
+			std::cout << "properly caught existing name with exception:\n\t" << e.what() << "\n";
+		}
+
+		math::dSharedMatrix writer (name.str(), false);
+		writer.mutable_data()[0] = -7.0;
+		check(reader(0, 0) == -7.0 && !writer.read_only(), "writable attach");
+	}
+
+	check(math::dSharedMatrix::remove(name.str()), "name removed");
+	try {
+		math::dSharedMatrix gone (name.str());
+		check(false, "attaching a removed name should throw");
+	} catch (const std::runtime_error& e) {
+		std::cout << "properly caught missing object with exception:\n\t" << e.what() << "\n";
+	}
+
+	std::cout << "shared memory matrices success\n";
+}